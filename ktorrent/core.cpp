@@ -23,19 +23,17 @@
 
 #include <QDir>
 #include <QNetworkInterface>
-#include <QProgressBar>
+#include <QThread>
+#include <QVector>
 
-#include <KIO/CopyJob>
 #include <KIO/Job>
+#include <KIO/StoredTransferJob>
 #include <KLocalizedString>
-#include <KMessageBox>
-#include <KStandardGuiItem>
 
-#include "dialogs/fileselectdlg.h"
-#include "dialogs/missingfilesdlg.h"
-#include "gui.h"
+#include "frontendinterface.h"
 #include "powermanagementinhibit_interface.h"
 #include "settings.h"
+#include "torrentdirloader.h"
 #include <bcodec/bencoder.h>
 #include <bcodec/bnode.h>
 #include <dbus/dbus.h>
@@ -49,10 +47,13 @@
 #include <net/socketmonitor.h>
 #include <peer/authenticationmonitor.h>
 #include <plugin/pluginmanager.h>
+#include <torrent/datacheckscheduler.h>
 #include <torrent/jobqueue.h>
 #include <torrent/magnetmanager.h>
 #include <torrent/queuemanager.h>
 #include <torrent/server.h>
+#include <torrent/statsaggregator.h>
+#include <torrent/statsjournal.h>
 #include <torrent/torrentcontrol.h>
 #include <torrent/torrentcreator.h>
 #include <util/error.h>
@@ -67,13 +68,26 @@ using namespace bt;
 namespace kt
 {
 const Uint32 CORE_UPDATE_INTERVAL = 250;
-
-Core::Core(kt::GUI *gui)
+// Maximum number of existing torrents constructed in one go during startup
+const int LOAD_BATCH_SIZE = 50;
+// Interval at which the torrent snapshot is saved
+const int SNAPSHOT_INTERVAL = 5 * 60 * 1000;
+// Interval at which the stats of running torrents are posted to the stats journal
+const int JOURNAL_POST_INTERVAL = 10 * 1000;
+
+Core::Core(kt::FrontendInterface *gui)
     : gui(gui)
     , keep_seeding(true)
     , sleep_suppression_cookie(0)
     , exiting(false)
     , reordering_queue(false)
+    , loader(nullptr)
+    , loading(false)
+    , snapshot_writer(nullptr)
+    , stats_journal(nullptr)
+    , scan_time(0)
+    , read_time(0)
+    , construct_time(0)
 {
     UpdateCurrentTime();
     qman = new QueueManager();
@@ -82,6 +96,18 @@ Core::Core(kt::GUI *gui)
     connect(qman, &kt::QueueManager::lowDiskSpace, this, &Core::onLowDiskSpace);
     connect(qman, &kt::QueueManager::orderingQueue, this, &Core::beforeQueueReorder);
     connect(qman, &kt::QueueManager::queueOrdered, this, &Core::afterQueueReorder);
+    connect(qman, &kt::QueueManager::error, this, [this](const QString &msg) {
+        gui->errorMsg(msg);
+    });
+    connect(
+        qman,
+        &kt::QueueManager::startAnywayQuestion,
+        this,
+        [this](const QString &msg, const QString &caption, const QStringList &names, bool *start) {
+            *start = gui->startAnyway(msg, caption, names);
+        },
+        Qt::DirectConnection);
+    check_scheduler = new kt::DataCheckScheduler(qman);
 
     data_dir = Settings::tempDir();
     bool dd_not_exist = !bt::Exists(data_dir);
@@ -93,12 +119,13 @@ Core::Core(kt::GUI *gui)
         }
     }
 
-    removed_bytes_up = removed_bytes_down = 0;
-
     if (!data_dir.endsWith(bt::DirSeparator()))
         data_dir += bt::DirSeparator();
+    dir_allocator.setDataDir(data_dir);
 
     connect(&update_timer, &QTimer::timeout, this, &Core::update);
+    connect(&snapshot_timer, &QTimer::timeout, this, &Core::saveSnapshot);
+    connect(&journal_timer, &QTimer::timeout, this, &Core::postStats);
 
     // Make sure network interface is set properly before server is initialized
     if (!Settings::networkInterface().isEmpty()) {
@@ -111,15 +138,25 @@ Core::Core(kt::GUI *gui)
 
     mman = new kt::MagnetManager(this);
     pman = new kt::PluginManager(this, gui);
+    pman->setHeadless(gui->isHeadless());
     gman = new kt::GroupManager();
     applySettings();
     gman->loadGroups();
     connect(gman, &kt::GroupManager::customGroupChanged, this, &Core::customGroupChanged);
+    connect(gman, &kt::GroupManager::limitsChanged, qman, &QueueManager::requeue);
+    stats_aggregator = new kt::StatsAggregator(gman);
+    connect(gman, &kt::GroupManager::groupAdded, this, [this]() {
+        stats_aggregator->updateGroups();
+    });
+    connect(gman, &kt::GroupManager::groupRemoved, this, [this]() {
+        stats_aggregator->updateGroups();
+    });
 
     qRegisterMetaType<bt::MagnetLink>("bt::MagnetLink");
     qRegisterMetaType<kt::MagnetLinkLoadOptions>("kt::MagnetLinkLoadOptions");
     connect(mman, &kt::MagnetManager::metadataDownloaded, this, &Core::onMetadataDownloaded, Qt::QueuedConnection);
 
+    mman->setMetadataCacheDir(kt::DataDir() + QLatin1String("metadata"));
     mman->loadMagnets(kt::DataDir() + QLatin1String("magnets"));
 
     connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &Core::onExit);
@@ -127,8 +164,12 @@ Core::Core(kt::GUI *gui)
 
 Core::~Core()
 {
+    waitForSnapshot();
+    delete stats_journal;
+    delete check_scheduler;
     delete qman;
     delete pman;
+    delete stats_aggregator;
     delete gman;
 }
 
@@ -203,6 +244,12 @@ void Core::applySettings()
     ApplySettings();
     setMaxDownloads(Settings::maxDownloads());
     setMaxSeeds(Settings::maxSeeds());
+    qman->setMaxDownloadsPerDevice(Settings::maxDownloadsPerDevice());
+    qman->setAdaptiveDownloadSlots(Settings::adaptiveDownloadSlots());
+    qman->setSeedRotation(Settings::rotateSeeds(), Settings::seedRotationInterval());
+    qman->announceScheduler()->setWindow(Settings::reannounceWindow());
+    qman->announceScheduler()->setMaxPerTracker(Settings::maxAnnouncesPerTracker());
+    check_scheduler->setMaxPerDevice(Settings::maxDataChecksPerDevice());
     setKeepSeeding(Settings::keepSeeding());
 
     QString tmp = Settings::tempDir();
@@ -216,6 +263,7 @@ void Core::applySettings()
     mman->setUseSlotTimer(Settings::requeueMagnets());
     mman->setTimerDuration(Settings::requeueMagnetsTime());
     mman->setDownloadingSlots(Settings::numMagnetDownloadingSlots());
+    mman->setMetadataCacheSize(Settings::magnetMetadataCacheSize());
 
     settingsChanged();
 }
@@ -225,7 +273,7 @@ void Core::loadPlugins()
     pman->loadPluginList();
 }
 
-bool Core::init(TorrentControl *tc, const QString &group, const QString &location, bool silently)
+bool Core::init(TorrentControl *tc, const QByteArray &data, const QString &group, const QString &location, bool silently)
 {
     bool start_torrent = false;
     bool skip_check = false;
@@ -239,21 +287,14 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
     if (Settings::useCompletedDir() && (silently || Settings::openAllTorrentsSilently()))
         tc->setMoveWhenCompletedDir(Settings::completedDir());
 
-    if (qman->alreadyLoaded(tc->getInfoHash())) {
+    if (qman->alreadyLoaded(tc->getInfoHash()) || isDormant(tc->getInfoHash())) {
         Out(SYS_GEN | LOG_IMPORTANT) << "Torrent " << tc->getDisplayName() << " already loaded" << endl;
         return false;
     }
 
-    if (!silently && !Settings::openAllTorrentsSilently()) {
-        FileSelectDlg dlg(qman, gman, group, gui->getMainWindow());
-        dlg.loadState(KSharedConfig::openConfig());
-        bool ret = dlg.execute(tc, &start_torrent, &skip_check, location) == QDialog::Accepted;
-        dlg.saveState(KSharedConfig::openConfig());
-
-        if (!ret)
+    if (!silently && !Settings::openAllTorrentsSilently() && !gui->isHeadless()) {
+        if (!gui->selectFiles(tc, group, location, &start_torrent, &skip_check, &selected_group))
             return false;
-        else
-            selected_group = dlg.selectedGroup();
     } else
         start_torrent = true;
 
@@ -266,7 +307,7 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
                 "Opening the torrent <b>%1</b>, would share one or more files with the following torrents. "
                 "Torrents are not allowed to write to the same files. ",
                 tc->getDisplayName());
-            KMessageBox::errorList(gui, err, conflicting);
+            gui->errorList(err, conflicting);
         }
 
         return false;
@@ -281,6 +322,12 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
         return false;
     }
 
+    tc->setPreallocateDiskSpace(true);
+    connectSignals(tc);
+    qman->append(tc);
+
+    // the check is scheduled once the queue knows the torrent, so the queue
+    // holds the torrent back until the check is done
     if (tc->hasExistingFiles()) {
         if (!skip_check)
             doDataCheck(tc, true);
@@ -288,24 +335,17 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
             tc->markExistingFilesAsDownloaded();
     }
 
-    tc->setPreallocateDiskSpace(true);
-    connectSignals(tc);
-    qman->append(tc);
     qman->torrentAdded(tc, start_torrent);
 
-    // now copy torrent file to user specified dir if needed
+    // now copy torrent file to user specified dir if needed,
+    // we still have the data, so there is no need to read back the torrent file
     if (Settings::useTorrentCopyDir()) {
-        QString torFile = tc->getTorDir();
-        if (!torFile.endsWith(bt::DirSeparator()))
-            torFile += bt::DirSeparator();
-
-        torFile += QLatin1String("torrent");
         QString destination = Settings::torrentCopyDir();
         if (!destination.endsWith(bt::DirSeparator()))
             destination += bt::DirSeparator();
 
         destination += tc->getStats().torrent_name + QLatin1String(".torrent");
-        KIO::copy(QUrl::fromLocalFile(torFile), QUrl::fromLocalFile(destination));
+        KIO::storedPut(data, QUrl::fromLocalFile(destination), -1);
     }
 
     // add torrent to group if necessary
@@ -317,14 +357,24 @@ bool Core::init(TorrentControl *tc, const QString &group, const QString &locatio
         }
     }
 
+    stats_aggregator->updateGroups(tc);
     torrentAdded(tc);
     if (silently)
         Q_EMIT openedSilently(tc);
     return true;
 }
 
-bt::TorrentInterface *Core::loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url)
+bt::TorrentInterface *
+Core::loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url, const QString &move_on_completion)
 {
+    if (loading) {
+        // not all existing torrents are known yet, so duplicates and file conflicts
+        // can only be detected once they are
+        Out(SYS_GEN | LOG_NOTICE) << "Still loading torrents, " << url.toDisplayString() << " will be loaded afterwards" << endl;
+        pending_loads.append({data, dir, group, silently, url, move_on_completion});
+        return nullptr;
+    }
+
     QString tdir = findNewTorrentDir();
     TorrentControl *tc = 0;
     try {
@@ -332,7 +382,9 @@ bt::TorrentInterface *Core::loadFromData(const QByteArray &data, const QString &
         tc->setLoadUrl(url);
         tc->init(qman, data, tdir, dir);
 
-        if (init(tc, group, dir, silently)) {
+        if (init(tc, data, group, dir, silently)) {
+            if (!move_on_completion.isEmpty())
+                tc->setMoveWhenCompletedDir(move_on_completion);
             startUpdateTimer();
             return tc;
         }
@@ -352,6 +404,8 @@ bt::TorrentInterface *Core::loadFromData(const QByteArray &data, const QString &
     // delete tdir if necessary
     if (bt::Exists(tdir))
         bt::Delete(tdir, true);
+    // hand the dir out again, otherwise every failed load leaves a hole
+    dir_allocator.release(tdir);
 
     return 0;
 }
@@ -560,22 +614,11 @@ void Core::pause(QList<bt::TorrentInterface *> &todo)
 
 QString Core::findNewTorrentDir() const
 {
-    int i = 0;
-    while (true) {
-        QDir d;
-        QString dir = data_dir % QLatin1String("tor") % QString::number(i) % QLatin1Char('/');
-        if (!d.exists(dir)) {
-            return dir;
-        }
-        i++;
-    }
-    return QString();
+    return dir_allocator.allocate();
 }
 
 void Core::loadExistingTorrent(const QString &tor_dir)
 {
-    TorrentControl *tc = 0;
-
     QString idir = tor_dir;
     if (!idir.endsWith(bt::DirSeparator()))
         idir += bt::DirSeparator();
@@ -583,9 +626,25 @@ void Core::loadExistingTorrent(const QString &tor_dir)
     if (!bt::Exists(idir + QLatin1String("torrent")))
         return;
 
+    try {
+        loadExistingTorrent(idir, bt::LoadFile(idir + QLatin1String("torrent")));
+    } catch (bt::Error &err) {
+        gui->errorMsg(err.toString());
+    }
+}
+
+void Core::loadExistingTorrent(const QString &tor_dir, const QByteArray &data)
+{
+    TorrentControl *tc = 0;
     try {
         tc = new TorrentControl();
-        tc->init(qman, bt::LoadFile(idir + QLatin1String("torrent")), idir, QString());
+        tc->init(qman, data, tor_dir, QString());
+        if (qman->alreadyLoaded(tc->getInfoHash())) {
+            // can happen when the same torrent was added while we were still loading
+            Out(SYS_GEN | LOG_NOTICE) << "Torrent in " << tor_dir << " is already loaded, skipping" << endl;
+            delete tc;
+            return;
+        }
 
         qman->append(tc);
         connectSignals(tc);
@@ -602,26 +661,230 @@ void Core::loadExistingTorrent(const QString &tor_dir)
 
 void Core::loadTorrents()
 {
+    load_timer.start();
+    loading = true;
+    // the suspended state must be known before any torrent is loaded, so that the
+    // dormant torrents which are loaded later are matched as well
+    qman->loadState(KSharedConfig::openConfig());
+    // show the torrents of the previous session until they are loaded
+    if (snapshot.load(kt::DataDir() + QLatin1String("snapshot")))
+        gman->updateCount(snapshot);
+
     QDir dir(data_dir);
     QStringList filters;
     filters << QStringLiteral("tor*");
     const QStringList sl = dir.entryList(filters, QDir::Dirs);
+    dir_allocator.reset(data_dir, sl);
+    QStringList dirs;
     for (const QString &s : sl) {
         QString idir = data_dir + s;
         if (!idir.endsWith(DirSeparator()))
             idir.append(DirSeparator());
+        dirs.append(idir);
+    }
+
+    scan_time = load_timer.elapsed();
+    construct_time = 0;
+    Out(SYS_GEN | LOG_NOTICE) << "Found " << dirs.count() << " torrents in " << scan_time << " ms" << endl;
+
+    // Reading the torrent dirs is done on a thread pool, constructing the torrents
+    // is done in batches on the main thread so the event loop keeps running.
+    // Torrents which are stopped are constructed after the active ones, so that
+    // the active ones can be started as soon as possible.
+    loader = new TorrentDirLoader(dirs, StatsJournal::load(data_dir + QLatin1String("stats_journal")), QueueManager::enabled(), this);
+    connect(loader, &TorrentDirLoader::itemsReady, this, &Core::loadNextTorrents, Qt::QueuedConnection);
+    loader->start();
+    loadNextTorrents();
+}
 
-        Out(SYS_GEN | LOG_NOTICE) << "Loading " << idir << endl;
-        loadExistingTorrent(idir);
+void Core::loadNextTorrents()
+{
+    if (!loader || exiting)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<TorrentDirLoader::Item> items = loader->take(LOAD_BATCH_SIZE);
+    for (const TorrentDirLoader::Item &item : items) {
+        if (!item.error.isEmpty()) {
+            gui->errorMsg(item.error);
+        } else if (item.dormant && snapshot.find(item.info_hash)) {
+            // shown from the snapshot until something needs to be done with it
+            dormant_dirs.insert(item.info_hash, item.dir);
+        } else if (item.dormant) {
+            deferred_torrents.append(qMakePair(item.dir, item.data));
+        } else if (!item.data.isEmpty()) {
+            Out(SYS_GEN | LOG_DEBUG) << "Loading " << item.dir << endl;
+            loadExistingTorrent(item.dir, item.data);
+        }
     }
+    construct_time += timer.elapsed();
 
-    gman->torrentsLoaded(qman);
-    qman->loadState(KSharedConfig::openConfig());
+    if (loader->finished())
+        activeTorrentsLoaded();
+    else if (loader->hasItems())
+        QTimer::singleShot(0, this, &Core::loadNextTorrents);
+    // else wait for itemsReady
+}
+
+void Core::activeTorrentsLoaded()
+{
+    read_time = loader->readTime();
+    loader->deleteLater();
+    loader = nullptr;
+
+    Out(SYS_GEN | LOG_NOTICE) << "Loaded " << qman->count() << " active torrents in " << load_timer.elapsed() << " ms" << endl;
     QTimer::singleShot(0, this, &Core::delayedStart);
+
+    if (deferred_torrents.isEmpty())
+        torrentsLoaded();
+    else
+        QTimer::singleShot(0, this, &Core::loadDeferredTorrents);
+}
+
+void Core::loadDeferredTorrents()
+{
+    if (exiting)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < LOAD_BATCH_SIZE && !deferred_torrents.isEmpty(); i++) {
+        const QPair<QString, QByteArray> tor = deferred_torrents.takeFirst();
+        Out(SYS_GEN | LOG_DEBUG) << "Loading " << tor.first << endl;
+        loadExistingTorrent(tor.first, tor.second);
+    }
+    construct_time += timer.elapsed();
+
+    if (deferred_torrents.isEmpty())
+        torrentsLoaded();
+    else
+        QTimer::singleShot(0, this, &Core::loadDeferredTorrents);
+}
+
+void Core::torrentsLoaded()
+{
+    Out(SYS_GEN | LOG_NOTICE) << "Loaded " << qman->count() << " torrents in " << load_timer.elapsed() << " ms (scan: " << scan_time
+                              << " ms, read: " << read_time << " ms, construct: " << construct_time << " ms)" << endl;
+    Out(SYS_GEN | LOG_NOTICE) << dormant_dirs.count() << " dormant torrents are not loaded" << endl;
+    std::set<bt::SHA1Hash> dormant;
+    for (QHash<bt::SHA1Hash, QString>::const_iterator i = dormant_dirs.cbegin(); i != dormant_dirs.cend(); i++)
+        dormant.insert(i.key());
+    gman->torrentsLoaded(qman, dormant);
+    stats_aggregator->updateGroups();
+
+    loading = false;
+    gman->updateCount(qman, dormantTorrents());
+    Q_EMIT allTorrentsLoaded();
+    // the dormant torrents are shown using their snapshot entries
+    if (dormant_dirs.isEmpty())
+        snapshot.clear();
+    saveSnapshot();
+    snapshot_timer.start(SNAPSHOT_INTERVAL);
+
+    // the stats files have been brought up to date, from now on the journal keeps them that way
+    stats_journal = new StatsJournal(data_dir + QLatin1String("stats_journal"));
+    stats_journal->start();
+    qman->setStatsJournalEnabled(true);
+    journal_timer.start(JOURNAL_POST_INTERVAL);
+
+    loadPendingTorrents();
+}
+
+void Core::loadPendingTorrents()
+{
+    const QList<PendingLoad> todo = pending_loads;
+    pending_loads.clear();
+    for (const PendingLoad &p : todo)
+        loadFromData(p.data, p.dir, p.group, p.silently, p.url, p.move_on_completion);
+}
+
+void Core::postStats()
+{
+    if (!stats_journal)
+        return;
+
+    QList<StatsJournal::Record> records;
+    for (bt::TorrentInterface *tc : qman->runningTorrents())
+        records.append(StatsJournal::snapshot(tc));
+
+    if (!records.isEmpty())
+        stats_journal->post(records);
+}
+
+void Core::saveSnapshot()
+{
+    // encoding needs the torrents and groups, so that is done here, the file is written on a thread
+    waitForSnapshot();
+    const QString file = kt::DataDir() + QLatin1String("snapshot");
+    const QByteArray data = TorrentSnapshot::encode(qman, gman, dormantTorrents());
+    snapshot_writer = QThread::create([file, data]() {
+        TorrentSnapshot::write(file, data);
+    });
+    snapshot_writer->start();
+}
+
+void Core::waitForSnapshot()
+{
+    if (!snapshot_writer)
+        return;
+
+    snapshot_writer->wait();
+    delete snapshot_writer;
+    snapshot_writer = nullptr;
+}
+
+void Core::updateGroupCount()
+{
+    if (loading && !snapshot.isEmpty())
+        gman->updateCount(snapshot);
+    else
+        gman->updateCount(qman, dormantTorrents());
+}
+
+bool Core::isDormant(const bt::SHA1Hash &ih) const
+{
+    return dormant_dirs.contains(ih);
+}
+
+bt::TorrentInterface *Core::loadDormantTorrent(const bt::SHA1Hash &ih)
+{
+    const QString dir = dormant_dirs.take(ih);
+    if (dir.isEmpty())
+        return qman->find(ih);
+
+    Out(SYS_GEN | LOG_DEBUG) << "Loading dormant torrent " << dir << endl;
+    loadExistingTorrent(dir);
+    bt::TorrentInterface *tc = qman->find(ih);
+    // while loading, the custom groups are filled in when everything is loaded
+    if (tc && !loading)
+        gman->dormantTorrentLoaded(tc);
+
+    return tc;
+}
+
+QList<const TorrentSnapshot::Entry *> Core::dormantTorrents() const
+{
+    QList<const TorrentSnapshot::Entry *> entries;
+    entries.reserve(dormant_dirs.count());
+    for (QHash<bt::SHA1Hash, QString>::const_iterator i = dormant_dirs.cbegin(); i != dormant_dirs.cend(); i++) {
+        const TorrentSnapshot::Entry *e = snapshot.find(i.key());
+        if (e)
+            entries.append(e);
+    }
+    return entries;
+}
+
+void Core::loadAllDormantTorrents()
+{
+    const QList<bt::SHA1Hash> hashes = dormant_dirs.keys();
+    for (const bt::SHA1Hash &ih : hashes)
+        loadDormantTorrent(ih);
 }
 
 void Core::delayedStart()
 {
+    // only schedules the pass, the autostart torrents below do not depend on it
     qman->orderQueue();
     if (!kt::QueueManager::enabled())
         qman->startAutoStartTorrents();
@@ -637,10 +900,10 @@ void Core::remove(bt::TorrentInterface *tc, bool data_to)
             return;
         }
 
-        const bt::TorrentStats &s = tc->getStats();
-        removed_bytes_up += s.session_bytes_uploaded;
-        removed_bytes_down += s.session_bytes_downloaded;
         stop(tc);
+        stats_aggregator->update(tc);
+        stats_aggregator->remove(tc);
+        check_scheduler->remove(tc);
 
         QString dir = tc->getTorDir();
 
@@ -656,6 +919,9 @@ void Core::remove(bt::TorrentInterface *tc, bool data_to)
         qman->torrentRemoved(tc);
         gui->updateActions();
         bt::Delete(dir, false);
+        dir_allocator.release(dir);
+        if (stats_journal)
+            stats_journal->removeTorrent(QDir(dir).dirName());
         delayed_removal.remove(tc);
     } catch (Error &e) {
         gui->errorMsg(e.toString());
@@ -679,9 +945,9 @@ void Core::remove(QList<bt::TorrentInterface *> &todo, bool data_to)
     stop(todo);
 
     for (bt::TorrentInterface *tc : qAsConst(todo)) {
-        const bt::TorrentStats &s = tc->getStats();
-        removed_bytes_up += s.session_bytes_uploaded;
-        removed_bytes_down += s.session_bytes_downloaded;
+        stats_aggregator->update(tc);
+        stats_aggregator->remove(tc);
+        check_scheduler->remove(tc);
 
         QString dir = tc->getTorDir();
 
@@ -696,6 +962,9 @@ void Core::remove(QList<bt::TorrentInterface *> &todo, bool data_to)
         gman->torrentRemoved(tc);
         try {
             bt::Delete(dir, false);
+            dir_allocator.release(dir);
+            if (stats_journal)
+                stats_journal->removeTorrent(QDir(dir).dirName());
         } catch (Error &e) {
             gui->errorMsg(e.toString());
         }
@@ -745,6 +1014,14 @@ void Core::onExit()
     exiting = true;
     update_timer.stop();
 
+    // abort loading of torrents if we are still starting up
+    snapshot_timer.stop();
+    journal_timer.stop();
+    delete loader;
+    loader = nullptr;
+    deferred_torrents.clear();
+    pending_loads.clear();
+
     net::SocketMonitor::instance().shutdown();
     mman->saveMagnets(kt::DataDir() + QLatin1String("magnets"));
     // make sure DHT is stopped
@@ -754,9 +1031,19 @@ void Core::onExit()
 
     WaitJob *job = new WaitJob(5000);
     qman->saveState(KSharedConfig::openConfig());
+    // a partial snapshot would hide the torrents which were not loaded yet at the next startup
+    if (!loading)
+        saveSnapshot();
+
+    // write the last stats, the torrents will also save them when they are stopped
+    if (stats_journal) {
+        postStats();
+        stats_journal->stop();
+    }
 
     // Sync the config to be sure everything is saved
     Settings::self()->save();
+    waitForSnapshot();
 
     qman->onExit(job);
     // wait for completion of stopped events
@@ -783,6 +1070,8 @@ bool Core::changeDataDir(const QString &new_dir)
             return true;
 
         update_timer.stop();
+        // the torX dirs of the dormant torrents have to move as well
+        loadAllDormantTorrents();
         // safety check
         if (!bt::Exists(new_dir))
             bt::MakeDir(new_dir);
@@ -815,7 +1104,18 @@ bool Core::changeDataDir(const QString &new_dir)
             }
             i++;
         }
+        // the journal moves along with the torX dirs
+        if (stats_journal) {
+            postStats();
+            stats_journal->stop();
+            delete stats_journal;
+            bt::Delete(data_dir + QLatin1String("stats_journal"), true);
+            stats_journal = new StatsJournal(nd + QLatin1String("stats_journal"));
+            stats_journal->start();
+        }
+
         data_dir = nd;
+        dir_allocator.setDataDir(data_dir);
         qman->setSuspendedState(false);
         update_timer.start(CORE_UPDATE_INTERVAL);
         return true;
@@ -840,6 +1140,7 @@ void Core::rollback(const QList<bt::TorrentInterface *> &succes)
 
 void Core::startAll()
 {
+    loadAllDormantTorrents();
     qman->startAll();
     startUpdateTimer();
 }
@@ -881,15 +1182,16 @@ void Core::update()
         bt::UpdateCurrentTime();
         AuthenticationMonitor::instance().update();
 
-        QList<bt::TorrentInterface *>::iterator i = qman->begin();
+        // only running torrents need to be updated, updating a torrent can
+        // change the running set, so iterate over a copy of it
+        const std::set<bt::TorrentInterface *> &running = qman->runningTorrents();
+        const QVector<bt::TorrentInterface *> to_update(running.begin(), running.end());
         bool updated = false;
-        while (i != qman->end()) {
-            bt::TorrentInterface *tc = *i;
-            if (tc->getStats().running) {
-                tc->update();
-                updated = true;
-            }
-            i++;
+        for (bt::TorrentInterface *tc : to_update) {
+            tc->update();
+            qman->updateRunning(tc);
+            stats_aggregator->update(tc);
+            updated = true;
         }
 
         if (!updated && mman->count() == 0) {
@@ -917,6 +1219,8 @@ void Core::update()
             if (Settings::decreasePriorityOfStalledTorrents()) {
                 qman->checkStalledTorrents(bt::CurrentTime(), Settings::stallTimer());
             }
+            qman->updateDownloadSlots(bt::CurrentTime(), stats_aggregator->totals().download_speed, Settings::maxDownloadRate() * 1024);
+            qman->rotateSeeds(bt::CurrentTime());
         }
     } catch (bt::Error &err) {
         Out(SYS_GEN | LOG_IMPORTANT) << "Caught bt::Error: " << err.toString() << endl;
@@ -945,28 +1249,15 @@ bt::TorrentInterface *Core::createTorrent(bt::TorrentCreator *mktor, bool seed)
         // Show error message
         gui->errorMsg(i18n("Cannot create torrent: %1", e.toString()));
     }
+
+    if (!tdir.isEmpty())
+        dir_allocator.release(tdir);
     return 0;
 }
 
 CurrentStats Core::getStats()
 {
-    CurrentStats stats;
-    Uint64 bytes_dl = 0, bytes_ul = 0;
-    Uint32 speed_dl = 0, speed_ul = 0;
-
-    for (bt::TorrentInterface *tc : qAsConst(*qman)) {
-        const TorrentStats &s = tc->getStats();
-        speed_dl += s.download_rate;
-        speed_ul += s.upload_rate;
-        bytes_dl += s.session_bytes_downloaded;
-        bytes_ul += s.session_bytes_uploaded;
-    }
-    stats.download_speed = speed_dl;
-    stats.upload_speed = speed_ul;
-    stats.bytes_downloaded = bytes_dl + removed_bytes_down;
-    stats.bytes_uploaded = bytes_ul + removed_bytes_up;
-
-    return stats;
+    return stats_aggregator->totals();
 }
 
 bool Core::changePort(Uint16 port)
@@ -996,12 +1287,12 @@ void Core::slotStoppedByError(bt::TorrentInterface *tc, QString msg)
 
 Uint32 Core::getNumTorrentsRunning() const
 {
-    return qman->getNumRunning();
+    return qman->runningTorrents().size();
 }
 
 Uint32 Core::getNumTorrentsNotRunning() const
 {
-    return qman->count() - qman->getNumRunning();
+    return qman->count() - qman->runningTorrents().size() + dormant_dirs.count();
 }
 
 kt::QueueManager *Core::getQueueManager()
@@ -1011,6 +1302,7 @@ kt::QueueManager *Core::getQueueManager()
 
 void Core::torrentSeedAutoStopped(bt::TorrentInterface *tc, AutoStopReason reason)
 {
+    // the freed slot is handed out on the next pass over the queue
     qman->startNext();
     if (reason == MAX_RATIO_REACHED)
         maxShareRatioReached(tc);
@@ -1040,8 +1332,7 @@ bool Core::checkMissingFiles(TorrentInterface *tc)
     QStringList not_mounted;
     while (!tc->isStorageMounted(not_mounted)) {
         QString msg = i18n("One or more storage volumes are not mounted. In order to start this torrent, they need to be mounted.");
-        KGuiItem retry(i18n("Retry"), QStringLiteral("emblem-mounted"));
-        if (KMessageBox::warningContinueCancelList(gui, msg, not_mounted, QString(), retry) == KMessageBox::Continue) {
+        if (gui->retryUnmounted(msg, not_mounted)) {
             not_mounted.clear();
             continue;
         } else {
@@ -1063,13 +1354,11 @@ bool Core::checkMissingFiles(TorrentInterface *tc)
             "Do you want to recreate them, or do you want to not download them?",
             tc->getStats().torrent_name);
 
-        MissingFilesDlg dlg(msg, missing, tc, 0);
-
-        switch (dlg.execute()) {
-        case MissingFilesDlg::CANCEL:
+        switch (gui->missingFiles(msg, missing, tc)) {
+        case FrontendInterface::CANCEL:
             tc->handleError(i18n("Data files are missing"));
             return false;
-        case MissingFilesDlg::DO_NOT_DOWNLOAD:
+        case FrontendInterface::DO_NOT_DOWNLOAD:
             try {
                 // mark them as do not download
                 tc->dndMissingFiles();
@@ -1079,17 +1368,18 @@ bool Core::checkMissingFiles(TorrentInterface *tc)
                 return false;
             }
             break;
-        case MissingFilesDlg::RECREATE:
+        case FrontendInterface::RECREATE:
             try {
                 // recreate them
                 tc->recreateMissingFiles();
             } catch (bt::Error &e) {
-                KMessageBox::error(0, i18n("Cannot recreate missing files: %1", e.toString()));
+                gui->errorMsg(i18n("Cannot recreate missing files: %1", e.toString()));
                 tc->handleError(i18n("Data files are missing"));
                 return false;
             }
             break;
-        case MissingFilesDlg::NEW_LOCATION_SELECTED:
+        case FrontendInterface::NEW_LOCATION_SELECTED:
+            qman->filesChanged(tc);
             break;
         }
     } else {
@@ -1097,13 +1387,11 @@ bool Core::checkMissingFiles(TorrentInterface *tc)
             "The file where the data is saved of the torrent \"%1\" is missing.\n"
             "Do you want to recreate it?",
             tc->getStats().torrent_name);
-        MissingFilesDlg dlg(msg, missing, tc, 0);
-
-        switch (dlg.execute()) {
-        case MissingFilesDlg::CANCEL:
+        switch (gui->missingFiles(msg, missing, tc)) {
+        case FrontendInterface::CANCEL:
             tc->handleError(i18n("Data file is missing"));
             return false;
-        case MissingFilesDlg::RECREATE:
+        case FrontendInterface::RECREATE:
             try {
                 tc->recreateMissingFiles();
             } catch (bt::Error &e) {
@@ -1112,9 +1400,10 @@ bool Core::checkMissingFiles(TorrentInterface *tc)
                 return false;
             }
             break;
-        case MissingFilesDlg::DO_NOT_DOWNLOAD:
+        case FrontendInterface::DO_NOT_DOWNLOAD:
             return false;
-        case MissingFilesDlg::NEW_LOCATION_SELECTED:
+        case FrontendInterface::NEW_LOCATION_SELECTED:
+            qman->filesChanged(tc);
             break;
         }
     }
@@ -1141,6 +1430,7 @@ void Core::connectSignals(bt::TorrentInterface *tc)
     connect(tc, &bt::TorrentInterface::corruptedDataFound, this, &Core::emitCorruptedData);
     connect(tc, &bt::TorrentInterface::needDataCheck, this, &Core::autoCheckData);
     connect(tc, &bt::TorrentInterface::statusChanged, this, &Core::onStatusChanged);
+    stats_aggregator->add(tc);
 }
 
 float Core::getGlobalMaxShareRatio() const
@@ -1155,14 +1445,14 @@ void Core::enqueueTorrentOverMaxRatio(bt::TorrentInterface *tc)
 
 void Core::autoCheckData(bt::TorrentInterface *tc)
 {
-    Out(SYS_GEN | LOG_IMPORTANT) << "Doing an automatic data check on " << tc->getStats().torrent_name << endl;
+    Out(SYS_GEN | LOG_IMPORTANT) << "Queueing an automatic data check on " << tc->getStats().torrent_name << endl;
 
-    doDataCheck(tc);
+    check_scheduler->enqueue(tc, false);
 }
 
 void Core::doDataCheck(bt::TorrentInterface *tc, bool auto_import)
 {
-    tc->startDataCheck(auto_import, 0, tc->getStats().total_chunks);
+    check_scheduler->enqueue(tc, true, auto_import);
 }
 
 void Core::onLowDiskSpace(bt::TorrentInterface *tc, bool stopped)
@@ -1182,7 +1472,9 @@ DBus *Core::getExternalInterface()
 
 void Core::onStatusChanged(bt::TorrentInterface *tc)
 {
-    Q_UNUSED(tc);
+    // membership of the default groups depends on the status
+    stats_aggregator->updateGroups(tc);
+    stats_aggregator->update(tc);
     if (!reordering_queue)
         gui->updateActions();
 }
@@ -1196,13 +1488,14 @@ void Core::afterQueueReorder()
 {
     reordering_queue = false;
     gui->updateActions();
-    gman->updateCount(qman);
+    updateGroupCount();
     startUpdateTimer();
 }
 
 void Core::customGroupChanged()
 {
-    gman->updateCount(qman);
+    stats_aggregator->updateGroups();
+    updateGroupCount();
 }
 
 void Core::load(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options)
@@ -1217,6 +1510,28 @@ void Core::load(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &option
     }
 }
 
+bt::Uint32 Core::load(const QList<bt::MagnetLink> &mlinks, const MagnetLinkLoadOptions &options)
+{
+    QList<bt::MagnetLink> todo;
+    todo.reserve(mlinks.count());
+    for (const bt::MagnetLink &mlink : mlinks) {
+        if (!mlink.isValid())
+            Out(SYS_GEN | LOG_NOTICE) << "Invalid magnet bittorrent link: " << mlink.toString() << endl;
+        else if (!qman->alreadyLoaded(mlink.infoHash()) && !isDormant(mlink.infoHash()))
+            todo.append(mlink);
+    }
+
+    if (todo.isEmpty())
+        return 0;
+
+    if (!Globals::instance().getDHT().isRunning())
+        dhtNotEnabled(i18n("You are attempting to download a magnet link, and DHT is not enabled. For optimum results enable DHT."));
+
+    const int added = mman->addMagnets(todo, options, false);
+    startUpdateTimer();
+    return added;
+}
+
 void Core::onMetadataDownloaded(const bt::MagnetLink &mlink, const QByteArray &data, const kt::MagnetLinkLoadOptions &options)
 {
     QByteArray tmp;
@@ -1244,14 +1559,14 @@ void Core::onMetadataDownloaded(const bt::MagnetLink &mlink, const QByteArray &d
 
     QUrl url(mlink.toString());
 
-    bt::TorrentInterface *tc = 0;
-    if (options.silently)
-        tc = loadSilently(tmp, url, options.group, options.location);
+    QString dir;
+    if (options.location.isEmpty() || !bt::Exists(options.location))
+        dir = locationHint(options.group);
     else
-        tc = load(tmp, url, options.group, options.location);
+        dir = options.location;
 
-    if (tc && !options.move_on_completion.isEmpty())
-        tc->setMoveWhenCompletedDir(options.move_on_completion);
+    // the move on completion dir is set by loadFromData, the load may be delayed until all torrents are loaded
+    loadFromData(tmp, dir, options.group, options.silently, url, options.move_on_completion);
 }
 
 QString Core::locationHint(const QString &group) const
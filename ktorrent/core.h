@@ -22,13 +22,21 @@
 #ifndef KTCORE_HH
 #define KTCORE_HH
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
 #include <QMap>
+#include <QPair>
 #include <QTimer>
 
 #include <interfaces/coreinterface.h>
 #include <interfaces/torrentinterface.h>
+#include <torrent/torrentsnapshot.h>
+
+#include "torrentdirallocator.h"
 
 class KJob;
+class QThread;
 
 namespace bt
 {
@@ -39,7 +47,9 @@ class TorrentInterface;
 namespace kt
 {
 class MagnetManager;
-class GUI;
+class FrontendInterface;
+class TorrentDirLoader;
+class StatsJournal;
 class PluginManager;
 class GroupManager;
 
@@ -50,7 +60,7 @@ class Core : public CoreInterface
 {
     Q_OBJECT
 public:
-    Core(GUI *gui);
+    Core(FrontendInterface *gui);
     ~Core() override;
 
     // implemented from CoreInterface
@@ -67,8 +77,12 @@ public:
     void loadSilently(const QUrl &url, const QString &group) override;
     bt::TorrentInterface *loadSilently(const QByteArray &data, const QUrl &url, const QString &group, const QString &savedir) override;
     void load(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options) override;
+    bt::Uint32 load(const QList<bt::MagnetLink> &mlinks, const MagnetLinkLoadOptions &options) override;
     QString findNewTorrentDir() const override;
     void loadExistingTorrent(const QString &tor_dir) override;
+    bool isDormant(const bt::SHA1Hash &ih) const override;
+    bt::TorrentInterface *loadDormantTorrent(const bt::SHA1Hash &ih) override;
+    QList<const TorrentSnapshot::Entry *> dormantTorrents() const override;
     void setSuspendedState(bool suspend) override;
     bool getSuspendedState() override;
     float getGlobalMaxShareRatio() const;
@@ -89,6 +103,18 @@ public:
         return mman;
     }
 
+    /// Get the stats aggregator
+    kt::StatsAggregator *getStatsAggregator() override
+    {
+        return stats_aggregator;
+    }
+
+    /// Get the data check scheduler
+    kt::DataCheckScheduler *getDataCheckScheduler() override
+    {
+        return check_scheduler;
+    }
+
     bt::TorrentInterface *createTorrent(bt::TorrentCreator *mktor, bool seed) override;
 
     /**
@@ -108,6 +134,18 @@ public:
      */
     void loadPlugins();
 
+    /// Whether or not the existing torrents are still being loaded
+    bool isLoadingTorrents() const
+    {
+        return loading;
+    }
+
+    /// Snapshot of the torrents from the previous session, only valid while loading the torrents and while there are dormant torrents
+    const TorrentSnapshot &startupSnapshot() const
+    {
+        return snapshot;
+    }
+
 public Q_SLOTS:
     /**
      * Start the update timer
@@ -148,7 +186,8 @@ public Q_SLOTS:
     void enqueueTorrentOverMaxRatio(bt::TorrentInterface *tc);
 
     /**
-     * Do a data check on a torrent
+     * Do a data check on a torrent. The check is queued in the DataCheckScheduler,
+     * ahead of the automatic checks.
      * @param tc The torrent
      * @param auto_import Is this an automatic import
      */
@@ -231,16 +270,29 @@ Q_SIGNALS:
      */
     void aboutToQuit();
 
+    /**
+     * Emitted when all existing torrents have been loaded at startup
+     */
+    void allTorrentsLoaded();
+
 private:
     void rollback(const QList<bt::TorrentInterface *> &success);
     void connectSignals(bt::TorrentInterface *tc);
-    bool init(bt::TorrentControl *tc, const QString &group, const QString &location, bool silently);
+    bool init(bt::TorrentControl *tc, const QByteArray &data, const QString &group, const QString &location, bool silently);
     QString locationHint(const QString &group) const;
     void startServers();
     void startTCPServer(bt::Uint16 port);
     bool startUTPServer(bt::Uint16 port);
     bt::TorrentInterface *loadFromFile(const QString &file, const QString &dir, const QString &group, bool silently);
-    bt::TorrentInterface *loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url);
+    bt::TorrentInterface *
+    loadFromData(const QByteArray &data, const QString &dir, const QString &group, bool silently, const QUrl &url, const QString &move_on_completion = QString());
+    void loadPendingTorrents();
+    void loadExistingTorrent(const QString &tor_dir, const QByteArray &data);
+    void activeTorrentsLoaded();
+    void torrentsLoaded();
+    void updateGroupCount();
+    void waitForSnapshot();
+    void loadAllDormantTorrents();
 
 public:
     void loadTorrents();
@@ -255,6 +307,10 @@ private Q_SLOTS:
     void autoCheckData(bt::TorrentInterface *tc);
     void delayedRemove(bt::TorrentInterface *tc);
     void delayedStart();
+    void loadNextTorrents();
+    void loadDeferredTorrents();
+    void saveSnapshot();
+    void postStats();
     void beforeQueueReorder();
     void afterQueueReorder();
     void customGroupChanged();
@@ -264,14 +320,16 @@ private Q_SLOTS:
     void onExit();
 
 private:
-    GUI *gui;
+    FrontendInterface *gui;
     bool keep_seeding;
     QString data_dir;
+    mutable TorrentDirAllocator dir_allocator;
     QTimer update_timer;
-    bt::Uint64 removed_bytes_up, removed_bytes_down;
     kt::PluginManager *pman;
     kt::QueueManager *qman;
     kt::GroupManager *gman;
+    kt::StatsAggregator *stats_aggregator;
+    kt::DataCheckScheduler *check_scheduler;
     kt::MagnetManager *mman;
     QMap<KJob *, QUrl> custom_save_locations; // map to store save locations
     QMap<QUrl, QString> add_to_groups; // Map to keep track of which group to add a torrent to
@@ -279,6 +337,30 @@ private:
     QMap<bt::TorrentInterface *, bool> delayed_removal;
     bool exiting;
     bool reordering_queue;
+    TorrentDirLoader *loader;
+    bool loading;
+    TorrentSnapshot snapshot;
+    QTimer snapshot_timer;
+    QThread *snapshot_writer;
+    StatsJournal *stats_journal;
+    QTimer journal_timer;
+    QElapsedTimer load_timer;
+    QList<QPair<QString, QByteArray>> deferred_torrents; // dormant torrents without a snapshot entry, loaded after the active ones
+    QHash<bt::SHA1Hash, QString> dormant_dirs; // torX dirs of the dormant torrents, which are shown from the snapshot
+
+    /// A torrent which was added while the existing torrents were still being loaded
+    struct PendingLoad {
+        QByteArray data;
+        QString dir;
+        QString group;
+        bool silently;
+        QUrl url;
+        QString move_on_completion;
+    };
+    QList<PendingLoad> pending_loads;
+    qint64 scan_time;
+    qint64 read_time;
+    qint64 construct_time;
 };
 }
 
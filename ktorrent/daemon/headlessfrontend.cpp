@@ -0,0 +1,152 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "headlessfrontend.h"
+
+#include <KIO/Job>
+
+#include <interfaces/torrentinterface.h>
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+/// Status bar which writes its messages to the log
+class LogStatusBar : public StatusBarInterface
+{
+public:
+    void message(const QString &msg) override
+    {
+        Out(SYS_GEN | LOG_NOTICE) << msg << endl;
+    }
+
+    QProgressBar *createProgressBar() override
+    {
+        return nullptr;
+    }
+
+    void removeProgressBar(QProgressBar *pb) override
+    {
+        Q_UNUSED(pb);
+    }
+};
+
+HeadlessFrontend::HeadlessFrontend()
+    : dbus_iface(nullptr)
+    , status_bar(new LogStatusBar())
+{
+}
+
+HeadlessFrontend::~HeadlessFrontend()
+{
+    delete status_bar;
+}
+
+void HeadlessFrontend::addActivity(Activity *act)
+{
+    Q_UNUSED(act);
+}
+
+void HeadlessFrontend::removeActivity(Activity *act)
+{
+    Q_UNUSED(act);
+}
+
+void HeadlessFrontend::setCurrentActivity(Activity *act)
+{
+    Q_UNUSED(act);
+}
+
+void HeadlessFrontend::addPrefPage(PrefPageInterface *page)
+{
+    Q_UNUSED(page);
+}
+
+void HeadlessFrontend::removePrefPage(PrefPageInterface *page)
+{
+    Q_UNUSED(page);
+}
+
+void HeadlessFrontend::mergePluginGui(Plugin *p)
+{
+    Q_UNUSED(p);
+}
+
+void HeadlessFrontend::removePluginGui(Plugin *p)
+{
+    Q_UNUSED(p);
+}
+
+void HeadlessFrontend::errorMsg(const QString &err)
+{
+    Out(SYS_GEN | LOG_IMPORTANT) << "Error: " << err << endl;
+}
+
+void HeadlessFrontend::errorMsg(KIO::Job *j)
+{
+    if (j->error())
+        Out(SYS_GEN | LOG_IMPORTANT) << "Error: " << j->errorString() << endl;
+}
+
+void HeadlessFrontend::infoMsg(const QString &info)
+{
+    Out(SYS_GEN | LOG_NOTICE) << info << endl;
+}
+
+StatusBarInterface *HeadlessFrontend::getStatusBar()
+{
+    return status_bar;
+}
+
+bool HeadlessFrontend::selectFiles(bt::TorrentInterface *tc,
+                                   const QString &group,
+                                   const QString &location,
+                                   bool *start,
+                                   bool *skip_check,
+                                   QString *selected_group)
+{
+    // load everything, like opening a torrent silently
+    Q_UNUSED(tc);
+    Q_UNUSED(location);
+    *start = true;
+    *skip_check = false;
+    *selected_group = group;
+    return true;
+}
+
+void HeadlessFrontend::errorList(const QString &err, const QStringList &items)
+{
+    Out(SYS_GEN | LOG_IMPORTANT) << "Error: " << err << " " << items.join(QStringLiteral(", ")) << endl;
+}
+
+bool HeadlessFrontend::retryUnmounted(const QString &msg, const QStringList &not_mounted)
+{
+    Out(SYS_GEN | LOG_IMPORTANT) << msg << " " << not_mounted.join(QStringLiteral(", ")) << endl;
+    return false;
+}
+
+bool HeadlessFrontend::startAnyway(const QString &msg, const QString &caption, const QStringList &names)
+{
+    // nobody to ask, the limits are respected
+    Q_UNUSED(caption);
+    Out(SYS_GEN | LOG_NOTICE) << msg << " " << names.join(QStringLiteral(", ")) << " (not started)" << endl;
+    return false;
+}
+
+FrontendInterface::MissingFilesAction HeadlessFrontend::missingFiles(const QString &msg, const QStringList &missing, bt::TorrentInterface *tc)
+{
+    // never recreate or deselect files behind the back of the user, the torrent gets an error instead
+    Q_UNUSED(tc);
+    Out(SYS_GEN | LOG_IMPORTANT) << msg << " " << missing.join(QStringLiteral(", ")) << endl;
+    return CANCEL;
+}
+
+void HeadlessFrontend::updateActions()
+{
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_HEADLESSFRONTEND_H
+#define KT_HEADLESSFRONTEND_H
+
+#include "frontendinterface.h"
+
+namespace kt
+{
+/**
+ * Frontend of the headless daemon. There is nobody to ask questions to,
+ * so every question gets the answer which leaves the data alone, and
+ * messages go to the log.
+ */
+class HeadlessFrontend : public FrontendInterface
+{
+public:
+    HeadlessFrontend();
+    ~HeadlessFrontend() override;
+
+    /// Set the DBus interface, which is created after the Core
+    void setDBusInterface(DBus *iface)
+    {
+        dbus_iface = iface;
+    }
+
+    // Stuff implemented from GUIInterface
+    KMainWindow *getMainWindow() override
+    {
+        return nullptr;
+    }
+    void addActivity(Activity *act) override;
+    void removeActivity(Activity *act) override;
+    void setCurrentActivity(Activity *act) override;
+    void addPrefPage(PrefPageInterface *page) override;
+    void removePrefPage(PrefPageInterface *page) override;
+    void mergePluginGui(Plugin *p) override;
+    void removePluginGui(Plugin *p) override;
+    void errorMsg(const QString &err) override;
+    void errorMsg(KIO::Job *j) override;
+    void infoMsg(const QString &info) override;
+    StatusBarInterface *getStatusBar() override;
+    TorrentActivityInterface *getTorrentActivity() override
+    {
+        return nullptr;
+    }
+
+    // Stuff implemented from FrontendInterface
+    bool isHeadless() const override
+    {
+        return true;
+    }
+    bool selectFiles(bt::TorrentInterface *tc, const QString &group, const QString &location, bool *start, bool *skip_check, QString *selected_group) override;
+    void errorList(const QString &err, const QStringList &items) override;
+    bool retryUnmounted(const QString &msg, const QStringList &not_mounted) override;
+    bool startAnyway(const QString &msg, const QString &caption, const QStringList &names) override;
+    MissingFilesAction missingFiles(const QString &msg, const QStringList &missing, bt::TorrentInterface *tc) override;
+    void updateActions() override;
+    DBus *getDBusInterface() override
+    {
+        return dbus_iface;
+    }
+
+private:
+    DBus *dbus_iface;
+    StatusBarInterface *status_bar;
+};
+
+}
+
+#endif
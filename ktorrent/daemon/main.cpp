@@ -0,0 +1,126 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <csignal>
+#include <cstdio>
+#include <exception>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <KAboutData>
+#include <KDBusService>
+#include <KLocalizedString>
+
+#include "core.h"
+#include "headlessfrontend.h"
+#include <dbus/dbus.h>
+#include <interfaces/functions.h>
+#include <torrent/globals.h>
+
+#include "ktversion.h"
+#include "version.h"
+#include <util/error.h>
+#include <util/functions.h>
+#include <util/log.h>
+#ifndef Q_OS_WIN
+#include <util/signalcatcher.h>
+#endif
+
+using namespace bt;
+
+int main(int argc, char **argv)
+{
+    // ignore SIGPIPE and SIGXFSZ
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGXFSZ, SIG_IGN);
+
+    if (!bt::InitLibKTorrent()) {
+        fprintf(stderr, "Failed to initialize libktorrent\n");
+        return -1;
+    }
+
+    bt::SetClientInfo(QStringLiteral("KTorrent"), kt::MAJOR, kt::MINOR, kt::RELEASE, kt::VERSION_TYPE, QStringLiteral("KT"));
+    KLocalizedString::setApplicationDomain("ktorrent");
+
+    QCoreApplication app(argc, argv);
+
+    // same component name as the GUI, so both use the same settings and torrents
+    QCommandLineParser parser;
+    KAboutData about(QStringLiteral("ktorrent"),
+                     i18nc("@title", "KTorrent"),
+                     QStringLiteral(VERSION),
+                     i18n("Bittorrent client by KDE, running without a GUI"),
+                     KAboutLicense::GPL,
+                     i18nc("@info:credit", "(C) 2005 - 2011 Joris Guisson and Ivan Vasic"),
+                     QString(),
+                     QStringLiteral("http://www.kde.org/applications/internet/ktorrent/"));
+    about.setOrganizationDomain(QByteArray("kde.org"));
+
+    KAboutData::setApplicationData(about);
+    about.setupCommandLine(&parser);
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("verbose"), i18n("Enable logging to standard output")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("+[URL]"), i18n("Torrent to open")));
+    parser.process(app);
+    about.processCommandLine(&parser);
+
+    // only one KTorrent, with or without a GUI, can use the torrents at the same time
+    const KDBusService dbusService(KDBusService::Unique);
+
+    try {
+#ifndef Q_OS_WIN
+        bt::SignalCatcher catcher;
+        catcher.catchSignal(SIGINT);
+        catcher.catchSignal(SIGTERM);
+        QObject::connect(&catcher, &bt::SignalCatcher::triggered, &app, &QCoreApplication::quit);
+#endif
+
+        const bool logToStdout = parser.isSet(QStringLiteral("verbose"));
+        bt::InitLog(kt::DataDir(kt::CreateIfNotExists) + QLatin1String("log"), true, true, logToStdout);
+
+        kt::HeadlessFrontend frontend;
+        kt::Core core(&frontend);
+        core.loadTorrents();
+
+        kt::DBus dbus_iface(&frontend, &core, nullptr);
+        frontend.setDBusInterface(&dbus_iface);
+        core.loadPlugins();
+        core.startUpdateTimer();
+
+        auto handleCmdLine = [&core, &parser](const QStringList &arguments, const QString &workingDirectory) {
+            if (!arguments.isEmpty())
+                parser.parse(arguments);
+
+            QString oldCurrent = QDir::currentPath();
+            if (!workingDirectory.isEmpty())
+                QDir::setCurrent(workingDirectory);
+
+            const auto positionalArguments = parser.positionalArguments();
+            for (const QString &filePath : positionalArguments) {
+                QUrl url = QFile::exists(filePath) ? QUrl::fromLocalFile(filePath) : QUrl(filePath);
+                core.loadSilently(url, QString());
+            }
+
+            if (!workingDirectory.isEmpty())
+                QDir::setCurrent(oldCurrent);
+        };
+        QObject::connect(&dbusService, &KDBusService::activateRequested, handleCmdLine);
+        handleCmdLine(QStringList(), QString());
+
+        app.exec();
+    } catch (bt::Error &err) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Uncaught exception: " << err.toString() << endl;
+    } catch (std::exception &err) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Uncaught exception: " << err.what() << endl;
+    } catch (...) {
+        Out(SYS_GEN | LOG_IMPORTANT) << "Uncaught unknown exception " << endl;
+    }
+    bt::Globals::cleanup();
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_FRONTENDINTERFACE_H
+#define KT_FRONTENDINTERFACE_H
+
+#include <QStringList>
+
+#include <interfaces/guiinterface.h>
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+class DBus;
+
+/**
+ * Everything the Core needs from the program it runs in. The GUI implements
+ * it with dialogs, the headless daemon never asks anything and logs instead.
+ */
+class FrontendInterface : public GUIInterface
+{
+public:
+    ~FrontendInterface() override
+    {
+    }
+
+    /// What to do about missing data files
+    enum MissingFilesAction {
+        RECREATE,
+        DO_NOT_DOWNLOAD,
+        CANCEL,
+        NEW_LOCATION_SELECTED,
+    };
+
+    /// Whether or not there is a user to ask questions to
+    virtual bool isHeadless() const = 0;
+
+    /**
+     * Let the user select the files, location and group of a torrent which is being loaded.
+     * @param tc The torrent
+     * @param group Suggested group
+     * @param location Suggested location
+     * @param start Set to true if the torrent should be started
+     * @param skip_check Set to true if the data check of existing files should be skipped
+     * @param selected_group Set to the group the user selected
+     * @return false if the torrent should not be loaded after all
+     */
+    virtual bool selectFiles(bt::TorrentInterface *tc, const QString &group, const QString &location, bool *start, bool *skip_check, QString *selected_group) = 0;
+
+    /// Show an error message about a list of items
+    virtual void errorList(const QString &err, const QStringList &items) = 0;
+
+    /**
+     * Storage volumes of a torrent are not mounted.
+     * @return true if mounting should be checked again, false to give up
+     */
+    virtual bool retryUnmounted(const QString &msg, const QStringList &not_mounted) = 0;
+
+    /**
+     * Ask whether torrents should be started although they are over their limits or short on disk space.
+     * @param msg The question
+     * @param caption The caption, can be empty
+     * @param names Names of the torrents, empty when the question is about one torrent
+     * @return true to start them anyway
+     */
+    virtual bool startAnyway(const QString &msg, const QString &caption, const QStringList &names) = 0;
+
+    /// Ask what to do about the missing data files of a torrent
+    virtual MissingFilesAction missingFiles(const QString &msg, const QStringList &missing, bt::TorrentInterface *tc) = 0;
+
+    /// The state of torrents changed, update everything which depends on it
+    virtual void updateActions() = 0;
+
+    /// Get the DBus interface
+    virtual DBus *getDBusInterface() = 0;
+};
+
+}
+
+#endif
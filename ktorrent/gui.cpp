@@ -57,7 +57,9 @@
 
 #include "core.h"
 #include "dbus/dbus.h"
+#include "dialogs/fileselectdlg.h"
 #include "dialogs/importdialog.h"
+#include "dialogs/missingfilesdlg.h"
 #include "dialogs/pastedialog.h"
 #include "dialogs/torrentcreatordlg.h"
 #include "groups/groupview.h"
@@ -246,6 +248,52 @@ void GUI::infoMsg(const QString &info)
     KMessageBox::information(this, info);
 }
 
+bool GUI::selectFiles(bt::TorrentInterface *tc, const QString &group, const QString &location, bool *start, bool *skip_check, QString *selected_group)
+{
+    FileSelectDlg dlg(core->getQueueManager(), core->getGroupManager(), group, this);
+    dlg.loadState(KSharedConfig::openConfig());
+    bool ret = dlg.execute(tc, start, skip_check, location) == QDialog::Accepted;
+    dlg.saveState(KSharedConfig::openConfig());
+    if (ret)
+        *selected_group = dlg.selectedGroup();
+    return ret;
+}
+
+void GUI::errorList(const QString &err, const QStringList &items)
+{
+    KMessageBox::errorList(this, err, items);
+}
+
+bool GUI::retryUnmounted(const QString &msg, const QStringList &not_mounted)
+{
+    KGuiItem retry(i18n("Retry"), QStringLiteral("emblem-mounted"));
+    return KMessageBox::warningContinueCancelList(this, msg, not_mounted, QString(), retry) == KMessageBox::Continue;
+}
+
+bool GUI::startAnyway(const QString &msg, const QString &caption, const QStringList &names)
+{
+    if (names.isEmpty())
+        return KMessageBox::questionYesNo(this, msg, caption) == KMessageBox::Yes;
+    else
+        return KMessageBox::questionYesNoList(this, msg, names, caption) == KMessageBox::Yes;
+}
+
+FrontendInterface::MissingFilesAction GUI::missingFiles(const QString &msg, const QStringList &missing, bt::TorrentInterface *tc)
+{
+    MissingFilesDlg dlg(msg, missing, tc, this);
+    switch (dlg.execute()) {
+    case MissingFilesDlg::RECREATE:
+        return RECREATE;
+    case MissingFilesDlg::DO_NOT_DOWNLOAD:
+        return DO_NOT_DOWNLOAD;
+    case MissingFilesDlg::NEW_LOCATION_SELECTED:
+        return NEW_LOCATION_SELECTED;
+    case MissingFilesDlg::CANCEL:
+    default:
+        return CANCEL;
+    }
+}
+
 void GUI::load(const QUrl &url)
 {
     core->load(url, QString());
@@ -26,9 +26,10 @@
 #include <KSharedConfig>
 #include <QTimer>
 
-#include <interfaces/guiinterface.h>
 #include <util/constants.h>
 
+#include "frontendinterface.h"
+
 class QAction;
 class KToggleAction;
 
@@ -42,17 +43,27 @@ class DBus;
 class TorrentActivity;
 class CentralWidget;
 
-class GUI : public KParts::MainWindow, public GUIInterface
+class GUI : public KParts::MainWindow, public FrontendInterface
 {
     Q_OBJECT
 public:
     GUI();
     ~GUI() override;
 
-    DBus *getDBusInterface()
+    // Stuff implemented from FrontendInterface
+    DBus *getDBusInterface() override
     {
         return dbus_iface;
     }
+    bool isHeadless() const override
+    {
+        return false;
+    }
+    bool selectFiles(bt::TorrentInterface *tc, const QString &group, const QString &location, bool *start, bool *skip_check, QString *selected_group) override;
+    void errorList(const QString &err, const QStringList &items) override;
+    bool retryUnmounted(const QString &msg, const QStringList &not_mounted) override;
+    bool startAnyway(const QString &msg, const QString &caption, const QStringList &names) override;
+    MissingFilesAction missingFiles(const QString &msg, const QStringList &missing, bt::TorrentInterface *tc) override;
 
     // Stuff implemented from GUIInterface
     KMainWindow *getMainWindow() override
@@ -89,7 +100,7 @@ public:
 
 public Q_SLOTS:
     /// Update all actions
-    void updateActions();
+    void updateActions() override;
 
     /**
      * Enable or disable the paste action
@@ -45,6 +45,7 @@ void AdvancedPref::loadSettings()
     kcfg_requeueMagnets->setChecked(Settings::requeueMagnets());
     kcfg_requeueMagnetsTime->setEnabled(Settings::requeueMagnets());
     kcfg_requeueMagnetsTime->setValue(Settings::requeueMagnetsTime());
+    kcfg_magnetMetadataCacheSize->setValue(Settings::magnetMetadataCacheSize());
     kcfg_trackerListUrl->setText(Settings::trackerListUrl());
 }
 
@@ -29,6 +29,7 @@ QMPref::QMPref(QWidget *parent)
     setupUi(this);
     connect(kcfg_manuallyControlTorrents, &QCheckBox::toggled, this, &QMPref::onControlTorrentsManuallyToggled);
     kcfg_stallTimer->setSuffix(i18n(" min"));
+    kcfg_seedRotationInterval->setSuffix(i18n(" min"));
 }
 
 QMPref::~QMPref()
@@ -40,7 +41,10 @@ void QMPref::loadSettings()
     kcfg_stallTimer->setEnabled(Settings::decreasePriorityOfStalledTorrents() && !Settings::manuallyControlTorrents());
     kcfg_maxDownloads->setDisabled(Settings::manuallyControlTorrents());
     kcfg_maxSeeds->setDisabled(Settings::manuallyControlTorrents());
+    kcfg_maxDownloadsPerDevice->setDisabled(Settings::manuallyControlTorrents());
+    kcfg_adaptiveDownloadSlots->setDisabled(Settings::manuallyControlTorrents());
     kcfg_decreasePriorityOfStalledTorrents->setDisabled(Settings::manuallyControlTorrents());
+    kcfg_seedRotationInterval->setEnabled(Settings::rotateSeeds());
 }
 
 void QMPref::loadDefaults()
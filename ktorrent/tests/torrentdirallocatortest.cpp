@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <util/log.h>
+
+#include "torrentdirallocator.h"
+
+using namespace kt;
+
+class TorrentDirAllocatorTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("torrentdirallocatortest.log"), false, false);
+        QVERIFY(tmp.isValid());
+        dir = tmp.path() + QLatin1Char('/');
+    }
+
+    void testHoles()
+    {
+        TorrentDirAllocator alloc;
+        alloc.reset(dir, QStringList() << QStringLiteral("tor0") << QStringLiteral("tor2") << QStringLiteral("tor5") << QStringLiteral("magnets"));
+
+        QCOMPARE(alloc.allocate(), tor(1));
+        QCOMPARE(alloc.allocate(), tor(3));
+        QCOMPARE(alloc.allocate(), tor(4));
+        QCOMPARE(alloc.allocate(), tor(6));
+        QCOMPARE(alloc.allocate(), tor(7));
+    }
+
+    void testRelease()
+    {
+        TorrentDirAllocator alloc;
+        alloc.reset(dir, QStringList());
+        for (int i = 0; i < 5; i++)
+            QCOMPARE(alloc.allocate(), tor(i));
+
+        alloc.release(tor(2));
+        alloc.release(dir + QLatin1String("tor3"));
+        QCOMPARE(alloc.allocate(), tor(2));
+        QCOMPARE(alloc.allocate(), tor(3));
+
+        // releasing the highest dirs shrinks the range
+        alloc.release(tor(4));
+        alloc.release(tor(3));
+        QCOMPARE(alloc.allocate(), tor(3));
+        QCOMPARE(alloc.allocate(), tor(4));
+        QCOMPARE(alloc.allocate(), tor(5));
+
+        // unknown dirs are ignored
+        alloc.release(tor(100));
+        alloc.release(dir + QLatin1String("magnets"));
+        QCOMPARE(alloc.allocate(), tor(6));
+    }
+
+    void testExisting()
+    {
+        TorrentDirAllocator alloc;
+        alloc.reset(dir, QStringList());
+
+        // dirs created behind the back of the allocator are skipped
+        QVERIFY(QDir().mkpath(tor(0)));
+        QVERIFY(QDir().mkpath(tor(1)));
+        QCOMPARE(alloc.allocate(), tor(2));
+        QCOMPARE(alloc.allocate(), tor(3));
+    }
+
+private:
+    QString tor(int n) const
+    {
+        return dir + QLatin1String("tor") + QString::number(n) + QLatin1Char('/');
+    }
+
+private:
+    QTemporaryDir tmp;
+    QString dir;
+};
+
+QTEST_MAIN(TorrentDirAllocatorTest)
+
+#include "torrentdirallocatortest.moc"
@@ -24,6 +24,8 @@
 #include <QIcon>
 #include <QTextStream>
 
+#include <algorithm>
+
 #include <bcodec/bdecoder.h>
 #include <bcodec/bencoder.h>
 #include <bcodec/bnode.h>
@@ -36,60 +38,145 @@ namespace kt
 {
 MagnetModel::MagnetModel(MagnetManager *magnetManager, QObject *parent)
     : QAbstractTableModel(parent)
-    , currentRows(0)
     , mman(magnetManager)
 {
-    connect(mman.data(), &MagnetManager::updateQueue, this, &MagnetModel::onUpdateQueue);
+    const QList<bt::Uint32> magnets = mman->magnets();
+    for (bt::Uint32 id : magnets) {
+        rows.insert(id, ids.size());
+        ids.append(id);
+    }
+
+    connect(mman.data(), &MagnetManager::magnetAdded, this, &MagnetModel::onMagnetAdded);
+    connect(mman.data(), &MagnetManager::magnetsAdded, this, &MagnetModel::onMagnetsAdded);
+    connect(mman.data(), &MagnetManager::magnetRemoved, this, &MagnetModel::onMagnetRemoved);
+    connect(mman.data(), &MagnetManager::magnetChanged, this, &MagnetModel::onMagnetChanged);
 }
 
 MagnetModel::~MagnetModel()
 {
 }
 
-void MagnetModel::removeMagnets(int row, int count)
+QList<bt::Uint32> MagnetModel::magnetIds(const QList<int> &rows) const
 {
-    mman->removeMagnets(row, count);
+    QList<bt::Uint32> ret;
+    for (int row : rows) {
+        if (bt::Uint32 id = magnetId(row))
+            ret.append(id);
+    }
+    return ret;
 }
 
-void MagnetModel::start(int row, int count)
+void MagnetModel::removeMagnets(const QList<int> &rows)
 {
-    mman->start(row, count);
+    mman->removeMagnets(magnetIds(rows));
 }
 
-void MagnetModel::stop(int row, int count)
+void MagnetModel::start(const QList<int> &rows)
 {
-    mman->stop(row, count);
+    mman->start(magnetIds(rows));
+}
+
+void MagnetModel::stop(const QList<int> &rows)
+{
+    mman->stop(magnetIds(rows));
 }
 
 bool MagnetModel::isStopped(int row) const
 {
-    return mman->isStopped(row);
+    return mman->isStopped(magnetId(row));
+}
+
+bt::Uint32 MagnetModel::magnetId(int row) const
+{
+    if (row < 0 || row >= ids.size())
+        return 0;
+    else
+        return ids.at(row);
+}
+
+int MagnetModel::rowOf(bt::Uint32 id) const
+{
+    QHash<bt::Uint32, int>::const_iterator i = rows.constFind(id);
+    if (i == rows.constEnd())
+        return -1;
+
+    // every removed row before the stored one moved it up by one
+    const int row = i.value();
+    return row - (std::lower_bound(removed_rows.cbegin(), removed_rows.cend(), row) - removed_rows.cbegin());
+}
+
+void MagnetModel::renumber()
+{
+    if (removed_rows.isEmpty())
+        return;
+
+    for (int i = 0; i < ids.size(); ++i)
+        rows[ids.at(i)] = i;
+    removed_rows.clear();
+}
+
+void MagnetModel::onMagnetAdded(bt::Uint32 id)
+{
+    renumber();
+    int row = ids.size();
+    beginInsertRows(QModelIndex(), row, row);
+    rows.insert(id, row);
+    ids.append(id);
+    endInsertRows();
 }
 
-void MagnetModel::onUpdateQueue(bt::Uint32 idx, bt::Uint32 count)
+void MagnetModel::onMagnetsAdded(const QList<bt::Uint32> &added)
 {
-    int rows = mman->count();
-    if (currentRows < rows) // add new rows
-        insertRows(idx, rows - currentRows, QModelIndex());
-    else if (currentRows > rows) // delete rows
-        removeRows(idx, currentRows - rows, QModelIndex());
+    renumber();
+    int row = ids.size();
+    beginInsertRows(QModelIndex(), row, row + added.size() - 1);
+    ids.reserve(row + added.size());
+    for (bt::Uint32 id : added) {
+        rows.insert(id, ids.size());
+        ids.append(id);
+    }
+    endInsertRows();
+}
 
-    currentRows = rows;
-    Q_EMIT dataChanged(index(idx, 0), index(count, columnCount(QModelIndex())));
+void MagnetModel::onMagnetRemoved(bt::Uint32 id)
+{
+    int row = rowOf(id);
+    if (row < 0)
+        return;
+
+    // The rows after it are not renumbered now, rowOf corrects for the removed rows
+    // until the next magnet is added. So removing many magnets does not renumber
+    // the rows after each of them.
+    const int stored = rows.take(id);
+    beginRemoveRows(QModelIndex(), row, row);
+    ids.remove(row);
+    removed_rows.insert(std::lower_bound(removed_rows.begin(), removed_rows.end(), stored), stored);
+    endRemoveRows();
+}
+
+void MagnetModel::onMagnetChanged(bt::Uint32 id)
+{
+    int row = rowOf(id);
+    if (row >= 0)
+        Q_EMIT dataChanged(index(row, 1), index(row, 2));
 }
 
 QVariant MagnetModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || index.row() < 0 || index.row() >= mman->count())
+    if (!index.isValid() || index.row() < 0 || index.row() >= ids.size())
+        return QVariant();
+
+    bt::Uint32 id = ids.at(index.row());
+    const MagnetDownloader *md = mman->getMagnetDownloader(id);
+    if (!md)
         return QVariant();
 
-    const MagnetDownloader *md = mman->getMagnetDownloader(index.row());
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
         case 0:
             return displayName(md);
         case 1:
-            return status(index.row());
+            return status(id);
         case 2:
             return md->numPeers();
         default:
@@ -137,26 +224,10 @@ int MagnetModel::columnCount(const QModelIndex &parent) const
 
 int MagnetModel::rowCount(const QModelIndex &parent) const
 {
-    if (parent.isValid() || !mman)
+    if (parent.isValid())
         return 0;
     else
-        return mman->count();
-}
-
-bool MagnetModel::insertRows(int row, int count, const QModelIndex &parent)
-{
-    Q_UNUSED(parent);
-    beginInsertRows(QModelIndex(), row, row + count - 1);
-    endInsertRows();
-    return true;
-}
-
-bool MagnetModel::removeRows(int row, int count, const QModelIndex &parent)
-{
-    Q_UNUSED(parent);
-    beginRemoveRows(QModelIndex(), row, row + count - 1);
-    endRemoveRows();
-    return true;
+        return ids.size();
 }
 
 QString MagnetModel::displayName(const bt::MagnetDownloader *md) const
@@ -167,9 +238,9 @@ QString MagnetModel::displayName(const bt::MagnetDownloader *md) const
         return md->magnetLink().displayName();
 }
 
-QString MagnetModel::status(int row) const
+QString MagnetModel::status(bt::Uint32 id) const
 {
-    switch (mman->status(row)) {
+    switch (mman->status(id)) {
     case MagnetManager::DOWNLOADING:
         return i18n("Downloading");
 
@@ -22,7 +22,9 @@
 #define KT_MAGNETMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QPointer>
+#include <QVector>
 #include <util/constants.h>
 
 namespace bt
@@ -41,35 +43,44 @@ public:
     MagnetModel(MagnetManager *magnetManager, QObject *parent = 0);
     ~MagnetModel() override;
 
-    /// Remove a magnet downloader
-    void removeMagnets(int row, int count);
+    /// Remove the magnet downloaders of a list of rows
+    void removeMagnets(const QList<int> &rows);
 
-    /// Start a magnet downloader
-    void start(int row, int count);
+    /// Start the magnet downloaders of a list of rows
+    void start(const QList<int> &rows);
 
-    /// Stop a magnet downloader
-    void stop(int row, int count);
+    /// Stop the magnet downloaders of a list of rows
+    void stop(const QList<int> &rows);
 
     /// Check if the magnet downloader that correspond to row is stopped
     bool isStopped(int row) const;
 
+    /// Get the id in the MagnetManager of the magnet shown in row, 0 if the row is invalid
+    bt::Uint32 magnetId(int row) const;
+
     QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-    bool removeRows(int row, int count, const QModelIndex &parent) override;
-    bool insertRows(int row, int count, const QModelIndex &parent) override;
 
-public Q_SLOTS:
-    void onUpdateQueue(bt::Uint32 idx, bt::Uint32 count);
+private Q_SLOTS:
+    void onMagnetAdded(bt::Uint32 id);
+    void onMagnetsAdded(const QList<bt::Uint32> &added);
+    void onMagnetRemoved(bt::Uint32 id);
+    void onMagnetChanged(bt::Uint32 id);
 
 private:
     QString displayName(const bt::MagnetDownloader *md) const;
-    QString status(int row) const;
+    QString status(bt::Uint32 id) const;
+    QList<bt::Uint32> magnetIds(const QList<int> &rows) const;
+    int rowOf(bt::Uint32 id) const;
+    void renumber();
 
 private:
-    int currentRows;
     QPointer<MagnetManager> mman;
+    QVector<bt::Uint32> ids;
+    QHash<bt::Uint32, int> rows;
+    QVector<int> removed_rows; // sorted, rows as stored in rows which were removed since the last renumbering
 };
 
 }
@@ -56,7 +56,7 @@ MagnetView::MagnetView(MagnetManager *magnetManager, QWidget *parent)
     view->setSelectionBehavior(QAbstractItemView::SelectRows);
     view->setSortingEnabled(false);
     view->setAllColumnsShowFocus(true);
-    view->setSelectionMode(QAbstractItemView::ContiguousSelection);
+    view->setSelectionMode(QAbstractItemView::ExtendedSelection);
     view->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(view, &QTreeView::customContextMenuRequested, this, &MagnetView::showContextMenu);
     layout->addWidget(view);
@@ -99,7 +99,7 @@ void MagnetView::showContextMenu(QPoint p)
     remove->setEnabled(idx_list.count() > 0);
 
     for (const QModelIndex &idx : idx_list) {
-        if (!mman->isStopped(idx.row()))
+        if (!model->isStopped(idx.row()))
             stop->setEnabled(true);
         else
             start->setEnabled(true);
@@ -109,35 +109,44 @@ void MagnetView::showContextMenu(QPoint p)
 
 void MagnetView::removeMagnetDownload()
 {
-    QModelIndexList idx_list = view->selectionModel()->selectedRows();
-    if (!idx_list.isEmpty())
-        mman->removeMagnets(idx_list.front().row(), idx_list.size());
+    const QList<int> rows = selectedRows();
+    if (!rows.isEmpty())
+        model->removeMagnets(rows);
 }
 
 void MagnetView::startMagnetDownload()
 {
-    QModelIndexList idx_list = view->selectionModel()->selectedRows();
-    if (!idx_list.isEmpty()) {
-        mman->start(idx_list.front().row(), idx_list.size());
+    const QList<int> rows = selectedRows();
+    if (!rows.isEmpty()) {
+        model->start(rows);
         view->clearSelection();
     }
 }
 
 void MagnetView::stopMagnetDownload()
 {
-    QModelIndexList idx_list = view->selectionModel()->selectedRows();
-    if (!idx_list.isEmpty()) {
-        mman->stop(idx_list.front().row(), idx_list.size());
+    const QList<int> rows = selectedRows();
+    if (!rows.isEmpty()) {
+        model->stop(rows);
         view->clearSelection();
     }
 }
 
+QList<int> MagnetView::selectedRows() const
+{
+    QList<int> rows;
+    const QModelIndexList idx_list = view->selectionModel()->selectedRows();
+    for (const QModelIndex &idx : idx_list)
+        rows.append(idx.row());
+    return rows;
+}
+
 void MagnetView::copyMagnetUrl()
 {
     QStringList sl;
     const QModelIndexList idx_list = view->selectionModel()->selectedRows();
     for (const QModelIndex &idx : idx_list) {
-        if (const MagnetDownloader *md = mman->getMagnetDownloader(idx.row())) {
+        if (const MagnetDownloader *md = mman->getMagnetDownloader(model->magnetId(idx.row()))) {
             sl.append(md->magnetLink().toString());
         }
     }
@@ -54,6 +54,9 @@ private Q_SLOTS:
     void stopMagnetDownload();
     void copyMagnetUrl();
 
+private:
+    QList<int> selectedRows() const;
+
 private:
     MagnetManager *mman;
     MagnetModel *model;
@@ -245,7 +245,7 @@ QVariant QueueManagerModel::data(const QModelIndex &index, int role) const
                 return QVariant();
         } break;
         case 4:
-            return tc->getPriority();
+            return qman->queuePriority(tc);
         default:
             return QVariant();
         }
@@ -339,9 +339,7 @@ bool QueueManagerModel::dropMimeData(const QMimeData *data, Qt::DropAction actio
         }
     }
 
-    updatePriorities();
-    // reorder the queue
-    qman->orderQueue();
+    updatePriorities(from, count);
     endResetModel();
     return true;
 }
@@ -371,10 +369,8 @@ void QueueManagerModel::moveUp(int row, int count)
         swapItems(row + i, row + i - 1);
     }
 
-    updatePriorities();
+    updatePriorities(row - 1, count);
     // dumpQueue();
-    // reorder the queue
-    qman->orderQueue();
     endResetModel();
 }
 
@@ -387,10 +383,8 @@ void QueueManagerModel::moveDown(int row, int count)
         swapItems(row + i, row + i + 1);
     }
 
-    updatePriorities();
+    updatePriorities(row + 1, count);
     // dumpQueue();
-    // reorder the queue
-    qman->orderQueue();
     endResetModel();
 }
 
@@ -406,10 +400,8 @@ void QueueManagerModel::moveTop(int row, int count)
         row--;
     }
 
-    updatePriorities();
+    updatePriorities(0, count);
     // dumpQueue();
-    // reorder the queue
-    qman->orderQueue();
     endResetModel();
 }
 
@@ -425,10 +417,8 @@ void QueueManagerModel::moveBottom(int row, int count)
         row++;
     }
 
-    updatePriorities();
+    updatePriorities(row, count);
     // dumpQueue();
-    // reorder the queue
-    qman->orderQueue();
     endResetModel();
 }
 
@@ -441,11 +431,11 @@ void QueueManagerModel::dumpQueue()
     }
 }
 
-void QueueManagerModel::updatePriorities()
+void QueueManagerModel::updatePriorities(int row, int count)
 {
-    int idx = queue.size();
-    for (const Item &i : qAsConst(queue))
-        i.tc->setPriority(idx--);
+    // place the moved items right after the item above them, this will also reorder the queue
+    for (int i = qMax(row, 0); i < row + count && i < queue.count(); i++)
+        qman->moveAfter(queue.at(i).tc, i > 0 ? queue.at(i - 1).tc : nullptr);
 }
 
 void QueueManagerModel::update()
@@ -125,7 +125,7 @@ private:
     void updateQueue();
     void swapItems(int a, int b);
     void dumpQueue();
-    void updatePriorities();
+    void updatePriorities(int row, int count);
     void softReset();
 
 private:
@@ -36,6 +36,7 @@
 #include "gui.h"
 #include "tools/magnetview.h"
 #include "tools/queuemanagerwidget.h"
+#include "torrent/datacheckscheduler.h"
 #include "torrent/queuemanager.h"
 #include "view/torrentsearchbar.h"
 #include "view/view.h"
@@ -68,6 +69,7 @@ TorrentActivity::TorrentActivity(Core *core, GUI *gui, QWidget *parent)
 
     group_switcher = new GroupSwitcher(view, core->getGroupManager(), this);
     connect(core->getQueueManager(), &QueueManager::queueOrdered, this, &TorrentActivity::queueOrdered);
+    connect(core, &Core::allTorrentsLoaded, this, &TorrentActivity::queueOrdered);
 
     QVBoxLayout *vlayout = new QVBoxLayout(view_part);
     vlayout->setSpacing(0);
@@ -105,6 +107,10 @@ TorrentActivity::TorrentActivity(Core *core, GUI *gui, QWidget *parent)
     connect(qman, &QueueManager::suspendStateChanged, this, &TorrentActivity::onSuspendedStateChanged);
 
     queue_suspend_action->setChecked(core->getSuspendedState());
+
+    DataCheckScheduler *dcs = core->getDataCheckScheduler();
+    connect(dcs, &DataCheckScheduler::pausedChanged, pause_data_checks_action, &KToggleAction::setChecked);
+    pause_data_checks_action->setChecked(dcs->isPaused());
 }
 
 TorrentActivity::~TorrentActivity()
@@ -131,6 +137,11 @@ void TorrentActivity::setupActions()
     // KF5 queue_suspend_action->setGlobalShortcut(QKeySequence(Qt::ALT + Qt::SHIFT + Qt::Key_P));
     connect(queue_suspend_action, &KToggleAction::toggled, this, &TorrentActivity::suspendQueue);
 
+    pause_data_checks_action = new KToggleAction(QIcon::fromTheme(QStringLiteral("kt-check-data")), i18n("Pause Data Checks"), this);
+    pause_data_checks_action->setToolTip(i18n("Do not start queued data checks, running checks will be finished"));
+    ac->addAction(QStringLiteral("pause_data_checks"), pause_data_checks_action);
+    connect(pause_data_checks_action, &KToggleAction::toggled, core->getDataCheckScheduler(), &DataCheckScheduler::setPaused);
+
     show_group_view_action = new KToggleAction(QIcon::fromTheme(QStringLiteral("view-list-tree")), i18n("Group View"), this);
     show_group_view_action->setToolTip(i18n("Show or hide the group view"));
     connect(show_group_view_action, &QAction::toggled, this, &TorrentActivity::setGroupViewVisible);
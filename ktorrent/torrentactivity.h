@@ -111,6 +111,7 @@ private:
     QAction *start_all_action;
     QAction *stop_all_action;
     KToggleAction *queue_suspend_action;
+    KToggleAction *pause_data_checks_action;
     QAction *show_group_view_action;
     QAction *filter_torrent_action;
 };
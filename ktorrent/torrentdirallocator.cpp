@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "torrentdirallocator.h"
+
+#include <iterator>
+
+#include <util/fileops.h>
+
+namespace kt
+{
+TorrentDirAllocator::TorrentDirAllocator()
+    : next(0)
+{
+}
+
+int TorrentDirAllocator::number(const QString &name)
+{
+    if (!name.startsWith(QLatin1String("tor")))
+        return -1;
+
+    bool ok = false;
+    const int n = name.midRef(3).toInt(&ok);
+    return ok && n >= 0 ? n : -1;
+}
+
+void TorrentDirAllocator::reset(const QString &dir, const QStringList &names)
+{
+    data_dir = dir;
+    free_slots.clear();
+
+    std::set<int> used;
+    for (const QString &name : names) {
+        const int n = number(name);
+        if (n >= 0)
+            used.insert(n);
+    }
+
+    next = used.empty() ? 0 : *used.rbegin() + 1;
+    for (int i = 0; i < next; i++) {
+        if (used.count(i) == 0)
+            free_slots.insert(free_slots.end(), i);
+    }
+}
+
+QString TorrentDirAllocator::allocate()
+{
+    while (true) {
+        int n;
+        if (!free_slots.empty()) {
+            n = *free_slots.begin();
+            free_slots.erase(free_slots.begin());
+        } else {
+            n = next++;
+        }
+
+        // a dir might have been created behind our back, skip it if so
+        const QString dir = data_dir + QLatin1String("tor") + QString::number(n) + QLatin1Char('/');
+        if (!bt::Exists(dir))
+            return dir;
+    }
+}
+
+void TorrentDirAllocator::release(const QString &dir)
+{
+    QString d = dir;
+    if (d.endsWith(QLatin1Char('/')))
+        d.chop(1);
+
+    const int n = number(d.section(QLatin1Char('/'), -1));
+    if (n < 0 || n >= next)
+        return;
+
+    if (n == next - 1) {
+        next--;
+        // shrink the range, so the free list only holds holes
+        while (next > 0 && !free_slots.empty() && *free_slots.rbegin() == next - 1) {
+            free_slots.erase(std::prev(free_slots.end()));
+            next--;
+        }
+    } else {
+        free_slots.insert(n);
+    }
+}
+
+}
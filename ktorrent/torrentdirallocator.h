@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TORRENTDIRALLOCATOR_HH
+#define KT_TORRENTDIRALLOCATOR_HH
+
+#include <QString>
+#include <QStringList>
+
+#include <set>
+
+namespace kt
+{
+/**
+ * Hands out free torX dirs in the data dir. The used dirs are seeded from the
+ * scan done at startup, so allocating a dir does not need to probe the
+ * filesystem for every possible name.
+ */
+class TorrentDirAllocator
+{
+public:
+    TorrentDirAllocator();
+
+    /**
+     * Set the data dir and the names of the torX dirs in it.
+     * @param dir The data dir, ending with a dir separator
+     * @param names Names of the existing dirs (e.g. tor0, tor1, ...)
+     */
+    void reset(const QString &dir, const QStringList &names);
+
+    /// Change the data dir, the used dirs are moved along
+    void setDataDir(const QString &dir)
+    {
+        data_dir = dir;
+    }
+
+    /**
+     * Allocate a new torX dir.
+     * @return Path to the dir, ending with a separator
+     */
+    QString allocate();
+
+    /**
+     * Release a torX dir which is no longer used.
+     * @param dir Path to the dir
+     */
+    void release(const QString &dir);
+
+private:
+    static int number(const QString &name);
+
+private:
+    QString data_dir;
+    std::set<int> free_slots; ///< Unused numbers below next
+    int next; ///< All numbers from next onwards are unused
+};
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "torrentdirloader.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+#include <interfaces/functions.h>
+#include <util/error.h>
+#include <util/fileops.h>
+#include <util/sha1hash.h>
+
+namespace kt
+{
+class TorrentDirLoader::ReadTask : public QRunnable
+{
+public:
+    ReadTask(TorrentDirLoader *loader, const QString &dir)
+        : loader(loader)
+        , dir(dir)
+    {
+    }
+
+    void run() override
+    {
+        loader->read(dir);
+    }
+
+private:
+    TorrentDirLoader *loader;
+    QString dir;
+};
+
+TorrentDirLoader::TorrentDirLoader(const QStringList &dirs, const QHash<QString, StatsJournal::Record> &journal, bool qm_enabled, QObject *parent)
+    : QObject(parent)
+    , dirs(dirs)
+    , journal(journal)
+    , qm_enabled(qm_enabled)
+    , num_taken(0)
+    , cancelled(0)
+    , read_time(0)
+{
+    // reading is I/O bound, so use a few threads even on a single core machine
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+}
+
+TorrentDirLoader::~TorrentDirLoader()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void TorrentDirLoader::start()
+{
+    for (const QString &dir : qAsConst(dirs))
+        pool.start(new ReadTask(this, dir));
+}
+
+void TorrentDirLoader::cancel()
+{
+    cancelled.storeRelease(1);
+}
+
+void TorrentDirLoader::read(const QString &dir)
+{
+    Item item;
+    item.dir = dir;
+    item.dormant = false;
+    if (!cancelled.loadAcquire()) {
+        QElapsedTimer timer;
+        timer.start();
+        try {
+            if (bt::Exists(dir + QLatin1String("torrent"))) {
+                item.data = bt::LoadFile(dir + QLatin1String("torrent"));
+                // bring the stats file up to date if we did not exit cleanly, unless the
+                // record belongs to a removed torrent which had the same dir
+                QHash<QString, StatsJournal::Record>::const_iterator r = journal.constFind(QDir(dir).dirName());
+                bt::SHA1Hash hash;
+                bool have_hash = false;
+                if (r != journal.constEnd()) {
+                    have_hash = TorrentInfoHash(item.data, hash);
+                    if (have_hash && hash.toString() == r.value().info_hash)
+                        StatsJournal::replay(dir + QLatin1String("stats"), r.value());
+                }
+
+                // dormant torrents are known by their info hash until they are loaded
+                if (isDormant(dir + QLatin1String("stats")) && (have_hash || TorrentInfoHash(item.data, hash))) {
+                    item.dormant = true;
+                    item.info_hash = hash;
+                }
+            }
+        } catch (bt::Error &err) {
+            item.error = err.toString();
+        }
+        read_time.fetchAndAddRelaxed(timer.elapsed());
+    }
+
+    done(item);
+}
+
+bool TorrentDirLoader::isDormant(const QString &stats_file) const
+{
+    QFile fptr(stats_file);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return false;
+
+    // A torrent is dormant if nothing will start it after loading: with the queue manager
+    // enabled that is decided by QM_CAN_START, otherwise by AUTOSTART.
+    // When in doubt treat it as active.
+    const QByteArray wanted = qm_enabled ? QByteArrayLiteral("QM_CAN_START") : QByteArrayLiteral("AUTOSTART");
+    while (!fptr.atEnd()) {
+        const QByteArray line = fptr.readLine().trimmed();
+        const int eq = line.indexOf('=');
+        if (eq >= 0 && line.left(eq) == wanted)
+            return line.mid(eq + 1) == "0";
+    }
+
+    return false;
+}
+
+void TorrentDirLoader::done(const Item &item)
+{
+    QMutexLocker lock(&mutex);
+    items.append(item);
+    if (items.count() == 1)
+        Q_EMIT itemsReady();
+}
+
+QList<TorrentDirLoader::Item> TorrentDirLoader::take(int max)
+{
+    QMutexLocker lock(&mutex);
+    QList<Item> ret;
+    if (items.count() <= max) {
+        ret.swap(items);
+    } else {
+        ret = items.mid(0, max);
+        items.erase(items.begin(), items.begin() + max);
+    }
+    num_taken += ret.count();
+    return ret;
+}
+
+bool TorrentDirLoader::hasItems() const
+{
+    QMutexLocker lock(&mutex);
+    return !items.isEmpty();
+}
+
+bool TorrentDirLoader::finished() const
+{
+    QMutexLocker lock(&mutex);
+    return num_taken == dirs.count();
+}
+
+}
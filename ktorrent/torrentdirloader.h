@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TORRENTDIRLOADER_HH
+#define KT_TORRENTDIRLOADER_HH
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <torrent/statsjournal.h>
+#include <util/sha1hash.h>
+
+namespace kt
+{
+/**
+ * Reads the files in the torX dirs of existing torrents on a thread pool,
+ * so that the main thread only needs to construct the torrents.
+ */
+class TorrentDirLoader : public QObject
+{
+    Q_OBJECT
+public:
+    /// A torX dir which has been read
+    struct Item {
+        QString dir;
+        QByteArray data; ///< Contents of the torrent file, empty if there is no torrent file
+        QString error; ///< Error message if reading failed
+        bool dormant; ///< The torrent will not be started by the queue or by autostart
+        bt::SHA1Hash info_hash; ///< Info hash of a dormant torrent
+    };
+
+    /**
+     * Constructor.
+     * @param dirs The torX dirs to read
+     * @param journal Records of the stats journal, which are replayed into the stats files before they are read
+     * @param qm_enabled Whether the queue manager controls the torrents, if not the autostart flag decides
+     * @param parent The parent
+     */
+    TorrentDirLoader(const QStringList &dirs, const QHash<QString, StatsJournal::Record> &journal, bool qm_enabled, QObject *parent);
+    ~TorrentDirLoader() override;
+
+    /// Start reading all dirs
+    void start();
+
+    /// Stop reading, dirs which are being read will be finished first
+    void cancel();
+
+    /**
+     * Take the dirs which have been read.
+     * @param max The maximum number of items to take
+     * @return The items
+     */
+    QList<Item> take(int max);
+
+    /// Whether or not there are items which can be taken
+    bool hasItems() const;
+
+    /// Whether or not all dirs have been read and taken
+    bool finished() const;
+
+    /// Total time spent reading files in milliseconds, summed over all threads
+    qint64 readTime() const
+    {
+        return read_time.loadAcquire();
+    }
+
+Q_SIGNALS:
+    /// Emitted when items become available after the list of read items was empty
+    void itemsReady();
+
+private:
+    void read(const QString &dir);
+    void done(const Item &item);
+    bool isDormant(const QString &stats_file) const;
+
+    class ReadTask;
+
+private:
+    QStringList dirs;
+    const QHash<QString, StatsJournal::Record> journal;
+    const bool qm_enabled;
+    QThreadPool pool;
+    mutable QMutex mutex;
+    QList<Item> items;
+    int num_taken;
+    QAtomicInteger<int> cancelled;
+    QAtomicInteger<qint64> read_time;
+};
+
+}
+
+#endif
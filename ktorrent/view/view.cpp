@@ -293,8 +293,12 @@ struct StartAndStopAllVisitor {
 
 void View::updateActions()
 {
+    // dormant torrents are only loaded when an action is used on them
+    const QModelIndexList indices = selectionModel()->selectedRows();
     QList<bt::TorrentInterface *> sel;
-    getSelection(sel);
+    model->torrentsFromIndexList(indices, sel);
+    const int num_dormant = model->numDormant(indices);
+    const int num_selected = sel.count() + num_dormant;
 
     bool qm_enabled = !Settings::manuallyControlTorrents();
     bool en_start = false;
@@ -341,6 +345,12 @@ void View::updateActions()
         }
     }
 
+    // dormant torrents are stopped
+    if (num_dormant > 0) {
+        en_remove = true;
+        en_start = true;
+    }
+
     en_add_peer = en_add_peer && en_stop;
 
     start_torrent->setEnabled(en_start);
@@ -352,23 +362,23 @@ void View::updateActions()
     preview->setEnabled(en_prev);
     add_peers->setEnabled(en_add_peer);
     manual_announce->setEnabled(en_announce);
-    do_scrape->setEnabled(sel.count() > 0);
-    move_data->setEnabled(sel.count() > 0);
+    do_scrape->setEnabled(num_selected > 0);
+    move_data->setEnabled(num_selected > 0);
 
     remove_from_group->setEnabled(group && !group->isStandardGroup());
     groups_menu->setEnabled(group_actions.count() > 0);
-    check_data->setEnabled(sel.count() > 0);
+    check_data->setEnabled(num_selected > 0);
 
-    rename_torrent->setEnabled(sel.count() == 1);
-    data_dir->setEnabled(sel.count() == 1);
-    tor_dir->setEnabled(sel.count() == 1);
-    open_dir_menu->setEnabled(sel.count() == 1);
-    add_to_new_group->setEnabled(sel.count() > 0);
-    copy_url->setEnabled(sel.count() == 1 && sel.front()->loadUrl().isValid());
-    export_torrent->setEnabled(sel.count() == 1);
+    rename_torrent->setEnabled(sel.count() == 1 && num_dormant == 0);
+    data_dir->setEnabled(num_selected == 1);
+    tor_dir->setEnabled(num_selected == 1);
+    open_dir_menu->setEnabled(num_selected == 1);
+    add_to_new_group->setEnabled(num_selected > 0);
+    copy_url->setEnabled(sel.count() == 1 && num_dormant == 0 && sel.front()->loadUrl().isValid());
+    export_torrent->setEnabled(num_selected == 1);
 
     if (qm_enabled) {
-        start_all->setEnabled(false);
+        start_all->setEnabled(model->hasVisibleDormant());
         stop_all->setEnabled(false);
         StartAndStopAllVisitor v(start_all, stop_all);
         model->visit(v);
@@ -417,11 +427,9 @@ void View::forceStartTorrents()
 
     QueueManager *qm = core->getQueueManager();
     if (qm->enabled()) {
-        // Give everybody in the selection a high priority
-        int prio = qm->count();
-        int idx = 0;
-        for (bt::TorrentInterface *tc : qAsConst(sel))
-            tc->setPriority(prio + sel.count() - idx++);
+        // Move everybody in the selection to the front of the queue
+        for (int i = sel.count() - 1; i >= 0; i--)
+            qm->moveAfter(sel.at(i), nullptr);
 
         core->start(sel);
     } else
@@ -493,6 +501,7 @@ void View::removeTorrentsAndData()
 
 void View::startAllTorrents()
 {
+    model->loadVisibleDormant();
     QList<bt::TorrentInterface *> all;
     model->allTorrents(all);
     core->start(all);
@@ -521,7 +530,7 @@ void View::manualAnnounce()
     getSelection(sel);
     for (bt::TorrentInterface *tc : qAsConst(sel)) {
         if (tc->getStats().running)
-            tc->updateTracker();
+            core->getQueueManager()->announceScheduler()->announce(tc);
     }
 }
 
@@ -530,7 +539,7 @@ void View::scrape()
     QList<bt::TorrentInterface *> sel;
     getSelection(sel);
     for (bt::TorrentInterface *tc : qAsConst(sel)) {
-        tc->scrapeTracker();
+        core->getQueueManager()->scrapeBatcher()->scrape(tc);
     }
 }
 
@@ -660,7 +669,7 @@ void View::showHeaderMenu(const QPoint &pos)
 void View::getSelection(QList<bt::TorrentInterface *> &sel)
 {
     QModelIndexList indices = selectionModel()->selectedRows();
-    model->torrentsFromIndexList(indices, sel);
+    model->loadTorrentsFromIndexList(indices, sel);
 }
 
 void View::restoreState(const QByteArray &state)
@@ -691,7 +700,8 @@ bt::TorrentInterface *View::getCurrentTorrent()
 void View::onCurrentItemChanged(const QModelIndex &current, const QModelIndex & /*previous*/)
 {
     // Out(SYS_GEN|LOG_DEBUG) << "onCurrentItemChanged " << current.row() << endl;
-    bt::TorrentInterface *tc = model->torrentFromIndex(current);
+    // the info widgets need the torrent, so a dormant one is loaded
+    bt::TorrentInterface *tc = model->loadTorrentFromIndex(current);
     currentTorrentChanged(tc);
 }
 
@@ -84,7 +84,7 @@ public:
     }
 
     /**
-     * Put the current selection in a list.
+     * Put the current selection in a list, dormant torrents in it are loaded.
      * @param sel The list to put it in
      */
     void getSelection(QList<bt::TorrentInterface *> &sel);
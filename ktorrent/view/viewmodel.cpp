@@ -35,6 +35,7 @@
 
 #include <groups/group.h>
 #include <interfaces/torrentinterface.h>
+#include <torrent/datacheckscheduler.h>
 #include <torrent/queuemanager.h>
 #include <torrent/timeestimator.h>
 #include <util/functions.h>
@@ -51,6 +52,7 @@ namespace kt
 {
 ViewModel::Item::Item(bt::TorrentInterface *tc)
     : tc(tc)
+    , entry(nullptr)
 {
     const TorrentStats &s = tc->getStats();
     status = s.status;
@@ -72,10 +74,46 @@ ViewModel::Item::Item(bt::TorrentInterface *tc)
     hidden = false;
     time_added = s.time_added;
     highlight = false;
+    check_position = 0;
+}
+
+ViewModel::Item::Item(const TorrentSnapshot::Entry *entry)
+    : tc(nullptr)
+    , entry(entry)
+{
+    status = entry->status;
+    bytes_downloaded = entry->bytes_downloaded;
+    total_bytes_to_download = entry->total_bytes_to_download;
+    bytes_uploaded = entry->bytes_uploaded;
+    bytes_left = entry->bytes_left;
+    download_rate = upload_rate = 0;
+    eta = bt::TimeEstimator::NEVER;
+    seeders_connected_to = seeders_total = 0;
+    leechers_connected_to = leechers_total = 0;
+    percentage = total_bytes_to_download > 0 ? 100.0 * (total_bytes_to_download - bytes_left) / total_bytes_to_download : 100.0;
+    share_ratio = bytes_downloaded > 0 ? (float)bytes_uploaded / bytes_downloaded : 0.0f;
+    runtime_dl = runtime_ul = 0;
+    hidden = false;
+    time_added = QDateTime::fromSecsSinceEpoch(entry->time_added);
+    highlight = false;
+    check_position = 0;
+}
+
+QString ViewModel::Item::displayName() const
+{
+    return tc ? tc->getDisplayName() : entry->name;
+}
+
+QString ViewModel::Item::outputPath() const
+{
+    return tc ? tc->getStats().output_path : entry->output_path;
 }
 
 bool ViewModel::Item::update(int row, int sort_column, QModelIndexList &to_update, kt::ViewModel *model)
 {
+    if (!tc)
+        return false;
+
     bool ret = false;
     const TorrentStats &s = tc->getStats();
 
@@ -102,7 +140,15 @@ bool ViewModel::Item::update(int row, int sort_column, QModelIndexList &to_updat
     update_if_differs(bytes_left, s.bytes_left, BYTES_LEFT);
     update_if_differs(download_rate, s.download_rate, DOWNLOAD_RATE);
     update_if_differs(upload_rate, s.upload_rate, UPLOAD_RATE);
-    update_if_differs(eta, tc->getETA(), ETA);
+    // while waiting for or doing a data check, show how long the check will take
+    const DataCheckScheduler *dcs = model->core->getDataCheckScheduler();
+    update_if_differs(check_position, dcs->position(tc), NAME);
+    int new_eta = tc->getETA();
+    if (check_position > 0 || dcs->isChecking(tc)) {
+        const int check_eta = dcs->eta(tc);
+        new_eta = check_eta >= 0 ? check_eta : (int)bt::TimeEstimator::NEVER;
+    }
+    update_if_differs(eta, new_eta, ETA);
     update_if_differs(seeders_connected_to, s.seeders_connected_to, SEEDERS);
     update_if_differs(seeders_total, s.seeders_total, SEEDERS);
     update_if_differs(leechers_connected_to, s.leechers_connected_to, LEECHERS);
@@ -125,10 +171,9 @@ bool ViewModel::Item::update(int row, int sort_column, QModelIndexList &to_updat
 QVariant ViewModel::Item::data(int col) const
 {
     static QLocale locale;
-    const TorrentStats &s = tc->getStats();
     switch (col) {
     case NAME:
-        return tc->getDisplayName();
+        return displayName();
     case BYTES_DOWNLOADED:
         return BytesToString(bytes_downloaded);
     case TOTAL_BYTES_TO_DOWNLOAD:
@@ -138,7 +183,7 @@ QVariant ViewModel::Item::data(int col) const
     case BYTES_LEFT:
         return bytes_left > 0 ? BytesToString(bytes_left) : QVariant();
     case DOWNLOAD_RATE:
-        if (download_rate >= 103 && s.bytes_left_to_download > 0) // lowest "visible" speed, all below will be 0,0 Kb/s
+        if (download_rate >= 103 && bytes_left > 0) // lowest "visible" speed, all below will be 0,0 Kb/s
             return BytesPerSecToString(download_rate);
         else
             return QVariant();
@@ -168,7 +213,7 @@ QVariant ViewModel::Item::data(int col) const
     case SEED_TIME:
         return DurationToString(runtime_ul);
     case DOWNLOAD_LOCATION:
-        return tc->getStats().output_path;
+        return outputPath();
     case TIME_ADDED:
         return locale.toString(time_added);
     default:
@@ -180,7 +225,7 @@ bool ViewModel::Item::lessThan(int col, const Item *other) const
 {
     switch (col) {
     case NAME:
-        return QString::localeAwareCompare(tc->getDisplayName(), other->tc->getDisplayName()) < 0;
+        return QString::localeAwareCompare(displayName(), other->displayName()) < 0;
     case BYTES_DOWNLOADED:
         return bytes_downloaded < other->bytes_downloaded;
     case TOTAL_BYTES_TO_DOWNLOAD:
@@ -214,7 +259,7 @@ bool ViewModel::Item::lessThan(int col, const Item *other) const
     case SEED_TIME:
         return runtime_ul < other->runtime_ul;
     case DOWNLOAD_LOCATION:
-        return tc->getStats().output_path < other->tc->getStats().output_path;
+        return outputPath() < other->outputPath();
     case TIME_ADDED:
         return time_added < other->time_added;
     default:
@@ -232,7 +277,7 @@ QVariant ViewModel::Item::color(int col) const
         case bt::ALLOCATING_DISKSPACE:
         case bt::STALLED:
         case bt::CHECKING_DATA: {
-            if (Settings::highlightTorrentNameByTrackerStatus()) {
+            if (tc && Settings::highlightTorrentNameByTrackerStatus()) {
                 // apply additional highlighting to torrent names
                 const bt::TrackersStatusInfo tsi = tc->getTrackersList()->getTrackersStatusInfo();
                 if (tsi.trackers_count) {
@@ -267,15 +312,15 @@ QVariant ViewModel::Item::color(int col) const
 
 bool ViewModel::Item::visible(Group *group, const QString &filter_string) const
 {
-    if (group && !group->isMember(tc))
+    if (group && (tc ? !group->isMember(tc) : !entry->groups.contains(group->groupPath())))
         return false;
 
-    return filter_string.isEmpty() || tc->getDisplayName().contains(filter_string, Qt::CaseInsensitive);
+    return filter_string.isEmpty() || displayName().contains(filter_string, Qt::CaseInsensitive);
 }
 
 QVariant ViewModel::Item::statusIcon() const
 {
-    switch (tc->getStats().status) {
+    switch (status) {
     case NOT_STARTED:
     case STOPPED:
         return QIcon::fromTheme(QStringLiteral("kt-stop"));
@@ -288,7 +333,7 @@ QVariant ViewModel::Item::statusIcon() const
     case DOWNLOADING:
         return QIcon::fromTheme(QStringLiteral("go-down"));
     case STALLED:
-        if (tc->getStats().completed)
+        if (tc ? tc->getStats().completed : entry->completed)
             return QIcon::fromTheme(QStringLiteral("go-up"));
         else
             return QIcon::fromTheme(QStringLiteral("go-down"));
@@ -328,6 +373,29 @@ ViewModel::ViewModel(Core *core, View *parent)
         torrents.append(new Item(i));
         num_visible++;
     }
+
+    // Show the torrents which are still being loaded using the snapshot of the previous session
+    if (core->isLoadingTorrents()) {
+        connect(core, &Core::allTorrentsLoaded, this, &ViewModel::allTorrentsLoaded);
+        const QList<TorrentSnapshot::Entry> &entries = core->startupSnapshot().entries();
+        for (const TorrentSnapshot::Entry &e : entries) {
+            if (!qman->find(e.info_hash)) {
+                Item *item = new Item(&e);
+                torrents.append(item);
+                placeholders.insert(e.info_hash, item);
+                num_visible++;
+            }
+        }
+    } else {
+        // the dormant torrents are shown using the snapshot until they are loaded
+        const QList<const TorrentSnapshot::Entry *> dormant = core->dormantTorrents();
+        for (const TorrentSnapshot::Entry *e : dormant) {
+            Item *item = new Item(e);
+            torrents.append(item);
+            placeholders.insert(e->info_hash, item);
+            num_visible++;
+        }
+    }
 }
 
 ViewModel::~ViewModel()
@@ -342,6 +410,28 @@ void ViewModel::setGroup(Group *g)
 
 void ViewModel::addTorrent(bt::TorrentInterface *ti)
 {
+    // replace the placeholder of the torrent, if there is one
+    Item *item = placeholders.take(ti->getInfoHash());
+    if (item) {
+        const bool hidden = item->hidden;
+        *item = Item(ti);
+        item->hidden = hidden;
+        // finding the row would mean a scan, so let the view repaint what it shows
+        if (num_visible > 0)
+            Q_EMIT dataChanged(index(0, 0), index(num_visible - 1, _NUMBER_OF_COLUMNS - 1));
+        return;
+    }
+
+    if (core->isLoadingTorrents()) {
+        // No highlighting, scrolling or sorting while loading, the torrent is hidden
+        // until the next update, which sorts at most once for all torrents added since.
+        // allTorrentsLoaded sorts once more when everything is loaded.
+        item = new Item(ti);
+        item->hidden = true;
+        torrents.append(item);
+        return;
+    }
+
     Item *i = new Item(ti);
     if (Settings::highlightNewTorrents()) {
         i->highlight = true;
@@ -379,6 +469,24 @@ void ViewModel::removeTorrent(bt::TorrentInterface *ti)
     }
 }
 
+void ViewModel::allTorrentsLoaded()
+{
+    removePlaceholders();
+    update(view->viewDelegate(), true);
+}
+
+void ViewModel::removePlaceholders()
+{
+    // remove the placeholders of torrents which failed to load, the dormant ones stay until they are loaded
+    for (int row = torrents.count() - 1; row >= 0 && !placeholders.isEmpty(); row--) {
+        const Item *item = torrents[row];
+        if (!item->tc && !core->isDormant(item->entry->info_hash)) {
+            placeholders.remove(item->entry->info_hash);
+            removeRow(row);
+        }
+    }
+}
+
 void ViewModel::emitDataChanged(int row, int col)
 {
     QModelIndex idx = createIndex(row, col);
@@ -404,7 +512,7 @@ bool ViewModel::update(ViewDelegate *delegate, bool force_resort)
         }
 
         // hide the extender if there is one shown
-        if (hidden && delegate->extended(i->tc))
+        if (hidden && i->tc && delegate->extended(i->tc))
             delegate->hideExtender(i->tc);
 
         if (!i->hidden)
@@ -552,18 +660,27 @@ QVariant ViewModel::data(const QModelIndex &index, int role) const
     } else if (role == Qt::DisplayRole) {
         return item->data(index.column());
     } else if (role == Qt::EditRole && index.column() == NAME) {
-        return item->tc->getDisplayName();
+        return item->displayName();
     } else if (role == Qt::DecorationRole && index.column() == NAME) {
         return item->statusIcon();
     } else if (role == Qt::ToolTipRole && index.column() == NAME) {
         QString tooltip;
         bt::TorrentInterface *tc = item->tc;
+        if (!tc)
+            return i18n("%1<br/><br/>Loading ...", item->displayName());
+
         if (tc->loadUrl().isValid())
             tooltip = i18n("%1<br>Url: <b>%2</b>", tc->getDisplayName(), tc->loadUrl().toDisplayString());
         else
             tooltip = tc->getDisplayName();
 
         tooltip += QLatin1String("<br/><br/>") + tc->getStats().statusToString();
+        if (item->check_position > 0) {
+            if (core->getDataCheckScheduler()->isPaused())
+                tooltip += i18n("<br/>Waiting for a data check, position %1 in the queue (data checks are paused)", item->check_position);
+            else
+                tooltip += i18n("<br/>Waiting for a data check, position %1 in the queue", item->check_position);
+        }
         if (tc->getTrackersList()->noTrackersReachable())
             tooltip += i18n("<br/><br/>Unable to contact a tracker.");
 
@@ -594,7 +711,7 @@ bool ViewModel::setData(const QModelIndex &index, const QVariant &value, int rol
 
     QString name = value.toString();
     Item *item = reinterpret_cast<Item *>(index.internalPointer());
-    if (!item)
+    if (!item || !item->tc)
         return false;
 
     bt::TorrentInterface *tc = item->tc;
@@ -610,6 +727,11 @@ Qt::ItemFlags ViewModel::flags(const QModelIndex &index) const
     if (!index.isValid() || index.row() >= torrents.count())
         return QAbstractTableModel::flags(index) | Qt::ItemIsDropEnabled;
 
+    // torrents which are not loaded yet cannot be selected, except the dormant ones, which are loaded when an action is used on them
+    const Item *item = torrents[index.row()];
+    if (!item->tc)
+        return core->isDormant(item->entry->info_hash) ? Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDropEnabled : Qt::ItemIsDropEnabled;
+
     Qt::ItemFlags flags = QAbstractTableModel::flags(index) | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
     if (index.column() == NAME)
         flags |= Qt::ItemIsEditable;
@@ -685,6 +807,86 @@ void ViewModel::torrentsFromIndexList(const QModelIndexList &idx, QList<bt::Torr
     }
 }
 
+void ViewModel::loadTorrentsFromIndexList(const QModelIndexList &idx, QList<bt::TorrentInterface *> &tlist)
+{
+    // loading a dormant torrent changes the model, so all indexes are looked up first
+    QList<bt::SHA1Hash> dormant;
+    for (const QModelIndex &i : idx) {
+        if (!i.isValid() || i.row() >= torrents.count())
+            continue;
+
+        const Item *item = torrents[i.row()];
+        if (item->tc)
+            tlist.append(item->tc);
+        else
+            dormant.append(item->entry->info_hash);
+    }
+
+    loadDormant(dormant, tlist);
+}
+
+bt::TorrentInterface *ViewModel::loadTorrentFromIndex(const QModelIndex &index)
+{
+    if (!index.isValid() || index.row() >= torrents.count())
+        return nullptr;
+
+    const Item *item = torrents[index.row()];
+    if (item->tc)
+        return item->tc;
+
+    QList<bt::TorrentInterface *> tlist;
+    loadDormant(QList<bt::SHA1Hash>() << item->entry->info_hash, tlist);
+    return tlist.isEmpty() ? nullptr : tlist.first();
+}
+
+int ViewModel::numDormant(const QModelIndexList &idx) const
+{
+    int num = 0;
+    for (const QModelIndex &i : idx) {
+        if (i.isValid() && i.row() < torrents.count() && !torrents[i.row()]->tc && core->isDormant(torrents[i.row()]->entry->info_hash))
+            num++;
+    }
+    return num;
+}
+
+bool ViewModel::hasVisibleDormant() const
+{
+    for (const Item *item : qAsConst(torrents)) {
+        if (!item->tc && core->isDormant(item->entry->info_hash) && item->visible(group, filter_string))
+            return true;
+    }
+    return false;
+}
+
+void ViewModel::loadVisibleDormant()
+{
+    QList<bt::SHA1Hash> dormant;
+    for (const Item *item : qAsConst(torrents)) {
+        if (!item->tc && core->isDormant(item->entry->info_hash) && item->visible(group, filter_string))
+            dormant.append(item->entry->info_hash);
+    }
+
+    QList<bt::TorrentInterface *> tlist;
+    loadDormant(dormant, tlist);
+}
+
+void ViewModel::loadDormant(const QList<bt::SHA1Hash> &hashes, QList<bt::TorrentInterface *> &tlist)
+{
+    bool failed = false;
+    for (const bt::SHA1Hash &ih : hashes) {
+        // addTorrent replaces the placeholder
+        bt::TorrentInterface *tc = core->loadDormantTorrent(ih);
+        if (tc)
+            tlist.append(tc);
+        else
+            failed = true;
+    }
+
+    // while loading, the placeholders of torrents which are not loaded yet have to stay
+    if (failed && !core->isLoadingTorrents())
+        removePlaceholders();
+}
+
 bt::TorrentInterface *ViewModel::torrentFromIndex(const QModelIndex &index) const
 {
     if (index.isValid() && index.row() < torrents.count())
@@ -704,7 +906,7 @@ bt::TorrentInterface *ViewModel::torrentFromRow(int index) const
 void ViewModel::allTorrents(QList<bt::TorrentInterface *> &tlist) const
 {
     for (Item *item : qAsConst(torrents)) {
-        if (item->visible(group, filter_string))
+        if (item->tc && item->visible(group, filter_string))
             tlist.append(item->tc);
     }
 }
@@ -733,6 +935,7 @@ bool ViewModel::removeRows(int row, int count, const QModelIndex &parent)
 void ViewModel::onExit()
 {
     // items should be removed before Core delete their tc data.
+    placeholders.clear();
     removeRows(0, rowCount(), QModelIndex());
 }
 
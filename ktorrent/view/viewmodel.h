@@ -23,8 +23,10 @@
 #define KTVIEWMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QList>
 
+#include <torrent/torrentsnapshot.h>
 #include <torrent/torrentstats.h>
 #include <util/constants.h>
 
@@ -100,6 +102,29 @@ public:
      */
     void torrentsFromIndexList(const QModelIndexList &idx, QList<bt::TorrentInterface *> &tlist);
 
+    /**
+     * Get a list of torrents from an index list, dormant torrents in it are loaded first.
+     * @param idx The index list
+     * @param tlist The torrent list to fill
+     */
+    void loadTorrentsFromIndexList(const QModelIndexList &idx, QList<bt::TorrentInterface *> &tlist);
+
+    /**
+     * Get a torrent from a model index, a dormant torrent is loaded first.
+     * @param index The model index
+     * @return The torrent if the index is valid and in the proper range, 0 otherwise
+     */
+    bt::TorrentInterface *loadTorrentFromIndex(const QModelIndex &index);
+
+    /// Get the number of dormant torrents in an index list
+    int numDormant(const QModelIndexList &idx) const;
+
+    /// Whether or not there are visible dormant torrents
+    bool hasVisibleDormant() const;
+
+    /// Load the visible dormant torrents
+    void loadVisibleDormant();
+
     /**
      * Get a torrent from a model index.
      * @param index The model index
@@ -126,7 +151,7 @@ public:
     template<class Action> void visit(Action &a)
     {
         for (Item *item : qAsConst(torrents)) {
-            if (item->visible(group, filter_string))
+            if (item->tc && item->visible(group, filter_string))
                 if (!a(item->tc))
                     break;
         }
@@ -141,6 +166,7 @@ public:
 public Q_SLOTS:
     void addTorrent(bt::TorrentInterface *ti);
     void removeTorrent(bt::TorrentInterface *ti);
+    void allTorrentsLoaded();
     void sort(int col, Qt::SortOrder order) override;
     void onExit();
 
@@ -170,6 +196,7 @@ public:
 
     struct Item {
         bt::TorrentInterface *tc;
+        const TorrentSnapshot::Entry *entry; ///< Snapshot of a torrent which is not loaded yet, tc is 0 then
         // cached values to avoid unneeded updates
         bt::TorrentStatus status;
         bt::Uint64 bytes_downloaded;
@@ -187,11 +214,16 @@ public:
         bt::Uint32 runtime_dl;
         bt::Uint32 runtime_ul;
         int eta;
+        int check_position; ///< Position in the data check queue, 0 if not queued
         bool hidden;
         QDateTime time_added;
         bool highlight;
 
         Item(bt::TorrentInterface *tc);
+        Item(const TorrentSnapshot::Entry *entry);
+
+        QString displayName() const;
+        QString outputPath() const;
 
         bool update(int row, int sort_column, QModelIndexList &to_update, ViewModel *model);
         QVariant data(int col) const;
@@ -201,6 +233,10 @@ public:
         bool visible(Group *group, const QString &filter_string) const;
     };
 
+private:
+    void loadDormant(const QList<bt::SHA1Hash> &hashes, QList<bt::TorrentInterface *> &tlist);
+    void removePlaceholders();
+
 private:
     Core *core;
     View *view;
@@ -211,6 +247,7 @@ private:
     int num_visible;
     QModelIndexList update_list;
     QString filter_string;
+    QHash<bt::SHA1Hash, Item *> placeholders; // items of torrents which are shown from the snapshot until they are loaded
 };
 
 }
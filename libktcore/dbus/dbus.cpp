@@ -34,7 +34,9 @@
 #include <interfaces/functions.h>
 #include <interfaces/guiinterface.h>
 #include <interfaces/torrentinterface.h>
+#include <magnet/magnetlink.h>
 #include <torrent/queuemanager.h>
+#include <torrent/statsaggregator.h>
 #include <util/log.h>
 #include <util/sha1hash.h>
 
@@ -94,12 +96,35 @@ QStringList DBus::torrents()
         i++;
     }
 
+    const QList<const TorrentSnapshot::Entry *> dormant = core->dormantTorrents();
+    for (const TorrentSnapshot::Entry *e : dormant)
+        tors.append(e->info_hash.toString());
+
     return tors;
 }
 
-void DBus::start(const QString &info_hash)
+DBusTorrent *DBus::find(const QString &info_hash)
 {
     DBusTorrent *tc = torrent_map.find(info_hash);
+    if (tc)
+        return tc;
+
+    // dormant torrents are loaded when a script wants to do something with them
+    const QList<const TorrentSnapshot::Entry *> dormant = core->dormantTorrents();
+    for (const TorrentSnapshot::Entry *e : dormant) {
+        if (e->info_hash.toString() == info_hash) {
+            // loading it emits torrentAdded, which adds it to the map
+            core->loadDormantTorrent(e->info_hash);
+            return torrent_map.find(info_hash);
+        }
+    }
+
+    return nullptr;
+}
+
+void DBus::start(const QString &info_hash)
+{
+    DBusTorrent *tc = find(info_hash);
     if (!tc)
         return;
 
@@ -108,7 +133,7 @@ void DBus::start(const QString &info_hash)
 
 void DBus::stop(const QString &info_hash)
 {
-    DBusTorrent *tc = torrent_map.find(info_hash);
+    DBusTorrent *tc = find(info_hash);
     if (!tc)
         return;
 
@@ -127,7 +152,7 @@ void DBus::stopAll()
 
 void DBus::torrentAdded(bt::TorrentInterface *tc)
 {
-    DBusTorrent *db = new DBusTorrent(tc, this);
+    DBusTorrent *db = new DBusTorrent(tc, core->getQueueManager(), this);
     torrent_map.insert(db->infoHash(), db);
     torrentAdded(db->infoHash());
 }
@@ -170,6 +195,33 @@ void DBus::loadSilently(const QString &url, const QString &group)
     core->loadSilently(QFile::exists(url) ? QUrl::fromLocalFile(url) : QUrl(url), group);
 }
 
+uint DBus::loadMagnets(const QStringList &links, const QString &group)
+{
+    QList<bt::MagnetLink> mlinks;
+    mlinks.reserve(links.count());
+    for (const QString &link : links) {
+        const QString trimmed = link.trimmed();
+        if (!trimmed.isEmpty())
+            mlinks.append(bt::MagnetLink(trimmed));
+    }
+
+    MagnetLinkLoadOptions options;
+    options.silently = true;
+    options.group = group;
+    return core->load(mlinks, options);
+}
+
+uint DBus::loadMagnetFile(const QString &file, const QString &group)
+{
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::ReadOnly)) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to open " << file << " : " << fptr.errorString() << endl;
+        return 0;
+    }
+
+    return loadMagnets(QString::fromUtf8(fptr.readAll()).split(QLatin1Char('\n')), group);
+}
+
 QStringList DBus::groups() const
 {
     QStringList ret;
@@ -213,19 +265,16 @@ void DBus::groupRemoved(kt::Group *g)
 
 QObject *DBus::torrent(const QString &info_hash)
 {
-    return torrent_map.find(info_hash);
+    return find(info_hash);
 }
 
 QObject *DBus::group(const QString &name)
 {
-    kt::GroupManager *gman = core->getGroupManager();
-    kt::GroupManager::Itr i = gman->begin();
-    while (i != gman->end()) {
-        if (i->first == name)
-            return group_map.find(i->second);
-        i++;
-    }
-    return 0;
+    Group *g = core->getGroupManager()->find(name);
+    if (!g)
+        return 0;
+
+    return group_map.find(g);
 }
 
 void DBus::log(const QString &line)
@@ -235,7 +284,7 @@ void DBus::log(const QString &line)
 
 void DBus::remove(const QString &info_hash, bool data_to)
 {
-    DBusTorrent *tc = torrent_map.find(info_hash);
+    DBusTorrent *tc = find(info_hash);
     if (!tc)
         return;
 
@@ -281,6 +330,58 @@ QString DBus::dataDir() const
     return kt::DataDir();
 }
 
+static QVariantMap StatsToMap(const CurrentStats &s)
+{
+    QVariantMap ret;
+    ret.insert(QStringLiteral("download_speed"), s.download_speed);
+    ret.insert(QStringLiteral("upload_speed"), s.upload_speed);
+    ret.insert(QStringLiteral("bytes_downloaded"), s.bytes_downloaded);
+    ret.insert(QStringLiteral("bytes_uploaded"), s.bytes_uploaded);
+    return ret;
+}
+
+QVariantMap DBus::stats() const
+{
+    return StatsToMap(core->getStatsAggregator()->totals());
+}
+
+QVariantMap DBus::groupStats(const QString &group) const
+{
+    Group *g = core->getGroupManager()->find(group);
+    const QString path = g ? g->groupPath() : group;
+    return StatsToMap(core->getStatsAggregator()->groupTotals(path));
+}
+
+QStringList DBus::trackers() const
+{
+    return core->getStatsAggregator()->trackers();
+}
+
+QVariantMap DBus::trackerStats(const QString &host) const
+{
+    return StatsToMap(core->getStatsAggregator()->trackerTotals(host));
+}
+
+QVariantList DBus::deviceStats() const
+{
+    QVariantList ret;
+    const QList<QueueManager::DeviceStats> devices = core->getQueueManager()->deviceStats();
+    for (const QueueManager::DeviceStats &ds : devices) {
+        QVariantMap map;
+        map.insert(QStringLiteral("device"), ds.device);
+        map.insert(QStringLiteral("mount_point"), ds.mount_point);
+        map.insert(QStringLiteral("downloads"), ds.downloads);
+        map.insert(QStringLiteral("seeds"), ds.seeds);
+        map.insert(QStringLiteral("data_checks"), ds.data_checks);
+        map.insert(QStringLiteral("download_speed"), ds.download_rate);
+        map.insert(QStringLiteral("upload_speed"), ds.upload_rate);
+        map.insert(QStringLiteral("bytes_downloaded"), ds.bytes_downloaded);
+        map.insert(QStringLiteral("bytes_uploaded"), ds.bytes_uploaded);
+        ret.append(map);
+    }
+    return ret;
+}
+
 void DBus::orderQueue()
 {
     core->getQueueManager()->orderQueue();
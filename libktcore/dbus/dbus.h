@@ -25,6 +25,7 @@
 #include <QMap>
 #include <QObject>
 #include <QStringList>
+#include <QVariantMap>
 
 #include <dbus/dbusgroup.h>
 #include <dbus/dbustorrent.h>
@@ -76,6 +77,12 @@ public Q_SLOTS:
     /// Load a torrent silently
     Q_SCRIPTABLE void loadSilently(const QString &url, const QString &group);
 
+    /// Load a list of magnet links silently, returns the number of links which were accepted
+    Q_SCRIPTABLE uint loadMagnets(const QStringList &links, const QString &group);
+
+    /// Load the magnet links in a file (one per line) silently, returns the number of links which were accepted
+    Q_SCRIPTABLE uint loadMagnetFile(const QString &file, const QString &group);
+
     /// Remove a torrent
     Q_SCRIPTABLE void remove(const QString &info_hash, bool data_to);
 
@@ -124,6 +131,21 @@ public Q_SLOTS:
     ///  Get the number of torrents not running.
     Q_SCRIPTABLE QString dataDir() const;
 
+    /// Get the global transfer statistics
+    Q_SCRIPTABLE QVariantMap stats() const;
+
+    /// Get the transfer statistics of a group, given its name or path
+    Q_SCRIPTABLE QVariantMap groupStats(const QString &group) const;
+
+    /// Get the hosts of all trackers in use
+    Q_SCRIPTABLE QStringList trackers() const;
+
+    /// Get the transfer statistics of a tracker
+    Q_SCRIPTABLE QVariantMap trackerStats(const QString &host) const;
+
+    /// Get the transfer statistics and number of running torrents of each storage device
+    Q_SCRIPTABLE QVariantList deviceStats() const;
+
 private Q_SLOTS:
     void torrentAdded(bt::TorrentInterface *tc);
     void torrentRemoved(bt::TorrentInterface *tc);
@@ -152,6 +174,9 @@ Q_SIGNALS:
     /// Emitted when suspended state changes
     Q_SCRIPTABLE void suspendStateChanged(bool suspended);
 
+private:
+    DBusTorrent *find(const QString &info_hash);
+
 private:
     GUIInterface *gui;
     CoreInterface *core;
@@ -65,6 +65,76 @@ void DBusSettings::setMaxSeeds(int val)
     Settings::setMaxSeeds(val);
 }
 
+int DBusSettings::maxDownloadsPerDevice()
+{
+    return Settings::maxDownloadsPerDevice();
+}
+
+void DBusSettings::setMaxDownloadsPerDevice(int val)
+{
+    Settings::setMaxDownloadsPerDevice(val);
+}
+
+bool DBusSettings::adaptiveDownloadSlots()
+{
+    return Settings::adaptiveDownloadSlots();
+}
+
+void DBusSettings::setAdaptiveDownloadSlots(bool val)
+{
+    Settings::setAdaptiveDownloadSlots(val);
+}
+
+bool DBusSettings::rotateSeeds()
+{
+    return Settings::rotateSeeds();
+}
+
+void DBusSettings::setRotateSeeds(bool val)
+{
+    Settings::setRotateSeeds(val);
+}
+
+int DBusSettings::seedRotationInterval()
+{
+    return Settings::seedRotationInterval();
+}
+
+void DBusSettings::setSeedRotationInterval(int val)
+{
+    Settings::setSeedRotationInterval(val);
+}
+
+int DBusSettings::reannounceWindow()
+{
+    return Settings::reannounceWindow();
+}
+
+void DBusSettings::setReannounceWindow(int val)
+{
+    Settings::setReannounceWindow(val);
+}
+
+int DBusSettings::maxAnnouncesPerTracker()
+{
+    return Settings::maxAnnouncesPerTracker();
+}
+
+void DBusSettings::setMaxAnnouncesPerTracker(int val)
+{
+    Settings::setMaxAnnouncesPerTracker(val);
+}
+
+int DBusSettings::maxDataChecksPerDevice()
+{
+    return Settings::maxDataChecksPerDevice();
+}
+
+void DBusSettings::setMaxDataChecksPerDevice(int val)
+{
+    Settings::setMaxDataChecksPerDevice(val);
+}
+
 int DBusSettings::startDownloadsOnLowDiskSpace()
 {
     return Settings::startDownloadsOnLowDiskSpace();
@@ -803,4 +873,14 @@ void DBusSettings::setRequeueMagnetsTime(int val)
 {
     Settings::setRequeueMagnetsTime(val);
 }
+
+int DBusSettings::magnetMetadataCacheSize()
+{
+    return Settings::magnetMetadataCacheSize();
+}
+
+void DBusSettings::setMagnetMetadataCacheSize(int val)
+{
+    Settings::setMagnetMetadataCacheSize(val);
+}
 }
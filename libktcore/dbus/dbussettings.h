@@ -42,6 +42,20 @@ public Q_SLOTS:
     Q_SCRIPTABLE void setMaxDownloads(int val);
     Q_SCRIPTABLE int maxSeeds();
     Q_SCRIPTABLE void setMaxSeeds(int val);
+    Q_SCRIPTABLE int maxDownloadsPerDevice();
+    Q_SCRIPTABLE void setMaxDownloadsPerDevice(int val);
+    Q_SCRIPTABLE bool adaptiveDownloadSlots();
+    Q_SCRIPTABLE void setAdaptiveDownloadSlots(bool val);
+    Q_SCRIPTABLE bool rotateSeeds();
+    Q_SCRIPTABLE void setRotateSeeds(bool val);
+    Q_SCRIPTABLE int seedRotationInterval();
+    Q_SCRIPTABLE void setSeedRotationInterval(int val);
+    Q_SCRIPTABLE int reannounceWindow();
+    Q_SCRIPTABLE void setReannounceWindow(int val);
+    Q_SCRIPTABLE int maxAnnouncesPerTracker();
+    Q_SCRIPTABLE void setMaxAnnouncesPerTracker(int val);
+    Q_SCRIPTABLE int maxDataChecksPerDevice();
+    Q_SCRIPTABLE void setMaxDataChecksPerDevice(int val);
     Q_SCRIPTABLE int startDownloadsOnLowDiskSpace();
     Q_SCRIPTABLE void setStartDownloadsOnLowDiskSpace(int val);
     Q_SCRIPTABLE int maxConnections();
@@ -188,6 +202,8 @@ public Q_SLOTS:
     Q_SCRIPTABLE void setRequeueMagnets(bool val);
     Q_SCRIPTABLE int requeueMagnetsTime();
     Q_SCRIPTABLE void setRequeueMagnetsTime(int val);
+    Q_SCRIPTABLE int magnetMetadataCacheSize();
+    Q_SCRIPTABLE void setMagnetMetadataCacheSize(int val);
     Q_SCRIPTABLE bool showTotalSpeedInTitle();
     Q_SCRIPTABLE void setShowTotalSpeedInTitle(bool val);
 
@@ -32,6 +32,7 @@
 #include <interfaces/trackerinterface.h>
 #include <interfaces/trackerslist.h>
 #include <interfaces/webseedinterface.h>
+#include <torrent/queuemanager.h>
 #include <util/bitset.h>
 #include <util/log.h>
 #include <util/sha1hash.h>
@@ -40,9 +41,10 @@ using namespace bt;
 
 namespace kt
 {
-DBusTorrent::DBusTorrent(bt::TorrentInterface *ti, QObject *parent)
+DBusTorrent::DBusTorrent(bt::TorrentInterface *ti, QueueManager *qman, QObject *parent)
     : QObject(parent)
     , ti(ti)
+    , qman(qman)
     , stream(0)
 {
     QDBusConnection sb = QDBusConnection::sessionBus();
@@ -175,12 +177,12 @@ void DBusTorrent::changeTracker(const QString &tracker_url)
 
 void DBusTorrent::announce()
 {
-    ti->updateTracker();
+    qman->announceScheduler()->announce(ti);
 }
 
 void DBusTorrent::scrape()
 {
-    ti->scrapeTracker();
+    qman->scrapeBatcher()->scrape(ti);
 }
 
 void DBusTorrent::setTrackerEnabled(const QString &tracker_url, bool enabled)
@@ -208,7 +210,7 @@ bool DBusTorrent::removeTracker(const QString &tracker_url)
 void DBusTorrent::restoreDefaultTrackers()
 {
     ti->getTrackersList()->restoreDefault();
-    ti->updateTracker();
+    qman->announceScheduler()->announce(ti);
 }
 
 QStringList DBusTorrent::webSeeds() const
@@ -425,17 +427,18 @@ void DBusTorrent::setDoNotDownload(uint file_index, bool dnd)
 
 int DBusTorrent::priority() const
 {
-    return ti->getPriority();
+    return qman->queuePriority(ti);
 }
 
 void DBusTorrent::setPriority(int p)
 {
-    ti->setPriority(p);
+    qman->setQueuePriority(ti, p);
 }
 
 void DBusTorrent::setAllowedToStart(bool on)
 {
     ti->setAllowedToStart(on);
+    qman->requeue(ti);
 }
 
 bool DBusTorrent::isAllowedToStart() const
@@ -443,6 +446,11 @@ bool DBusTorrent::isAllowedToStart() const
     return ti->isAllowedToStart();
 }
 
+double DBusTorrent::seedScore() const
+{
+    return qman->seedScore(ti);
+}
+
 double DBusTorrent::maxSeedTime() const
 {
     return ti->getMaxSeedTime();
@@ -456,11 +464,13 @@ double DBusTorrent::maxShareRatio() const
 void DBusTorrent::setMaxSeedTime(double hours)
 {
     ti->setMaxSeedTime(hours);
+    qman->requeue(ti);
 }
 
 void DBusTorrent::setMaxShareRatio(double ratio)
 {
     ti->setMaxShareRatio(ratio);
+    qman->requeue(ti);
 }
 
 double DBusTorrent::seedTime() const
@@ -31,6 +31,7 @@
 namespace kt
 {
 class DBusTorrentFileStream;
+class QueueManager;
 
 /**
     DBus object to access a torrent
@@ -40,7 +41,7 @@ class DBusTorrent : public QObject
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.ktorrent.torrent")
 public:
-    DBusTorrent(bt::TorrentInterface *ti, QObject *parent);
+    DBusTorrent(bt::TorrentInterface *ti, QueueManager *qman, QObject *parent);
     ~DBusTorrent() override;
 
     /// Get a pointer to the actual torrent
@@ -71,6 +72,7 @@ public Q_SLOTS:
     Q_SCRIPTABLE void setPriority(int p);
     Q_SCRIPTABLE void setAllowedToStart(bool on);
     Q_SCRIPTABLE bool isAllowedToStart() const;
+    Q_SCRIPTABLE double seedScore() const;
 
     // Chunks
     Q_SCRIPTABLE uint chunks() const;
@@ -145,6 +147,7 @@ private Q_SLOTS:
 
 private:
     bt::TorrentInterface *ti;
+    QueueManager *qman;
     DBusTorrentFileStream *stream;
 };
 
@@ -197,6 +197,17 @@ public:
      **/
     void updateCount(QueueManager *qman);
 
+    /**
+     * Set the running and total count, used when the torrents have not been loaded yet
+     * @param running Number of running torrents
+     * @param total Total number of torrents
+     **/
+    void setCount(int running, int total)
+    {
+        this->running = running;
+        this->total = total;
+    }
+
 protected:
     QString name;
     QIcon icon;
@@ -20,6 +20,9 @@
 
 #include "groupmanager.h"
 
+#include <QHash>
+#include <QPair>
+
 #include <KLocalizedString>
 
 #include "allgroup.h"
@@ -31,6 +34,7 @@
 #include <bcodec/bnode.h>
 #include <interfaces/functions.h>
 #include <interfaces/torrentinterface.h>
+#include <torrent/torrentsnapshot.h>
 #include <util/error.h>
 #include <util/file.h>
 #include <util/fileops.h>
@@ -158,6 +162,7 @@ Group *GroupManager::newGroup(const QString &name)
     TorrentGroup *g = new TorrentGroup(name);
     connect(g, &TorrentGroup::torrentAdded, this, &GroupManager::customGroupChanged);
     connect(g, qOverload<Group *>(&TorrentGroup::torrentRemoved), this, &GroupManager::customGroupChanged);
+    connect(g, &TorrentGroup::limitsChanged, this, &GroupManager::limitsChanged);
     groups.insert(name, g);
     Q_EMIT groupAdded(g);
     return g;
@@ -251,6 +256,7 @@ void GroupManager::loadGroups()
             TorrentGroup *g = new TorrentGroup(QStringLiteral("dummy"));
             connect(g, &TorrentGroup::torrentAdded, this, &GroupManager::customGroupChanged);
             connect(g, qOverload<Group *>(&TorrentGroup::torrentRemoved), this, &GroupManager::customGroupChanged);
+            connect(g, &TorrentGroup::limitsChanged, this, &GroupManager::limitsChanged);
 
             try {
                 g->load(dn);
@@ -313,13 +319,24 @@ void GroupManager::removeDefaultGroup(Group *g)
     }
 }
 
-void GroupManager::torrentsLoaded(QueueManager *qman)
+void GroupManager::torrentsLoaded(QueueManager *qman, const std::set<bt::SHA1Hash> &dormant)
 {
     for (CItr i = groups.begin(); i != groups.end(); i++) {
         if (i->second->groupFlags() & Group::CUSTOM_GROUP) {
             TorrentGroup *tg = dynamic_cast<TorrentGroup *>(i->second);
             if (tg)
-                tg->loadTorrents(qman);
+                tg->loadTorrents(qman, dormant);
+        }
+    }
+}
+
+void GroupManager::dormantTorrentLoaded(bt::TorrentInterface *tc)
+{
+    for (CItr i = groups.begin(); i != groups.end(); i++) {
+        if (i->second->groupFlags() & Group::CUSTOM_GROUP) {
+            TorrentGroup *tg = dynamic_cast<TorrentGroup *>(i->second);
+            if (tg)
+                tg->dormantTorrentLoaded(tc);
         }
     }
 }
@@ -334,10 +351,43 @@ Group *GroupManager::findByPath(const QString &path)
     return nullptr;
 }
 
-void GroupManager::updateCount(QueueManager *qman)
+void GroupManager::updateCount(QueueManager *qman, const QList<const TorrentSnapshot::Entry *> &dormant)
 {
     for (CItr i = groups.begin(); i != groups.end(); i++)
         i->second->updateCount(qman);
+
+    if (dormant.isEmpty())
+        return;
+
+    // dormant torrents are not running, they count for the groups they were a member of in the snapshot
+    QHash<QString, int> counts;
+    for (const TorrentSnapshot::Entry *e : dormant) {
+        for (const QString &path : e->groups)
+            counts[path]++;
+    }
+
+    for (CItr i = groups.begin(); i != groups.end(); i++) {
+        Group *g = i->second;
+        g->setCount(g->runningTorrents(), g->totalTorrents() + counts.value(g->groupPath()));
+    }
+}
+
+void GroupManager::updateCount(const TorrentSnapshot &snapshot)
+{
+    QHash<QString, QPair<int, int>> counts;
+    for (const TorrentSnapshot::Entry &e : snapshot.entries()) {
+        for (const QString &path : e.groups) {
+            QPair<int, int> &c = counts[path];
+            if (e.running)
+                c.first++;
+            c.second++;
+        }
+    }
+
+    for (CItr i = groups.begin(); i != groups.end(); i++) {
+        const QPair<int, int> c = counts.value(i->second->groupPath());
+        i->second->setCount(c.first, c.second);
+    }
 }
 
 }
@@ -22,9 +22,11 @@
 #define KTGROUPMANAGER_H
 
 #include <QString>
+#include <set>
 
 #include <groups/group.h>
 #include <ktcore_export.h>
+#include <torrent/torrentsnapshot.h>
 #include <util/ptrmap.h>
 
 namespace bt
@@ -51,8 +53,16 @@ public:
     /**
      * Update the count of all groups
      * @param qman The QueueManager
+     * @param dormant Snapshot entries of the torrents which have not been loaded
      **/
-    void updateCount(QueueManager *qman);
+    void updateCount(QueueManager *qman, const QList<const TorrentSnapshot::Entry *> &dormant = QList<const TorrentSnapshot::Entry *>());
+
+    /**
+     * Update the count of all groups using a snapshot of the torrents,
+     * used at startup when the torrents have not been loaded yet.
+     * @param snapshot The TorrentSnapshot
+     **/
+    void updateCount(const TorrentSnapshot &snapshot);
 
     /**
      * Find a group given it's path
@@ -153,8 +163,15 @@ public:
     /**
         Torrents have been loaded update all custom groups.
         @param qman The QueueManager
+        @param dormant Hashes of the dormant torrents, which are loaded later
     */
-    void torrentsLoaded(QueueManager *qman);
+    void torrentsLoaded(QueueManager *qman, const std::set<bt::SHA1Hash> &dormant);
+
+    /**
+        A dormant torrent has been loaded, add it to the custom groups it is a member of.
+        @param tc The torrent
+    */
+    void dormantTorrentLoaded(bt::TorrentInterface *tc);
 
 Q_SIGNALS:
     void groupRenamed(Group *g);
@@ -162,6 +179,9 @@ Q_SIGNALS:
     void groupRemoved(Group *g);
     void customGroupChanged();
 
+    /// Emitted when a group applied its share ratio and seed time limits to a torrent
+    void limitsChanged(bt::TorrentInterface *tor);
+
 private:
     bt::PtrMap<QString, Group> groups;
     Group *all;
@@ -172,6 +172,7 @@ void TorrentGroup::addTorrent(TorrentInterface *tor, bool new_torrent)
     tor->setMaxShareRatio(policy.max_share_ratio);
     tor->setMaxSeedTime(policy.max_seed_time);
     tor->setTrafficLimits(policy.max_upload_rate * 1024, policy.max_download_rate * 1024);
+    limitsChanged(tor);
 
     torrentAdded(this);
 }
@@ -187,20 +188,30 @@ void TorrentGroup::policyChanged()
         tor->setMaxShareRatio(policy.max_share_ratio);
         tor->setMaxSeedTime(policy.max_seed_time);
         tor->setTrafficLimits(policy.max_upload_rate * 1024, policy.max_download_rate * 1024);
+        limitsChanged(tor);
         i++;
     }
 }
 
-void TorrentGroup::loadTorrents(QueueManager *qman)
+void TorrentGroup::loadTorrents(QueueManager *qman, const std::set<bt::SHA1Hash> &dormant)
 {
-    QueueManager::iterator i = qman->begin();
-    while (i != qman->end()) {
-        if (hashes.count((*i)->getInfoHash()) > 0)
-            torrents.insert(*i);
-        i++;
+    std::set<bt::SHA1Hash>::iterator i = hashes.begin();
+    while (i != hashes.end()) {
+        TorrentInterface *tor = qman->find(*i);
+        if (tor)
+            torrents.insert(tor);
+
+        if (!tor && dormant.count(*i))
+            i++;
+        else
+            i = hashes.erase(i);
     }
+}
 
-    hashes.clear();
+void TorrentGroup::dormantTorrentLoaded(TorrentInterface *tor)
+{
+    if (hashes.erase(tor->getInfoHash()))
+        torrents.insert(tor);
 }
 
 }
@@ -49,7 +49,22 @@ public:
 
     void add(TorrentInterface *tor);
     void remove(TorrentInterface *tor);
-    void loadTorrents(QueueManager *qman);
+
+    /**
+     * Look up the members which have been loaded.
+     * @param qman The QueueManager
+     * @param dormant Hashes of the dormant torrents, they stay members until they are loaded
+     */
+    void loadTorrents(QueueManager *qman, const std::set<bt::SHA1Hash> &dormant);
+
+    /// A dormant torrent has been loaded, if it is a member it is looked up now
+    void dormantTorrentLoaded(TorrentInterface *tor);
+
+    /// Get the torrents in this group
+    const std::set<TorrentInterface *> &members() const
+    {
+        return torrents;
+    }
 
 Q_SIGNALS:
     /// Emitted when a torrent has been added
@@ -58,6 +73,9 @@ Q_SIGNALS:
     /// Emitted when a torrent has been removed
     void torrentRemoved(Group *g);
 
+    /// Emitted when the share ratio and seed time limits of the group were applied to a torrent
+    void limitsChanged(bt::TorrentInterface *tor);
+
 private:
     std::set<TorrentInterface *> torrents;
     std::set<bt::SHA1Hash> hashes;
@@ -25,6 +25,7 @@
 #include <QUrl>
 
 #include <ktcore_export.h>
+#include <torrent/torrentsnapshot.h>
 #include <util/constants.h>
 
 namespace bt
@@ -54,6 +55,8 @@ struct MagnetLinkLoadOptions {
 class MagnetManager;
 class QueueManager;
 class GroupManager;
+class StatsAggregator;
+class DataCheckScheduler;
 class DBus;
 
 /**
@@ -207,7 +210,8 @@ public:
     virtual void remove(QList<bt::TorrentInterface *> &todo, bool data_to) = 0;
 
     /**
-     * Find the next free torX dir.
+     * Find the next free torX dir. The dir is reserved, so consecutive calls
+     * return different dirs, even if the dir has not been created yet.
      * @return Path to the dir (including the torX part)
      */
     virtual QString findNewTorrentDir() const = 0;
@@ -218,6 +222,24 @@ public:
      */
     virtual void loadExistingTorrent(const QString &tor_dir) = 0;
 
+    /**
+     * Whether a torrent is dormant. Dormant torrents were stopped in the previous session
+     * and nothing will start them, they are shown from the snapshot of that session and
+     * only loaded when something needs to be done with them.
+     * @param ih Info hash of the torrent
+     */
+    virtual bool isDormant(const bt::SHA1Hash &ih) const = 0;
+
+    /**
+     * Load a dormant torrent, the torrentAdded signal is emitted for it.
+     * @param ih Info hash of the torrent
+     * @return The torrent, 0 if it is not dormant and not loaded or if loading failed
+     */
+    virtual bt::TorrentInterface *loadDormantTorrent(const bt::SHA1Hash &ih) = 0;
+
+    /// Get the snapshot entries of all dormant torrents
+    virtual QList<const TorrentSnapshot::Entry *> dormantTorrents() const = 0;
+
     /**
      * Sets global suspended state for all torrents (QueueManager) and stopps all torrents.
      * No torrents will be automatically started/stopped.
@@ -236,6 +258,12 @@ public:
     /// Get the MagnetManager
     virtual kt::MagnetManager *getMagnetManager() = 0;
 
+    /// Get the StatsAggregator, which keeps track of global, group and tracker transfer totals
+    virtual kt::StatsAggregator *getStatsAggregator() = 0;
+
+    /// Get the DataCheckScheduler, which queues data checks per storage device
+    virtual kt::DataCheckScheduler *getDataCheckScheduler() = 0;
+
     /// Get a pointer to the external interface object (for dbus and scripting)
     virtual DBus *getExternalInterface() = 0;
 
@@ -245,6 +273,15 @@ public:
     /// Load a magnet link
     virtual void load(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options) = 0;
 
+    /**
+     * Load a batch of magnet links in one go. Invalid links, links of torrents which are
+     * already loaded and links which are already queued are skipped.
+     * @param mlinks The magnet links
+     * @param options Load options, the same for all links
+     * @return The number of magnet links which were accepted
+     */
+    virtual bt::Uint32 load(const QList<bt::MagnetLink> &mlinks, const MagnetLinkLoadOptions &options) = 0;
+
     /// Create a torrent (Note: hash calculation should be finished, and torrent should have been saved)
     virtual bt::TorrentInterface *createTorrent(bt::TorrentCreator *tc, bool seed) = 0;
 
@@ -20,12 +20,15 @@
 
 #include "functions.h"
 
+#include <cstring>
+
 #include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QNetworkInterface>
 #include <QRandomGenerator>
 #include <QStandardPaths>
+#include <QVarLengthArray>
 
 #include <KLocalizedString>
 #include <Solid/Device>
@@ -53,6 +56,7 @@
 #include <tracker/udptrackersocket.h>
 #include <util/functions.h>
 #include <util/log.h>
+#include <util/sha1hash.h>
 
 using namespace bt;
 
@@ -167,4 +171,95 @@ QString TorrentFileFilter(bool all_files_included)
     return ret;
 }
 
+// Skip one bencoded value, returns a pointer past its end or nullptr if it is not valid or not complete
+static const char *SkipBEncoded(const char *p, const char *end)
+{
+    // the lists and dictionaries which are not closed yet: 'l' for a list, 'k' for a
+    // dictionary which expects a key and 'v' for a dictionary which expects a value
+    QVarLengthArray<char, 32> open;
+    do {
+        if (p >= end)
+            return nullptr;
+
+        const char c = *p;
+        if (c == 'e') {
+            // a key without a value is not allowed
+            if (open.isEmpty() || open.last() == 'v')
+                return nullptr;
+            open.removeLast();
+            p++;
+        } else if (!open.isEmpty() && open.last() == 'k' && (c < '0' || c > '9')) {
+            return nullptr; // keys are strings
+        } else if (c == 'l' || c == 'd') {
+            // the list or dictionary is a complete value once it is closed
+            open.append(c == 'l' ? 'l' : 'k');
+            p++;
+            continue;
+        } else if (c == 'i') {
+            // an optional minus sign and at least one digit
+            const char *q = p + 1;
+            if (q < end && *q == '-')
+                q++;
+            const char *digits = q;
+            while (q < end && *q >= '0' && *q <= '9')
+                q++;
+            if (q == digits || q >= end || *q != 'e')
+                return nullptr;
+            p = q + 1;
+        } else if (c >= '0' && c <= '9') {
+            // strings are skipped, the pieces of a torrent are not looked at
+            qint64 len = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                len = len * 10 + (*p - '0');
+                if (len > end - p)
+                    return nullptr;
+                p++;
+            }
+
+            if (p >= end || *p != ':' || len > end - p - 1)
+                return nullptr;
+            p += len + 1;
+        } else {
+            return nullptr;
+        }
+
+        // a value is complete, in a dictionary keys and values take turns
+        if (!open.isEmpty() && open.last() != 'l')
+            open.last() = open.last() == 'k' ? 'v' : 'k';
+    } while (!open.isEmpty());
+
+    return p;
+}
+
+bool IsBEncoded(const QByteArray &data)
+{
+    return SkipBEncoded(data.constData(), data.constData() + data.size()) != nullptr;
+}
+
+bool TorrentInfoHash(const QByteArray &data, bt::SHA1Hash &hash)
+{
+    const char *p = data.constData();
+    const char *end = p + data.size();
+    if (p >= end || *p != 'd')
+        return false;
+
+    p++;
+    while (p < end && *p != 'e') {
+        if (*p < '0' || *p > '9')
+            return false; // keys are strings
+
+        const char *value = SkipBEncoded(p, end);
+        const char *next = value ? SkipBEncoded(value, end) : nullptr;
+        if (!next)
+            return false;
+
+        if (value - p == 6 && memcmp(p, "4:info", 6) == 0) {
+            hash = bt::SHA1Hash::generate((const bt::Uint8 *)value, next - value);
+            return true;
+        }
+        p = next;
+    }
+
+    return false;
+}
 }
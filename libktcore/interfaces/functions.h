@@ -25,6 +25,11 @@
 #include <ktcore_export.h>
 #include <util/constants.h>
 
+namespace bt
+{
+class SHA1Hash;
+}
+
 namespace kt
 {
 enum CreationMode {
@@ -40,6 +45,21 @@ KTCORE_EXPORT void ApplySettings();
 /// Get the filter string for torrent files used file dialogs
 KTCORE_EXPORT QString TorrentFileFilter(bool all_files_included);
 
+/**
+ * Check whether data starts with a complete bencoded value, without decoding it.
+ * Use this to see whether something is a (complete) torrent file before loading it,
+ * so that the torrent is only decoded once, when it is loaded.
+ */
+KTCORE_EXPORT bool IsBEncoded(const QByteArray &data);
+
+/**
+ * Calculate the info hash of a torrent file without decoding it.
+ * @param data The torrent file
+ * @param hash Set to the info hash
+ * @return false if data is not a torrent file
+ */
+KTCORE_EXPORT bool TorrentInfoHash(const QByteArray &data, bt::SHA1Hash &hash);
+
 }
 
 #endif
@@ -21,6 +21,7 @@
 #include "pluginmanager.h"
 
 #include <QFile>
+#include <QJsonObject>
 #include <QTextStream>
 
 #include <KLocalizedString>
@@ -42,6 +43,7 @@ namespace kt
 PluginManager::PluginManager(CoreInterface *core, GUIInterface *gui)
     : core(core)
     , gui(gui)
+    , headless(false)
 {
     prefpage = 0;
     loaded.setAutoDelete(true);
@@ -73,6 +75,12 @@ void PluginManager::loadPluginList()
         plugins << pi;
     }
 
+    if (headless) {
+        // no widgets, so no plugin page either
+        loadPlugins();
+        return;
+    }
+
     if (!prefpage) {
         prefpage = new PluginActivity(this);
         gui->addActivity(prefpage);
@@ -92,7 +100,7 @@ void PluginManager::loadPlugins()
             // unload it
             unload(pi, idx);
             pi.save();
-        } else if (!loaded.contains(idx) && pi.isPluginEnabled()) {
+        } else if (!loaded.contains(idx) && pi.isPluginEnabled() && canLoad(idx)) {
             // load it
             load(pi, idx);
             pi.save();
@@ -101,6 +109,16 @@ void PluginManager::loadPlugins()
     }
 }
 
+bool PluginManager::canLoad(int idx) const
+{
+    if (!headless)
+        return true;
+
+    // desktop files converted to json store the value as a string
+    const QJsonValue v = pluginsMetaData.at(idx).rawData().value(QStringLiteral("X-KTorrent-Headless"));
+    return v.toBool() || v.toString() == QLatin1String("true");
+}
+
 void PluginManager::load(const KPluginInfo &pi, int idx)
 {
     Q_UNUSED(pi)
@@ -52,11 +52,22 @@ class KTCORE_EXPORT PluginManager
     GUIInterface *gui;
     PluginActivity *prefpage;
     bt::PtrMap<int, Plugin> loaded;
+    bool headless;
 
 public:
     PluginManager(CoreInterface *core, GUIInterface *gui);
     ~PluginManager();
 
+    /**
+     * Run without a GUI, only plugins which declare they can do without
+     * one (X-KTorrent-Headless=true in their metadata) will be loaded.
+     * @param on Whether or not we are headless
+     */
+    void setHeadless(bool on)
+    {
+        headless = on;
+    }
+
     /**
      * Get the plugin info list.
      */
@@ -91,6 +102,7 @@ public:
 private:
     void load(const KPluginInfo &pi, int idx);
     void unload(const KPluginInfo &pi, int idx);
+    bool canLoad(int idx) const;
 };
 
 }
@@ -0,0 +1,124 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QtTest>
+
+#include <torrent/downloadslotcontroller.h>
+#include <util/log.h>
+
+using namespace kt;
+
+/**
+ * Simulated link, every download gets rate_per_slot until the link is full.
+ */
+struct Link {
+    bt::Uint32 rate_per_slot;
+    bt::Uint32 capacity;
+
+    bt::Uint32 rate(int slots) const
+    {
+        return qMin<bt::Uint32>(slots * rate_per_slot, capacity);
+    }
+};
+
+class DownloadSlotControllerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("downloadslotcontrollertest.log"), false, false);
+    }
+
+    void testNoGain()
+    {
+        DownloadSlotController c;
+        c.reset(1);
+
+        // an extra slot is tried once the rate has settled, and taken away again when it did not help
+        QCOMPARE(run(c, 0, 31, Link{1000, 1000}, 0), QList<int>() << 2);
+        QCOMPARE(run(c, 31, 61, Link{1000, 1000}, 0), QList<int>() << 1);
+
+        // the extra slot is not tried again for a while
+        QVERIFY(run(c, 61, 660, Link{1000, 1000}, 0).isEmpty());
+        QCOMPARE(run(c, 660, 661, Link{1000, 1000}, 0), QList<int>() << 2);
+    }
+
+    void testGrow()
+    {
+        DownloadSlotController c;
+        c.reset(1);
+
+        // slots are added as long as they help, the one which did not is taken away
+        QCOMPARE(run(c, 0, 130, Link{1000, 3000}, 0), QList<int>() << 2 << 3 << 4 << 3);
+        QCOMPARE(c.slots(), 3);
+
+        // without a cap no slot is taken away, it stays at 3 until the extra slot is tried again
+        QVERIFY(run(c, 130, 720, Link{1000, 3000}, 0).isEmpty());
+        QCOMPARE(run(c, 720, 760, Link{1000, 3000}, 0), QList<int>() << 4 << 3);
+    }
+
+    void testSmallGain()
+    {
+        DownloadSlotController c;
+        c.reset(10);
+
+        // with many slots a gain of half a download is still worth keeping
+        QCOMPARE(run(c, 0, 100, Link{100, 1050}, 0), QList<int>() << 11 << 12 << 11);
+    }
+
+    void testCap()
+    {
+        DownloadSlotController c;
+        c.reset(3);
+
+        // with a saturated cap slots are taken away, until that lowers the rate
+        QCOMPARE(run(c, 0, 300, Link{1000, 2000}, 2000), QList<int>() << 2 << 1 << 2);
+        QCOMPARE(c.slots(), 2);
+        QVERIFY(c.utilization() > 0.95);
+    }
+
+    void testMax()
+    {
+        DownloadSlotController c;
+        c.reset(4);
+        QVERIFY(c.update(1000, 1000, 0, 2, true));
+        QCOMPARE(c.slots(), 2);
+
+        // never more than the maximum
+        QVERIFY(run(c, 1, 300, Link{1000, 10000}, 0, 2).isEmpty());
+        QCOMPARE(c.slots(), 2);
+    }
+
+    void testNotWaiting()
+    {
+        DownloadSlotController c;
+        c.reset(1);
+
+        // no extra slot is tried when there are no downloads waiting for one
+        QVERIFY(run(c, 0, 300, Link{1000, 10000}, 0, 0, false).isEmpty());
+        QCOMPARE(c.slots(), 1);
+    }
+
+private:
+    /**
+     * Feed the controller one sample per second.
+     * @return The number of slots after every change
+     */
+    QList<int> run(DownloadSlotController &c, int from, int to, const Link &link, bt::Uint32 cap, int max = 0, bool waiting = true)
+    {
+        QList<int> changes;
+        for (int sec = from + 1; sec <= to; sec++) {
+            if (c.update(sec * 1000, link.rate(c.slots()), cap, max, waiting))
+                changes << c.slots();
+        }
+        return changes;
+    }
+};
+
+QTEST_MAIN(DownloadSlotControllerTest)
+
+#include "downloadslotcontrollertest.moc"
@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QtTest>
+
+#include <interfaces/functions.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+
+#include "testtorrent.h"
+
+using namespace kt;
+
+class FunctionsTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("functionstest.log"), false, false);
+    }
+
+    void testIsBEncoded_data()
+    {
+        QTest::addColumn<QByteArray>("data");
+        QTest::addColumn<bool>("result");
+
+        QTest::newRow("int") << QByteArray("i42e") << true;
+        QTest::newRow("negative int") << QByteArray("i-42e") << true;
+        QTest::newRow("string") << QByteArray("4:spam") << true;
+        QTest::newRow("empty string") << QByteArray("0:") << true;
+        QTest::newRow("empty list") << QByteArray("le") << true;
+        QTest::newRow("empty dict") << QByteArray("de") << true;
+        QTest::newRow("nested") << QByteArray("d4:spaml1:ai3ed1:b1:cee3:fooi0ee") << true;
+        QTest::newRow("dict in list") << QByteArray("ld1:ai1eee") << true;
+        QTest::newRow("trailing data") << QByteArray("i42etrailing") << true;
+        QTest::newRow("torrent") << TestTorrentData(0, QStringLiteral("http://tracker.example.org/announce")) << true;
+
+        QTest::newRow("empty") << QByteArray() << false;
+        QTest::newRow("unterminated int") << QByteArray("i42") << false;
+        QTest::newRow("empty int") << QByteArray("ie") << false;
+        QTest::newRow("int with letters") << QByteArray("ixe") << false;
+        QTest::newRow("minus without digits") << QByteArray("i-e") << false;
+        QTest::newRow("minus in int") << QByteArray("i4-2e") << false;
+        QTest::newRow("double minus") << QByteArray("i--1e") << false;
+        QTest::newRow("int key") << QByteArray("di1e3:fooe") << false;
+        QTest::newRow("list key") << QByteArray("dle3:fooe") << false;
+        QTest::newRow("key without value") << QByteArray("d3:fooe") << false;
+        QTest::newRow("nested int key") << QByteArray("d1:adi1ei2eee") << false;
+        QTest::newRow("short string") << QByteArray("4:spa") << false;
+        QTest::newRow("string without colon") << QByteArray("4spam") << false;
+        QTest::newRow("huge string") << QByteArray("99999999999999999999:x") << false;
+        QTest::newRow("unterminated list") << QByteArray("l4:spam") << false;
+        QTest::newRow("unterminated dict") << QByteArray("d4:spami1e") << false;
+        QTest::newRow("end") << QByteArray("e") << false;
+        QTest::newRow("garbage") << QByteArray("<html>") << false;
+        QTest::newRow("truncated torrent") << TestTorrentData(0).chopped(2) << false;
+    }
+
+    void testIsBEncoded()
+    {
+        QFETCH(QByteArray, data);
+        QFETCH(bool, result);
+        QCOMPARE(IsBEncoded(data), result);
+    }
+
+    void testTorrentInfoHash()
+    {
+        const QByteArray data = TestTorrentData(0, QStringLiteral("http://tracker.example.org/announce"));
+        // the info dictionary runs from after the key up to the end of the outer dictionary
+        const int start = data.indexOf("4:info") + 6;
+        const QByteArray info = data.mid(start, data.size() - start - 1);
+
+        bt::SHA1Hash hash;
+        QVERIFY(TorrentInfoHash(data, hash));
+        QVERIFY(hash == bt::SHA1Hash::generate((const bt::Uint8 *)info.constData(), info.size()));
+
+        QVERIFY(!TorrentInfoHash(QByteArray("d8:announce3:fooe"), hash));
+        QVERIFY(!TorrentInfoHash(QByteArray("li1ee"), hash));
+        QVERIFY(!TorrentInfoHash(data.left(data.size() / 2), hash));
+    }
+};
+
+QTEST_MAIN(FunctionsTest)
+
+#include "functionstest.moc"
@@ -0,0 +1,155 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <interfaces/functions.h>
+#include <torrent/magnetjournal.h>
+#include <util/log.h>
+
+using namespace kt;
+
+static MagnetJournal::Entry Entry(int n, bool stopped = false)
+{
+    const bt::SHA1Hash hash = bt::SHA1Hash::generate((const bt::Uint8 *)&n, sizeof(int));
+    MagnetJournal::Entry e;
+    e.mlink = bt::MagnetLink(QLatin1String("magnet:?xt=urn:btih:") + hash.toString() + QLatin1String("&dn=magnet%20") + QString::number(n));
+    e.options.silently = n % 2 == 0;
+    e.options.group = QStringLiteral("group with spaces");
+    e.options.location = QStringLiteral("/tmp/a b/c%d\ne");
+    e.options.move_on_completion = QString();
+    e.stopped = stopped;
+    return e;
+}
+
+class MagnetJournalTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("magnetjournaltest.log"), false, false);
+        QVERIFY(tmp.isValid());
+    }
+
+    void init()
+    {
+        file = tmp.path() + QLatin1String("/magnets") + QString::number(n++);
+    }
+
+    void testRecords()
+    {
+        MagnetJournal journal;
+        journal.open(file);
+        QVERIFY(journal.isOpen());
+        journal.added(Entry(0));
+        journal.added(QList<MagnetJournal::Entry>() << Entry(1, true) << Entry(2));
+        journal.removed(Entry(1).mlink.infoHash());
+        journal.stopped(Entry(0).mlink.infoHash());
+        journal.started(Entry(0).mlink.infoHash());
+        journal.close();
+        QVERIFY(!journal.isOpen());
+
+        const QList<MagnetJournal::Record> records = MagnetJournal::load(file);
+        QCOMPARE(records.count(), 6);
+        for (int i = 0; i < 3; i++) {
+            const MagnetJournal::Record &r = records.at(i);
+            const MagnetJournal::Entry e = Entry(i, i == 1);
+            QCOMPARE(r.type, MagnetJournal::Record::ADD);
+            QVERIFY(r.hash == e.mlink.infoHash());
+            QCOMPARE(r.entry.mlink.displayName(), e.mlink.displayName());
+            QCOMPARE(r.entry.stopped, e.stopped);
+            QCOMPARE(r.entry.options.silently, e.options.silently);
+            QCOMPARE(r.entry.options.group, e.options.group);
+            QCOMPARE(r.entry.options.location, e.options.location);
+            QCOMPARE(r.entry.options.move_on_completion, e.options.move_on_completion);
+        }
+
+        QCOMPARE(records.at(3).type, MagnetJournal::Record::REMOVE);
+        QVERIFY(records.at(3).hash == Entry(1).mlink.infoHash());
+        QCOMPARE(records.at(4).type, MagnetJournal::Record::STOP);
+        QCOMPARE(records.at(5).type, MagnetJournal::Record::START);
+        QVERIFY(records.at(5).hash == Entry(0).mlink.infoHash());
+    }
+
+    void testDamaged()
+    {
+        MagnetJournal journal;
+        journal.open(file);
+        journal.added(Entry(0));
+        journal.close();
+
+        // unknown and broken records are skipped, a partially written last record is ignored
+        QFile fptr(file + QLatin1String(".journal"));
+        QVERIFY(fptr.open(QIODevice::WriteOnly | QIODevice::Append));
+        fptr.write("frobnicate 1234\n");
+        fptr.write("remove 1234\n");
+        fptr.write("add 0 0 magnet:?foo\n");
+        fptr.write(QByteArray("stop " + Entry(0).mlink.infoHash().toString().toLatin1() + '\n'));
+        fptr.write(QByteArray("remove " + Entry(0).mlink.infoHash().toString().toLatin1()));
+        fptr.close();
+
+        const QList<MagnetJournal::Record> records = MagnetJournal::load(file);
+        QCOMPARE(records.count(), 2);
+        QCOMPARE(records.at(0).type, MagnetJournal::Record::ADD);
+        QCOMPARE(records.at(1).type, MagnetJournal::Record::STOP);
+    }
+
+    void testCompaction()
+    {
+        MagnetJournal journal;
+        journal.open(file);
+        QVERIFY(!journal.needsCompaction(0));
+        QVERIFY(journal.needsCompaction(0, 1001));
+
+        for (int i = 0; i < 1001; i++)
+            journal.stopped(Entry(0).mlink.infoHash());
+        QVERIFY(journal.needsCompaction(0));
+        QVERIFY(!journal.needsCompaction(1));
+
+        journal.compact(QList<MagnetJournal::Entry>() << Entry(0) << Entry(1));
+        QVERIFY(journal.isOpen());
+        QVERIFY(!journal.needsCompaction(0));
+
+        // changes made while the magnets file is written go to the new journal
+        journal.started(Entry(0).mlink.infoHash());
+        journal.close();
+
+        QVERIFY(!QFile::exists(file + QLatin1String(".journal.old")));
+        const QList<MagnetJournal::Record> records = MagnetJournal::load(file);
+        QCOMPARE(records.count(), 1);
+        QCOMPARE(records.at(0).type, MagnetJournal::Record::START);
+
+        QFile fptr(file);
+        QVERIFY(fptr.open(QIODevice::ReadOnly));
+        const QByteArray data = fptr.readAll();
+        QVERIFY(IsBEncoded(data));
+        QVERIFY(data.contains(Entry(1).mlink.infoHash().toString().toLatin1()));
+    }
+
+    void testSave()
+    {
+        MagnetJournal journal;
+        journal.open(file);
+        journal.added(Entry(0));
+        journal.close();
+
+        QVERIFY(MagnetJournal::save(file, QList<MagnetJournal::Entry>() << Entry(0)));
+        QVERIFY(QFile::exists(file));
+        QVERIFY(MagnetJournal::load(file).isEmpty());
+    }
+
+private:
+    QTemporaryDir tmp;
+    QString file;
+    int n = 0;
+};
+
+QTEST_MAIN(MagnetJournalTest)
+
+#include "magnetjournaltest.moc"
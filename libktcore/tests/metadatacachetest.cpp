@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <torrent/metadatacache.h>
+#include <util/log.h>
+
+using namespace kt;
+
+static QByteArray Metadata(int n)
+{
+    return "d4:name" + QByteArray::number(QByteArray::number(n).size() + 8) + ":metadata" + QByteArray::number(n) + "e" + QByteArray(80, 'x');
+}
+
+static bt::SHA1Hash Hash(const QByteArray &data)
+{
+    return bt::SHA1Hash::generate((const bt::Uint8 *)data.constData(), data.size());
+}
+
+class MetadataCacheTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("metadatacachetest.log"), false, false);
+    }
+
+    void init()
+    {
+        dir.reset(new QTemporaryDir());
+        QVERIFY(dir->isValid());
+    }
+
+    void testFind()
+    {
+        MetadataCache cache;
+        cache.open(dir->path());
+        const QByteArray md = Metadata(0);
+        QByteArray data;
+
+        // a size of 0 disables the cache
+        cache.insert(Hash(md), md);
+        QVERIFY(!cache.find(Hash(md), data));
+
+        cache.setMaxSize(1024 * 1024);
+        cache.insert(Hash(md), md);
+        QVERIFY(cache.find(Hash(md), data));
+        QCOMPARE(data, md);
+
+        // metadata which does not match its hash is not cached
+        cache.insert(Hash(Metadata(1)), Metadata(2));
+        QVERIFY(!cache.find(Hash(Metadata(1)), data));
+
+        // entries survive a restart
+        MetadataCache other;
+        other.setMaxSize(1024 * 1024);
+        other.open(dir->path());
+        QVERIFY(other.find(Hash(md), data));
+        QCOMPARE(data, md);
+    }
+
+    void testEviction()
+    {
+        const bt::Uint64 size = Metadata(0).size();
+        MetadataCache cache;
+        cache.open(dir->path());
+        cache.setMaxSize(size * 5 / 2);
+
+        QByteArray data;
+        cache.insert(Hash(Metadata(0)), Metadata(0));
+        cache.insert(Hash(Metadata(1)), Metadata(1));
+        cache.insert(Hash(Metadata(2)), Metadata(2));
+        QVERIFY(!cache.find(Hash(Metadata(0)), data));
+        QVERIFY(!QFile::exists(dir->path() + QLatin1Char('/') + Hash(Metadata(0)).toString()));
+
+        // using an entry makes it the last one to go
+        QVERIFY(cache.find(Hash(Metadata(1)), data));
+        cache.insert(Hash(Metadata(3)), Metadata(3));
+        QVERIFY(!cache.find(Hash(Metadata(2)), data));
+        QVERIFY(cache.find(Hash(Metadata(1)), data));
+        QVERIFY(cache.find(Hash(Metadata(3)), data));
+
+        // shrinking the cache evicts right away
+        cache.setMaxSize(size);
+        QVERIFY(!cache.find(Hash(Metadata(1)), data));
+        QVERIFY(cache.find(Hash(Metadata(3)), data));
+    }
+
+    void testCorrupt()
+    {
+        const QByteArray md = Metadata(0);
+        MetadataCache cache;
+        cache.open(dir->path());
+        cache.setMaxSize(1024 * 1024);
+        cache.insert(Hash(md), md);
+
+        const QString path = dir->path() + QLatin1Char('/') + Hash(md).toString();
+        QFile fptr(path);
+        QVERIFY(fptr.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        fptr.write(Metadata(1));
+        fptr.close();
+
+        QByteArray data;
+        QVERIFY(!cache.find(Hash(md), data));
+        QVERIFY(data.isEmpty());
+        QVERIFY(!QFile::exists(path));
+    }
+
+private:
+    QScopedPointer<QTemporaryDir> dir;
+};
+
+QTEST_MAIN(MetadataCacheTest)
+
+#include "metadatacachetest.moc"
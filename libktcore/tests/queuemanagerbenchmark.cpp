@@ -0,0 +1,138 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <torrent/queuemanager.h>
+#include <torrent/torrentcontrol.h>
+#include <util/log.h>
+
+#include "testtorrent.h"
+
+using namespace kt;
+
+// how much more a torrent may cost with 20000 torrents than with 100, a linear scan would be 200 times more
+static const qreal MAX_COST_RATIO = 10.0;
+
+/**
+ * Shows that adding torrents to the QueueManager and looking them up by
+ * info hash does not get more expensive with the number of torrents.
+ */
+class QueueManagerBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("queuemanagerbenchmark.log"), false, false);
+        QVERIFY(tmp.isValid());
+    }
+
+    void cleanupTestCase()
+    {
+        qDeleteAll(qmans);
+        qmans.clear();
+    }
+
+    void benchmarkAppend_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::newRow("100") << 100;
+        QTest::newRow("1000") << 1000;
+        QTest::newRow("20000") << 20000;
+    }
+
+    void benchmarkAppend()
+    {
+        QFETCH(int, count);
+
+        QueueManager *qman = new QueueManager();
+        qmans.insert(count, qman);
+        const QString dir = tmp.path() + QLatin1Char('/') + QString::number(count);
+
+        QList<bt::TorrentControl *> torrents;
+        torrents.reserve(count);
+        for (int i = 0; i < count; i++)
+            torrents.append(CreateTestTorrent(qman, dir, i));
+
+        // this is what loading a torrent costs the QueueManager: the duplicate check and the append
+        QElapsedTimer timer;
+        timer.start();
+        for (bt::TorrentControl *tc : qAsConst(torrents)) {
+            if (!qman->alreadyLoaded(tc->getInfoHash()))
+                qman->append(tc);
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        QCOMPARE(qman->count(), count);
+        QTest::setBenchmarkResult((qreal)elapsed / count, QTest::WalltimeNanoseconds);
+        append_cost.insert(count, (qreal)elapsed / count);
+        checkRatio(append_cost, count);
+    }
+
+    void benchmarkLookup_data()
+    {
+        benchmarkAppend_data();
+    }
+
+    void benchmarkLookup()
+    {
+        QFETCH(int, count);
+
+        QueueManager *qman = qmans.value(count);
+        QVERIFY(qman);
+
+        // the same number of lookups for every size, half of them miss
+        QList<bt::SHA1Hash> hashes;
+        for (int i = 0; i < 100; i++) {
+            hashes.append(qman->getTorrent(i * count / 100)->getInfoHash());
+            hashes.append(bt::SHA1Hash::generate((const bt::Uint8 *)&i, sizeof(int)));
+        }
+
+        int found = 0;
+        QBENCHMARK {
+            found = 0;
+            for (const bt::SHA1Hash &ih : qAsConst(hashes)) {
+                if (qman->find(ih))
+                    found++;
+            }
+        }
+        QCOMPARE(found, 100);
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < 100; i++) {
+            for (const bt::SHA1Hash &ih : qAsConst(hashes))
+                qman->find(ih);
+        }
+        lookup_cost.insert(count, (qreal)timer.nsecsElapsed());
+        checkRatio(lookup_cost, count);
+    }
+
+private:
+    /// Compare the cost with 20000 torrents to the cost with 100, once both are known
+    void checkRatio(const QMap<int, qreal> &costs, int count)
+    {
+        if (count != 20000 || !costs.contains(100) || costs.value(100) <= 0)
+            return;
+
+        const qreal ratio = costs.value(20000) / costs.value(100);
+        QVERIFY2(ratio < MAX_COST_RATIO, qPrintable(QStringLiteral("cost ratio %1").arg(ratio)));
+    }
+
+private:
+    QTemporaryDir tmp;
+    QMap<int, QueueManager *> qmans;
+    QMap<int, qreal> append_cost;
+    QMap<int, qreal> lookup_cost;
+};
+
+QTEST_MAIN(QueueManagerBenchmark)
+
+#include "queuemanagerbenchmark.moc"
@@ -0,0 +1,394 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QHostAddress>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QUdpSocket>
+#include <QtTest>
+
+#include <torrent/queuemanager.h>
+#include <torrent/scrapebatcher.h>
+#include <torrent/torrentcontrol.h>
+#include <util/error.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+#include "testtorrent.h"
+
+using namespace kt;
+
+static QByteArray Hash(int n)
+{
+    const bt::SHA1Hash h = bt::SHA1Hash::generate((const bt::Uint8 *)&n, sizeof(int));
+    return QByteArray((const char *)h.getData(), 20);
+}
+
+static QByteArray InfoHash(bt::TorrentInterface *tc)
+{
+    return QByteArray((const char *)tc->getInfoHash().getData(), 20);
+}
+
+/**
+ * Stand-in for a UDP tracker, it reports n + 1 seeders, n + 2 leechers and n + 3 downloads
+ * for the nth info hash of a scrape. When fail is set, every request gets an error.
+ */
+class UDPTracker : public QObject
+{
+public:
+    UDPTracker(bool fail = false)
+        : fail(fail)
+        , connects(0)
+        , scrapes(0)
+    {
+        socket.bind(QHostAddress::LocalHost, 0);
+        connect(&socket, &QUdpSocket::readyRead, this, &UDPTracker::readPackets);
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QStringLiteral("udp://127.0.0.1:%1/announce").arg(socket.localPort()));
+    }
+
+    void readPackets()
+    {
+        while (socket.hasPendingDatagrams()) {
+            QByteArray packet(socket.pendingDatagramSize(), 0);
+            QHostAddress addr;
+            quint16 port = 0;
+            socket.readDatagram(packet.data(), packet.size(), &addr, &port);
+            if (packet.size() < 16)
+                continue;
+
+            const bt::Uint8 *buf = (const bt::Uint8 *)packet.constData();
+            const bt::Uint32 action = bt::ReadUint32(buf, 8);
+            const bt::Uint32 transaction_id = bt::ReadUint32(buf, 12);
+            QByteArray reply;
+            if (fail) {
+                connects += action == 0 ? 1 : 0;
+                reply = QByteArray(8, 0);
+                reply.append("go away");
+                bt::WriteUint32((bt::Uint8 *)reply.data(), 0, 3);
+            } else if (action == 0) {
+                connects++;
+                reply = QByteArray(16, 0);
+                bt::WriteUint32((bt::Uint8 *)reply.data(), 0, 0);
+                bt::WriteUint64((bt::Uint8 *)reply.data(), 8, CONNECTION_ID);
+            } else if (action == 2 && bt::ReadUint64(buf, 0) == CONNECTION_ID) {
+                scrapes++;
+                const int count = (packet.size() - 16) / 20;
+                reply = QByteArray(8 + 12 * count, 0);
+                bt::WriteUint32((bt::Uint8 *)reply.data(), 0, 2);
+                for (int i = 0; i < count; i++) {
+                    hashes.append(packet.mid(16 + 20 * i, 20));
+                    bt::WriteUint32((bt::Uint8 *)reply.data(), 8 + 12 * i, i + 1);
+                    bt::WriteUint32((bt::Uint8 *)reply.data(), 12 + 12 * i, i + 3);
+                    bt::WriteUint32((bt::Uint8 *)reply.data(), 16 + 12 * i, i + 2);
+                }
+            } else {
+                continue;
+            }
+
+            bt::WriteUint32((bt::Uint8 *)reply.data(), 4, transaction_id);
+            socket.writeDatagram(reply, addr, port);
+        }
+    }
+
+    static const bt::Uint64 CONNECTION_ID = 0x1234567890ULL;
+
+    QUdpSocket socket;
+    bool fail;
+    int connects;
+    int scrapes;
+    QList<QByteArray> hashes;
+};
+
+/**
+ * Stand-in for an HTTP tracker, which answers scrapes like the UDP one.
+ */
+class HTTPTracker : public QObject
+{
+public:
+    HTTPTracker()
+    {
+        server.listen(QHostAddress::LocalHost, 0);
+        connect(&server, &QTcpServer::newConnection, this, [this]() {
+            while (server.hasPendingConnections()) {
+                QTcpSocket *s = server.nextPendingConnection();
+                connect(s, &QTcpSocket::readyRead, this, [this, s]() {
+                    request += s->readAll();
+                    if (request.contains("\r\n\r\n"))
+                        reply(s);
+                });
+                connect(s, &QTcpSocket::disconnected, s, &QObject::deleteLater);
+            }
+        });
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1/announce.php?passkey=abc").arg(server.serverPort()));
+    }
+
+    void reply(QTcpSocket *s)
+    {
+        // GET /scrape.php?passkey=abc&info_hash=...&info_hash=... HTTP/1.1
+        paths.append(request.mid(4, request.indexOf(' ', 4) - 4));
+        request.clear();
+
+        const QByteArray query = paths.last().mid(paths.last().indexOf('?') + 1);
+        QByteArray body = "d5:filesd";
+        int i = 0;
+        for (const QByteArray &param : query.split('&')) {
+            if (!param.startsWith("info_hash="))
+                continue;
+
+            const QByteArray hash = QByteArray::fromPercentEncoding(param.mid(10));
+            body += "20:" + hash + "d8:completei" + QByteArray::number(i + 1) + "e10:downloadedi" + QByteArray::number(i + 3) + "e10:incompletei"
+                + QByteArray::number(i + 2) + "ee";
+            i++;
+        }
+        body += "ee";
+
+        s->write(QByteArray("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n\r\n"
+                            + body));
+        s->disconnectFromHost();
+    }
+
+    QTcpServer server;
+    QByteArray request;
+    QList<QByteArray> paths;
+};
+
+/**
+ * Batcher which treats some torrents as running, and keeps track of
+ * the torrents which would have scraped by themselves.
+ */
+class TestBatcher : public ScrapeBatcher
+{
+public:
+    QSet<bt::TorrentInterface *> running;
+    QList<bt::TorrentInterface *> scraped_itself;
+
+protected:
+    bool isRunning(bt::TorrentInterface *tc) const override
+    {
+        return running.contains(tc);
+    }
+
+    void scrapeItself(bt::TorrentInterface *tc) override
+    {
+        scraped_itself.append(tc);
+    }
+};
+
+class ScrapeBatcherTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        bt::InitLog(QStringLiteral("scrapebatchertest.log"), false, false);
+        // the batcher uses the time stamp of the last update, like the rest of the queue manager
+        bt::UpdateCurrentTime();
+        QVERIFY(tmp.isValid());
+    }
+
+    void testScrapeURL()
+    {
+        QCOMPARE(ScrapeBatcher::scrapeURL(QUrl(QStringLiteral("http://tracker.example.org/announce"))),
+                 QUrl(QStringLiteral("http://tracker.example.org/scrape")));
+        QCOMPARE(ScrapeBatcher::scrapeURL(QUrl(QStringLiteral("https://tracker.example.org/x/announce.php?passkey=abc"))),
+                 QUrl(QStringLiteral("https://tracker.example.org/x/scrape.php?passkey=abc")));
+        QCOMPARE(ScrapeBatcher::scrapeURL(QUrl(QStringLiteral("udp://tracker.example.org:6969"))), QUrl(QStringLiteral("udp://tracker.example.org:6969")));
+        QVERIFY(!ScrapeBatcher::scrapeURL(QUrl(QStringLiteral("http://tracker.example.org/a"))).isValid());
+        QVERIFY(!ScrapeBatcher::scrapeURL(QUrl(QStringLiteral("http://tracker.example.org/x/announce/y"))).isValid());
+        QVERIFY(!ScrapeBatcher::scrapeURL(QUrl(QStringLiteral("wss://tracker.example.org/announce"))).isValid());
+    }
+
+    void testHTTPEncoding()
+    {
+        const QList<QByteArray> hashes = QList<QByteArray>() << Hash(0) << Hash(1);
+        const QUrl url = ScrapeBatcher::httpScrapeURL(QUrl(QStringLiteral("http://tracker.example.org/announce.php?passkey=abc")), hashes);
+        QCOMPARE(url.path(), QStringLiteral("/scrape.php"));
+        QCOMPARE(url.query(QUrl::FullyEncoded).toLatin1(),
+                 QByteArray("passkey=abc&info_hash=" + Hash(0).toPercentEncoding() + "&info_hash=" + Hash(1).toPercentEncoding()));
+        QVERIFY(!ScrapeBatcher::httpScrapeURL(QUrl(QStringLiteral("http://tracker.example.org/a")), hashes).isValid());
+    }
+
+    void testHTTPDecoding()
+    {
+        const QByteArray data = "d5:filesd20:" + Hash(0) + "d8:completei5e10:downloadedi7e10:incompletei3ee20:" + Hash(1)
+            + "d8:completei1e10:incompletei0ee3:badd8:completei1eeee";
+        const QHash<QByteArray, ScrapeBatcher::Result> res = ScrapeBatcher::decodeHTTPScrape(data);
+        QCOMPARE(res.count(), 2);
+        QCOMPARE(res.value(Hash(0)).seeders, 5);
+        QCOMPARE(res.value(Hash(0)).leechers, 3);
+        QCOMPARE(res.value(Hash(0)).completed, 7);
+        QCOMPARE(res.value(Hash(1)).seeders, 1);
+        QCOMPARE(res.value(Hash(1)).leechers, 0);
+        QCOMPARE(res.value(Hash(1)).completed, -1);
+
+        QVERIFY(ScrapeBatcher::decodeHTTPScrape("d14:failure reason5:nopee").isEmpty());
+        QVERIFY_EXCEPTION_THROWN(ScrapeBatcher::decodeHTTPScrape("i42e"), bt::Error);
+        QVERIFY_EXCEPTION_THROWN(ScrapeBatcher::decodeHTTPScrape("<html>"), bt::Error);
+    }
+
+    void testUDPEncoding()
+    {
+        const QList<QByteArray> hashes = QList<QByteArray>() << Hash(0) << Hash(1) << Hash(2);
+        const QByteArray packet = ScrapeBatcher::udpScrapeRequest(0x1122334455667788ULL, 0xCAFEBABE, hashes);
+        QCOMPARE(packet.size(), 16 + 3 * 20);
+
+        const bt::Uint8 *buf = (const bt::Uint8 *)packet.constData();
+        QCOMPARE(bt::ReadUint64(buf, 0), 0x1122334455667788ULL);
+        QCOMPARE(bt::ReadUint32(buf, 8), 2u);
+        QCOMPARE(bt::ReadUint32(buf, 12), 0xCAFEBABEu);
+        for (int i = 0; i < 3; i++)
+            QCOMPARE(packet.mid(16 + 20 * i, 20), hashes.at(i));
+    }
+
+    void testUDPDecoding()
+    {
+        const QList<QByteArray> hashes = QList<QByteArray>() << Hash(0) << Hash(1) << Hash(2);
+        QByteArray packet(8 + 12 * 3, 0);
+        bt::Uint8 *buf = (bt::Uint8 *)packet.data();
+        bt::WriteUint32(buf, 0, 2);
+        bt::WriteUint32(buf, 4, 0xCAFEBABE);
+        for (int i = 0; i < 3; i++) {
+            bt::WriteUint32(buf, 8 + 12 * i, 10 * i);
+            bt::WriteUint32(buf, 12 + 12 * i, 10 * i + 1);
+            bt::WriteUint32(buf, 16 + 12 * i, 10 * i + 2);
+        }
+
+        QHash<QByteArray, ScrapeBatcher::Result> res = ScrapeBatcher::decodeUDPScrape(packet, hashes);
+        QCOMPARE(res.count(), 3);
+        QCOMPARE(res.value(Hash(2)).seeders, 20);
+        QCOMPARE(res.value(Hash(2)).completed, 21);
+        QCOMPARE(res.value(Hash(2)).leechers, 22);
+
+        // a truncated response only gives the results which are complete
+        res = ScrapeBatcher::decodeUDPScrape(packet.left(8 + 12 * 2 - 1), hashes);
+        QCOMPARE(res.count(), 1);
+        QVERIFY(res.contains(Hash(0)));
+    }
+
+    void testUDPTracker()
+    {
+        UDPTracker tracker;
+        QueueManager qman;
+        bt::TorrentControl *a = CreateTestTorrent(&qman, tmp.path(), 0, tracker.url().toString());
+        bt::TorrentControl *b = CreateTestTorrent(&qman, tmp.path(), 1, tracker.url().toString());
+        qman.append(a);
+        qman.append(b);
+
+        ScrapeBatcher batcher;
+        QSignalSpy spy(&batcher, &ScrapeBatcher::scraped);
+        batcher.scrape(a);
+        batcher.scrape(b);
+        batcher.scrape(a);
+        QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 2, 10000);
+
+        // one connect and one scrape for both torrents
+        QCOMPARE(tracker.connects, 1);
+        QCOMPARE(tracker.scrapes, 1);
+        QCOMPARE(tracker.hashes, QList<QByteArray>() << InfoHash(a) << InfoHash(b));
+
+        ScrapeBatcher::Result r;
+        QVERIFY(batcher.result(b, r));
+        QCOMPARE(r.seeders, 2);
+        QCOMPARE(r.leechers, 3);
+        QCOMPARE(r.completed, 4);
+        QVERIFY(r.time > 0);
+
+        batcher.remove(b);
+        QVERIFY(!batcher.result(b, r));
+        QVERIFY(batcher.result(tracker.url(), a, r));
+    }
+
+    void testHTTPTracker()
+    {
+        HTTPTracker tracker;
+        QueueManager qman;
+        bt::TorrentControl *a = CreateTestTorrent(&qman, tmp.path(), 2, tracker.url().toString());
+        bt::TorrentControl *b = CreateTestTorrent(&qman, tmp.path(), 3, tracker.url().toString());
+        qman.append(a);
+        qman.append(b);
+
+        ScrapeBatcher batcher;
+        QSignalSpy spy(&batcher, &ScrapeBatcher::scraped);
+        batcher.scrape(a);
+        batcher.scrape(b);
+        QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 2, 10000);
+
+        QCOMPARE(tracker.paths.count(), 1);
+        QVERIFY(tracker.paths.first().startsWith("/scrape.php?passkey=abc&info_hash="));
+
+        ScrapeBatcher::Result r;
+        QVERIFY(batcher.result(a, r));
+        QCOMPARE(r.seeders + r.leechers + r.completed, 1 + 2 + 3);
+        QVERIFY(batcher.result(b, r));
+        QCOMPARE(r.seeders + r.leechers + r.completed, 2 + 3 + 4);
+    }
+
+    void testBackoff()
+    {
+        UDPTracker tracker(true);
+        QueueManager qman;
+        bt::TorrentControl *a = CreateTestTorrent(&qman, tmp.path(), 4, tracker.url().toString());
+        bt::TorrentControl *b = CreateTestTorrent(&qman, tmp.path(), 5, tracker.url().toString());
+        qman.append(a);
+        qman.append(b);
+
+        ScrapeBatcher batcher;
+        QSignalSpy spy(&batcher, &ScrapeBatcher::scraped);
+        batcher.scrape(a);
+        batcher.scrape(b);
+        QTRY_COMPARE_WITH_TIMEOUT(tracker.connects, 1, 10000);
+
+        // the failed batch is not retried torrent by torrent, and new requests wait
+        batcher.scrape(a);
+        QTest::qWait(5000);
+        QCOMPARE(tracker.connects, 1);
+        QCOMPARE(spy.count(), 0);
+    }
+
+    void testRunning()
+    {
+        UDPTracker tracker;
+        QueueManager qman;
+        bt::TorrentControl *a = CreateTestTorrent(&qman, tmp.path(), 6, tracker.url().toString());
+        bt::TorrentControl *b = CreateTestTorrent(&qman, tmp.path(), 7, tracker.url().toString());
+        qman.append(a);
+        qman.append(b);
+
+        TestBatcher batcher;
+        batcher.running.insert(a);
+        QSignalSpy spy(&batcher, &ScrapeBatcher::scraped);
+        batcher.scrape(a);
+        batcher.scrape(b);
+        QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 1, 10000);
+
+        // the running torrent scrapes by itself, so the counts of its own tracker are up to date
+        QCOMPARE(batcher.scraped_itself, QList<bt::TorrentInterface *>() << a);
+        QCOMPARE(tracker.hashes, QList<QByteArray>() << InfoHash(b));
+
+        ScrapeBatcher::Result r;
+        QVERIFY(!batcher.result(a, r));
+        QVERIFY(batcher.result(b, r));
+    }
+
+private:
+    QTemporaryDir tmp;
+};
+
+QTEST_MAIN(ScrapeBatcherTest)
+
+#include "scrapebatchertest.moc"
@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <torrent/queuemanager.h>
+#include <torrent/seedranker.h>
+#include <torrent/torrentcontrol.h>
+#include <util/log.h>
+
+#include "testtorrent.h"
+
+using namespace kt;
+
+const bt::TimeStamp HOUR = 3600 * 1000;
+
+class SeedRankerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("seedrankertest.log"), false, false);
+        QVERIFY(tmp.isValid());
+        for (int i = 0; i < 3; i++)
+            qman.append(CreateTestTorrent(&qman, tmp.path(), i));
+    }
+
+    void testIdleTime()
+    {
+        // none of the torrents has peers or uploads, so only the time since they were seeded counts
+        bt::TorrentInterface *recent = qman.getTorrent(0);
+        bt::TorrentInterface *old = qman.getTorrent(1);
+        bt::TorrentInterface *never = qman.getTorrent(2);
+
+        const bt::TimeStamp now = 100 * HOUR;
+        SeedRanker ranker;
+        ranker.stopped(recent, now);
+        ranker.stopped(old, now - 3 * HOUR);
+
+        const QList<bt::TorrentInterface *> ranking = ranker.rank(QList<bt::TorrentInterface *>() << recent << old << never, now);
+        QCOMPARE(ranking, QList<bt::TorrentInterface *>() << never << old << recent);
+        QVERIFY(ranker.lastScore(never) > ranker.lastScore(old));
+        QVERIFY(ranker.lastScore(old) > ranker.lastScore(recent));
+        QVERIFY(ranker.lastScore(recent) > 0.0);
+
+        // the aging bonus is capped
+        QCOMPARE(ranker.score(old, now + 1000 * HOUR), ranker.score(never, now));
+
+        ranker.remove(old);
+        QCOMPARE(ranker.lastScore(old), 0.0);
+        QCOMPARE(ranker.score(old, now), ranker.score(never, now));
+    }
+
+    void testStable()
+    {
+        const bt::TimeStamp now = 100 * HOUR;
+        SeedRanker ranker;
+        QList<bt::TorrentInterface *> seeds;
+        for (int i = 0; i < 3; i++) {
+            ranker.sample(qman.getTorrent(i), now);
+            seeds.prepend(qman.getTorrent(i));
+        }
+
+        // equal scores keep the queue order
+        QCOMPARE(ranker.rank(seeds, now), seeds);
+
+        ranker.clear();
+        for (bt::TorrentInterface *tc : qAsConst(seeds))
+            QCOMPARE(ranker.lastScore(tc), 0.0);
+    }
+
+private:
+    QTemporaryDir tmp;
+    QueueManager qman;
+};
+
+QTEST_MAIN(SeedRankerTest)
+
+#include "seedrankertest.moc"
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <groups/group.h>
+#include <groups/groupmanager.h>
+#include <interfaces/trackerinterface.h>
+#include <interfaces/trackerslist.h>
+#include <torrent/queuemanager.h>
+#include <torrent/statsaggregator.h>
+#include <torrent/torrentcontrol.h>
+#include <util/log.h>
+
+#include "testtorrent.h"
+
+using namespace kt;
+
+static CurrentStats Stats(bt::Uint32 down, bt::Uint32 up, bt::Uint64 downloaded, bt::Uint64 uploaded)
+{
+    CurrentStats s;
+    s.download_speed = down;
+    s.upload_speed = up;
+    s.bytes_downloaded = downloaded;
+    s.bytes_uploaded = uploaded;
+    return s;
+}
+
+static bool operator==(const CurrentStats &a, const CurrentStats &b)
+{
+    return a.download_speed == b.download_speed && a.upload_speed == b.upload_speed && a.bytes_downloaded == b.bytes_downloaded
+        && a.bytes_uploaded == b.bytes_uploaded;
+}
+
+// the torrents are not running, so their stats are filled in by the test
+class TestAggregator : public StatsAggregator
+{
+public:
+    TestAggregator(GroupManager *gman)
+        : StatsAggregator(gman)
+    {
+    }
+
+    CurrentStats statsOf(bt::TorrentInterface *tc) const override
+    {
+        return stats.value(tc, Stats(0, 0, 0, 0));
+    }
+
+    QHash<bt::TorrentInterface *, CurrentStats> stats;
+};
+
+class StatsAggregatorTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("statsaggregatortest.log"), false, false);
+        QVERIFY(tmp.isValid());
+
+        a = CreateTestTorrent(&qman, tmp.path(), 0, QStringLiteral("http://tracker.example.org/announce"));
+        b = CreateTestTorrent(&qman, tmp.path(), 1);
+        qman.append(a);
+        qman.append(b);
+
+        group = gman.newGroup(QStringLiteral("test"));
+        group->addTorrent(a, false);
+
+        bt::TrackerInterface *tracker = a->getTrackersList()->getCurrentTracker();
+        QVERIFY(tracker);
+        host = tracker->trackerURL().host();
+        QCOMPARE(host, QStringLiteral("tracker.example.org"));
+    }
+
+    void testTotals()
+    {
+        TestAggregator agg(&gman);
+        agg.stats[a] = Stats(100, 10, 1000, 500);
+        agg.stats[b] = Stats(50, 5, 200, 100);
+        agg.add(a);
+        agg.add(b);
+
+        QVERIFY(agg.totals() == Stats(150, 15, 1200, 600));
+        QVERIFY(agg.groupTotals(QStringLiteral("/all")) == Stats(150, 15, 1200, 600));
+        QVERIFY(agg.groupTotals(group->groupPath()) == Stats(100, 10, 1000, 500));
+        QVERIFY(agg.trackerTotals(host) == Stats(100, 10, 1000, 500));
+        QCOMPARE(agg.trackers(), QStringList() << host);
+
+        // only the difference is applied, decreasing speeds included
+        agg.stats[a] = Stats(20, 0, 1500, 600);
+        agg.update(a);
+        QVERIFY(agg.totals() == Stats(70, 5, 1700, 700));
+        QVERIFY(agg.groupTotals(group->groupPath()) == Stats(20, 0, 1500, 600));
+        QVERIFY(agg.trackerTotals(host) == Stats(20, 0, 1500, 600));
+
+        // adding twice has no effect
+        agg.add(a);
+        QVERIFY(agg.totals() == Stats(70, 5, 1700, 700));
+    }
+
+    void testRemove()
+    {
+        TestAggregator agg(&gman);
+        agg.stats[a] = Stats(100, 10, 1000, 500);
+        agg.stats[b] = Stats(50, 5, 200, 100);
+        agg.add(a);
+        agg.add(b);
+
+        // the bytes transferred in this session stay part of all totals, the speeds are removed
+        agg.remove(a);
+        QVERIFY(agg.totals() == Stats(50, 5, 1200, 600));
+        QVERIFY(agg.groupTotals(QStringLiteral("/all")) == Stats(50, 5, 1200, 600));
+        QVERIFY(agg.groupTotals(group->groupPath()) == Stats(0, 0, 1000, 500));
+        QVERIFY(agg.trackerTotals(host) == Stats(0, 0, 1000, 500));
+        agg.remove(a);
+        QVERIFY(agg.totals() == Stats(50, 5, 1200, 600));
+    }
+
+    void testGroups()
+    {
+        TestAggregator agg(&gman);
+        agg.stats[a] = Stats(100, 10, 1000, 500);
+        agg.add(a);
+        QVERIFY(agg.groupTotals(group->groupPath()) == Stats(100, 10, 1000, 500));
+
+        group->removeTorrent(a);
+        agg.updateGroups(a);
+        QVERIFY(agg.groupTotals(group->groupPath()) == Stats(0, 0, 0, 0));
+
+        group->addTorrent(a, false);
+        agg.updateGroups();
+        QVERIFY(agg.groupTotals(group->groupPath()) == Stats(100, 10, 1000, 500));
+    }
+
+private:
+    QTemporaryDir tmp;
+    QueueManager qman;
+    GroupManager gman;
+    Group *group = nullptr;
+    bt::TorrentControl *a = nullptr;
+    bt::TorrentControl *b = nullptr;
+    QString host;
+};
+
+QTEST_MAIN(StatsAggregatorTest)
+
+#include "statsaggregatortest.moc"
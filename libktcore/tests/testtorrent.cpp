@@ -0,0 +1,44 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "testtorrent.h"
+
+#include <QDir>
+
+#include <torrent/queuemanager.h>
+#include <torrent/torrentcontrol.h>
+
+namespace kt
+{
+static QByteArray String(const QByteArray &s)
+{
+    return QByteArray::number(s.size()) + ':' + s;
+}
+
+QByteArray TestTorrentData(int n, const QString &announce)
+{
+    const QByteArray name = "torrent" + QByteArray::number(n);
+    QByteArray data = "d";
+    if (!announce.isEmpty())
+        data += String("announce") + String(announce.toUtf8());
+    // the hash of the single chunk does not matter, the data is never checked
+    data += String("info") + "d" + String("length") + "i16384e" + String("name") + String(name);
+    data += String("piece length") + "i16384e" + String("pieces") + String(QByteArray(20, 'x'));
+    data += "ee";
+    return data;
+}
+
+bt::TorrentControl *CreateTestTorrent(QueueManager *qman, const QString &dir, int n, const QString &announce)
+{
+    const QString tor_dir = dir + QLatin1String("/tor") + QString::number(n) + QLatin1Char('/');
+    const QString data_dir = dir + QLatin1String("/data/");
+    QDir().mkpath(data_dir);
+
+    bt::TorrentControl *tc = new bt::TorrentControl();
+    tc->init(qman, TestTorrentData(n, announce), tor_dir, data_dir);
+    return tc;
+}
+}
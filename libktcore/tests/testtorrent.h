@@ -0,0 +1,39 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TESTTORRENT_H
+#define KT_TESTTORRENT_H
+
+#include <QByteArray>
+#include <QString>
+
+namespace bt
+{
+class TorrentControl;
+}
+
+namespace kt
+{
+class QueueManager;
+
+/**
+ * Generate a small single file torrent, every number gives a torrent with its own info hash.
+ * @param n Number of the torrent
+ * @param announce Announce URL, no announce URL is added if it is empty
+ */
+QByteArray TestTorrentData(int n, const QString &announce = QString());
+
+/**
+ * Create a torrent which is not running.
+ * @param qman The QueueManager the torrent is loaded for (it is not appended to it)
+ * @param dir Directory in which the torX dir and the data of the torrent are stored
+ * @param n Number of the torrent
+ * @param announce Announce URL
+ */
+bt::TorrentControl *CreateTestTorrent(QueueManager *qman, const QString &dir, int n, const QString &announce = QString());
+}
+
+#endif
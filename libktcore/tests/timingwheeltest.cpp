@@ -0,0 +1,127 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QtTest>
+
+#include <torrent/timingwheel.h>
+#include <util/log.h>
+
+using namespace kt;
+
+// the wheel never looks at the torrents, so any distinct pointer will do
+static bt::TorrentInterface *Torrent(int n)
+{
+    return reinterpret_cast<bt::TorrentInterface *>(quintptr(n + 1) * 16);
+}
+
+class TimingWheelTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("timingwheeltest.log"), false, false);
+    }
+
+    void testExpire()
+    {
+        TimingWheel wheel;
+        // the wheel starts at the second of the first deadline, so that one is due at the next second
+        wheel.schedule(Torrent(0), 10 * 1000);
+        wheel.schedule(Torrent(1), 20 * 1000);
+        wheel.schedule(Torrent(2), 20 * 1000 + 500);
+
+        QVERIFY(wheel.expire(10 * 1000 + 999).isEmpty());
+        QCOMPARE(wheel.expire(11 * 1000), QList<bt::TorrentInterface *>() << Torrent(0));
+        QVERIFY(!wheel.contains(Torrent(0)));
+        QVERIFY(wheel.expire(19 * 1000 + 999).isEmpty());
+        QCOMPARE(wheel.expire(20 * 1000), QList<bt::TorrentInterface *>() << Torrent(1));
+
+        // a deadline in the middle of a second is not expired at the start of that second
+        QVERIFY(wheel.contains(Torrent(2)));
+        QVERIFY(wheel.expire(20 * 1000 + 499).isEmpty());
+        QCOMPARE(wheel.expire(21 * 1000), QList<bt::TorrentInterface *>() << Torrent(2));
+        QVERIFY(!wheel.contains(Torrent(2)));
+    }
+
+    void testReschedule()
+    {
+        TimingWheel wheel;
+        wheel.schedule(Torrent(0), 10 * 1000);
+        wheel.schedule(Torrent(1), 20 * 1000);
+        wheel.schedule(Torrent(2), 20 * 1000);
+        wheel.schedule(Torrent(1), 30 * 1000);
+        wheel.cancel(Torrent(2));
+
+        QVERIFY(!wheel.contains(Torrent(2)));
+        QCOMPARE(wheel.expire(29 * 1000), QList<bt::TorrentInterface *>() << Torrent(0));
+        QCOMPARE(wheel.expire(30 * 1000), QList<bt::TorrentInterface *>() << Torrent(1));
+    }
+
+    void testOverdue()
+    {
+        TimingWheel wheel;
+        wheel.schedule(Torrent(0), 100 * 1000);
+        QCOMPARE(wheel.expire(101 * 1000), QList<bt::TorrentInterface *>() << Torrent(0));
+
+        // deadlines in the past are expired at the next second
+        wheel.schedule(Torrent(1), 50 * 1000);
+        QCOMPARE(wheel.expire(102 * 1000), QList<bt::TorrentInterface *>() << Torrent(1));
+    }
+
+    void testFarAway()
+    {
+        const bt::TimeStamp far = 1000 + 1000 * 1000;
+        const bt::TimeStamp very_far = 1000 + 100000 * 1000ULL;
+
+        TimingWheel wheel;
+        wheel.schedule(Torrent(0), 1000);
+        // beyond the first level and beyond the whole wheel
+        wheel.schedule(Torrent(1), far);
+        wheel.schedule(Torrent(2), very_far);
+        QCOMPARE(wheel.expire(2000), QList<bt::TorrentInterface *>() << Torrent(0));
+
+        bt::TimeStamp now = 2000;
+        QList<bt::TorrentInterface *> expired;
+        while (expired.isEmpty() && now < 2 * far) {
+            now += 60 * 1000;
+            expired = wheel.expire(now);
+        }
+        QCOMPARE(expired, QList<bt::TorrentInterface *>() << Torrent(1));
+        QVERIFY(now >= far && now < far + 60 * 1000);
+        QVERIFY(wheel.contains(Torrent(2)));
+
+        // a long gap between calls expires everything which is due
+        QCOMPARE(wheel.expire(very_far), QList<bt::TorrentInterface *>() << Torrent(2));
+    }
+
+    void testMany()
+    {
+        const int count = 10000;
+        TimingWheel wheel;
+        wheel.schedule(Torrent(count), 1000);
+        for (int i = 0; i < count; i++)
+            wheel.schedule(Torrent(i), 2000 + (i % 600) * 1000);
+
+        int expired = 0;
+        for (bt::TimeStamp now = 2000; now <= 601 * 1000; now += 1000) {
+            const QList<bt::TorrentInterface *> tcs = wheel.expire(now);
+            for (bt::TorrentInterface *tc : tcs) {
+                const int i = quintptr(tc) / 16 - 1;
+                if (i == count)
+                    continue;
+
+                QCOMPARE(bt::TimeStamp(2000 + (i % 600) * 1000), now);
+                expired++;
+            }
+        }
+        QCOMPARE(expired, count);
+    }
+};
+
+QTEST_MAIN(TimingWheelTest)
+
+#include "timingwheeltest.moc"
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <groups/group.h>
+#include <groups/groupmanager.h>
+#include <torrent/queuemanager.h>
+#include <torrent/torrentcontrol.h>
+#include <torrent/torrentsnapshot.h>
+#include <util/log.h>
+
+#include "testtorrent.h"
+
+using namespace kt;
+
+class TorrentSnapshotTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("torrentsnapshottest.log"), false, false);
+        QVERIFY(tmp.isValid());
+        file = tmp.path() + QLatin1String("/snapshot");
+
+        for (int i = 0; i < 3; i++)
+            qman.append(CreateTestTorrent(&qman, tmp.path(), i));
+        group = gman.newGroup(QStringLiteral("test"));
+        group->addTorrent(qman.getTorrent(1), false);
+    }
+
+    void testRoundTrip()
+    {
+        TorrentSnapshot::save(file, &qman, &gman);
+
+        TorrentSnapshot snapshot;
+        QVERIFY(snapshot.load(file));
+        QCOMPARE(snapshot.entries().count(), 3);
+        for (int i = 0; i < 3; i++) {
+            bt::TorrentInterface *tc = qman.getTorrent(i);
+            const TorrentSnapshot::Entry *e = snapshot.find(tc->getInfoHash());
+            QVERIFY(e);
+            QCOMPARE(e->name, tc->getDisplayName());
+            QCOMPARE(e->total_bytes_to_download, tc->getStats().total_bytes_to_download);
+            QCOMPARE(e->running, false);
+            QVERIFY(e->groups.contains(QStringLiteral("/all")));
+            QCOMPARE(e->groups.contains(group->groupPath()), i == 1);
+        }
+
+        QVERIFY(!snapshot.find(bt::SHA1Hash()));
+        snapshot.clear();
+        QVERIFY(snapshot.isEmpty());
+    }
+
+    void testCorrupt()
+    {
+        TorrentSnapshot::save(file, &qman, &gman);
+
+        QFile fptr(file);
+        QVERIFY(fptr.open(QIODevice::ReadWrite));
+        QByteArray data = fptr.readAll();
+        data[data.size() - 1] = data[data.size() - 1] ^ 0xFF;
+        fptr.seek(0);
+        fptr.write(data);
+        fptr.close();
+
+        TorrentSnapshot snapshot;
+        QVERIFY(!snapshot.load(file));
+        QVERIFY(snapshot.isEmpty());
+    }
+
+    void testTruncated()
+    {
+        TorrentSnapshot::save(file, &qman, &gman);
+        QVERIFY(QFile::resize(file, QFileInfo(file).size() / 2));
+
+        TorrentSnapshot snapshot;
+        QVERIFY(!snapshot.load(file));
+        QVERIFY(snapshot.isEmpty());
+    }
+
+    void testEmpty()
+    {
+        QueueManager empty_qman;
+        GroupManager empty_gman;
+        TorrentSnapshot::save(file, &empty_qman, &empty_gman);
+
+        TorrentSnapshot snapshot;
+        QVERIFY(snapshot.load(file));
+        QVERIFY(snapshot.isEmpty());
+    }
+
+    void testWrite()
+    {
+        const QByteArray data = TorrentSnapshot::encode(&qman, &gman);
+        QVERIFY(TorrentSnapshot::write(file, data));
+
+        TorrentSnapshot snapshot;
+        QVERIFY(snapshot.load(file));
+        QCOMPARE(snapshot.entries().count(), 3);
+        QCOMPARE(snapshot.find(qman.getTorrent(1)->getInfoHash())->groups.contains(group->groupPath()), true);
+    }
+
+    void testDormant()
+    {
+        TorrentSnapshot::save(file, &qman, &gman);
+        TorrentSnapshot previous;
+        QVERIFY(previous.load(file));
+
+        // torrents which were not loaded are saved again from the previous snapshot
+        QueueManager empty_qman;
+        QList<const TorrentSnapshot::Entry *> dormant;
+        dormant << previous.find(qman.getTorrent(1)->getInfoHash()) << previous.find(qman.getTorrent(2)->getInfoHash());
+        TorrentSnapshot::save(file, &empty_qman, &gman, dormant);
+
+        TorrentSnapshot snapshot;
+        QVERIFY(snapshot.load(file));
+        QCOMPARE(snapshot.entries().count(), 2);
+        QVERIFY(!snapshot.find(qman.getTorrent(0)->getInfoHash()));
+        const TorrentSnapshot::Entry *e = snapshot.find(qman.getTorrent(1)->getInfoHash());
+        QVERIFY(e);
+        QCOMPARE(e->name, qman.getTorrent(1)->getDisplayName());
+        QCOMPARE(e->total_bytes_to_download, qman.getTorrent(1)->getStats().total_bytes_to_download);
+        QCOMPARE(e->time_added, dormant.first()->time_added);
+        QVERIFY(e->groups.contains(group->groupPath()));
+    }
+
+    void testMissing()
+    {
+        TorrentSnapshot snapshot;
+        QVERIFY(!snapshot.load(tmp.path() + QLatin1String("/missing")));
+    }
+
+private:
+    QTemporaryDir tmp;
+    QString file;
+    QueueManager qman;
+    GroupManager gman;
+    Group *group = nullptr;
+};
+
+QTEST_MAIN(TorrentSnapshotTest)
+
+#include "torrentsnapshottest.moc"
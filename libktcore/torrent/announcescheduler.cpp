@@ -0,0 +1,204 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "announcescheduler.h"
+
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+#include <interfaces/torrentinterface.h>
+#include <interfaces/trackerinterface.h>
+#include <interfaces/trackerslist.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+// how often the queue is checked while there are announces waiting
+const int PROCESS_INTERVAL = 250;
+// an announce which takes longer than this no longer counts against the limit of its tracker
+const bt::TimeStamp ANNOUNCE_TIMEOUT = 30 * 1000;
+// give the tracker a moment to change its status after an announce was started
+const bt::TimeStamp ANNOUNCE_GRACE = 1000;
+
+AnnounceScheduler::AnnounceScheduler(QObject *parent)
+    : QObject(parent)
+    , window(60 * 1000)
+    , max_per_tracker(4)
+{
+    timer.setInterval(PROCESS_INTERVAL);
+    connect(&timer, &QTimer::timeout, this, &AnnounceScheduler::process);
+}
+
+AnnounceScheduler::~AnnounceScheduler()
+{
+}
+
+void AnnounceScheduler::announce(bt::TorrentInterface *tc)
+{
+    schedule(tc, ANNOUNCE, bt::Now());
+    process();
+}
+
+void AnnounceScheduler::networkUp(const QList<bt::TorrentInterface *> &torrents)
+{
+    if (torrents.isEmpty())
+        return;
+
+    Out(SYS_GEN | LOG_NOTICE) << "Spreading reannounce of " << torrents.count() << " torrents over " << (window / 1000) << " seconds" << endl;
+
+    // every torrent gets its own part of the window, and a random moment within that part
+    const bt::TimeStamp now = bt::Now();
+    const double part = (double)window / torrents.count();
+    QRandomGenerator *rng = QRandomGenerator::global();
+    for (int i = 0; i < torrents.count(); i++) {
+        const bt::TimeStamp jitter = part >= 1.0 ? rng->bounded((quint32)part) : 0;
+        schedule(torrents.at(i), NETWORK_UP, now + (bt::TimeStamp)(i * part) + jitter);
+    }
+    process();
+}
+
+void AnnounceScheduler::schedule(bt::TorrentInterface *tc, Kind kind, bt::TimeStamp due)
+{
+    QHash<bt::TorrentInterface *, Kind>::iterator p = pending.find(tc);
+    if (p != pending.end()) {
+        // a network up includes an announce, so it replaces a waiting announce,
+        // a torrent waiting for a network up stays where it is
+        if (p.value() == NETWORK_UP || kind == ANNOUNCE)
+            return;
+
+        for (int i = 0; i < queue.count(); i++) {
+            if (queue[i].tc == tc) {
+                due = std::min(due, queue[i].due);
+                queue.removeAt(i);
+                break;
+            }
+        }
+    }
+
+    Request r;
+    r.tc = tc;
+    r.kind = kind;
+    r.due = due;
+
+    // insert sorted on due time, most requests go at the back
+    int idx = queue.count();
+    while (idx > 0 && queue[idx - 1].due > due)
+        idx--;
+    queue.insert(idx, r);
+    pending.insert(tc, kind);
+
+    if (!timer.isActive())
+        timer.start();
+}
+
+void AnnounceScheduler::remove(bt::TorrentInterface *tc)
+{
+    if (pending.remove(tc) > 0) {
+        for (int i = 0; i < queue.count(); i++) {
+            if (queue[i].tc == tc) {
+                queue.removeAt(i);
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < in_flight.count(); i++) {
+        if (in_flight[i].tc == tc) {
+            in_flight.removeAt(i);
+            break;
+        }
+    }
+}
+
+void AnnounceScheduler::clear()
+{
+    queue.clear();
+    pending.clear();
+    in_flight.clear();
+    timer.stop();
+}
+
+void AnnounceScheduler::setWindow(bt::Uint32 secs)
+{
+    window = (bt::TimeStamp)secs * 1000;
+}
+
+void AnnounceScheduler::setMaxPerTracker(int m)
+{
+    max_per_tracker = m;
+}
+
+QString AnnounceScheduler::trackerHost(bt::TorrentInterface *tc)
+{
+    // torrents without a tracker share one limit, which keeps DHT lookups in check as well
+    bt::TrackersList *tlist = tc->getTrackersList();
+    bt::TrackerInterface *tracker = tlist ? tlist->getCurrentTracker() : nullptr;
+    return tracker ? tracker->trackerURL().host() : QString();
+}
+
+bool AnnounceScheduler::announcing(const InFlight &f, bt::TimeStamp now) const
+{
+    if (now - f.started >= ANNOUNCE_TIMEOUT)
+        return false;
+    if (now - f.started < ANNOUNCE_GRACE)
+        return true;
+
+    bt::TrackersList *tlist = f.tc->getTrackersList();
+    bt::TrackerInterface *tracker = tlist ? tlist->getCurrentTracker() : nullptr;
+    return tracker && tracker->trackerStatus() == bt::TRACKER_ANNOUNCING;
+}
+
+void AnnounceScheduler::process()
+{
+    const bt::TimeStamp now = bt::Now();
+
+    // count the announces which are still going on
+    QHash<QString, int> busy;
+    for (int i = 0; i < in_flight.count();) {
+        if (announcing(in_flight[i], now)) {
+            busy[in_flight[i].host]++;
+            i++;
+        } else {
+            in_flight.removeAt(i);
+        }
+    }
+
+    int i = 0;
+    while (i < queue.count() && queue[i].due <= now) {
+        bt::TorrentInterface *tc = queue[i].tc;
+        const QString host = trackerHost(tc);
+        if (max_per_tracker > 0 && busy.value(host) >= max_per_tracker) {
+            // the tracker has enough on its plate, try again later
+            i++;
+            continue;
+        }
+
+        const Request r = queue.takeAt(i);
+        pending.remove(tc);
+        if (!tc->getStats().running)
+            continue;
+
+        if (r.kind == NETWORK_UP)
+            tc->networkUp();
+        else
+            tc->updateTracker();
+
+        InFlight f;
+        f.tc = tc;
+        f.host = host;
+        f.started = now;
+        in_flight.append(f);
+        busy[host]++;
+    }
+
+    if (queue.isEmpty() && in_flight.isEmpty())
+        timer.stop();
+}
+}
@@ -0,0 +1,108 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_ANNOUNCESCHEDULER_H
+#define KT_ANNOUNCESCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+/**
+ * Spreads tracker announces over time, so that a lot of them at once (for example
+ * when the network comes back up) do not end up as a burst of requests. Requests
+ * can be spread over a window with some jitter, and only a limited number of
+ * announces to the same tracker are in progress at the same time.
+ */
+class KTCORE_EXPORT AnnounceScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    AnnounceScheduler(QObject *parent = nullptr);
+    ~AnnounceScheduler() override;
+
+    /**
+     * Announce a torrent as soon as its tracker allows it.
+     * @param tc The torrent
+     */
+    void announce(bt::TorrentInterface *tc);
+
+    /**
+     * Tell a list of torrents the network is up again, spread over the window.
+     * The torrents will reannounce and drop stale peers.
+     * @param torrents The torrents
+     */
+    void networkUp(const QList<bt::TorrentInterface *> &torrents);
+
+    /// Forget about a torrent, call this before it is removed
+    void remove(bt::TorrentInterface *tc);
+
+    /// Forget about all torrents
+    void clear();
+
+    /**
+     * Set the window over which announces after a network outage are spread.
+     * @param secs The window in seconds
+     */
+    void setWindow(bt::Uint32 secs);
+
+    /**
+     * Set the maximum number of announces in progress to the same tracker.
+     * @param m Max announces per tracker (0 = no limit)
+     */
+    void setMaxPerTracker(int m);
+
+    /// Get the number of announces which are waiting
+    int numPending() const
+    {
+        return pending.count();
+    }
+
+private:
+    enum Kind {
+        ANNOUNCE,
+        NETWORK_UP,
+    };
+
+    struct Request {
+        bt::TorrentInterface *tc;
+        Kind kind;
+        bt::TimeStamp due;
+    };
+
+    struct InFlight {
+        bt::TorrentInterface *tc;
+        QString host;
+        bt::TimeStamp started;
+    };
+
+    void schedule(bt::TorrentInterface *tc, Kind kind, bt::TimeStamp due);
+    void process();
+    static QString trackerHost(bt::TorrentInterface *tc);
+    bool announcing(const InFlight &f, bt::TimeStamp now) const;
+
+private:
+    QList<Request> queue; // sorted on due time
+    QHash<bt::TorrentInterface *, Kind> pending;
+    QList<InFlight> in_flight;
+    QTimer timer;
+    bt::TimeStamp window;
+    int max_per_tracker;
+};
+}
+
+#endif
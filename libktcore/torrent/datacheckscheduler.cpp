@@ -0,0 +1,285 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "datacheckscheduler.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+#include <interfaces/torrentinterface.h>
+#include <torrent/jobqueue.h>
+#include <torrent/queuemanager.h>
+#include <util/functions.h>
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+// speed of a data check on a device we have not seen a check on yet
+const double DEFAULT_CHECK_RATE = 50.0 * 1024 * 1024;
+// estimates are recalculated at most this often
+const bt::TimeStamp ESTIMATE_INTERVAL = 1000;
+
+DataCheckScheduler::DataCheckScheduler(QueueManager *qman, QObject *parent)
+    : QObject(parent)
+    , qman(qman)
+    , max_per_device(1)
+    , paused(false)
+    , estimates_time(0)
+    , queue_index_dirty(false)
+{
+}
+
+DataCheckScheduler::~DataCheckScheduler()
+{
+    for (const Check &c : qAsConst(active))
+        disconnect(c.done);
+}
+
+void DataCheckScheduler::enqueue(bt::TorrentInterface *tc, bool user, bool auto_import)
+{
+    enqueue(tc, user, auto_import, 0, tc->getStats().total_chunks);
+}
+
+void DataCheckScheduler::enqueue(bt::TorrentInterface *tc, bool user, bool auto_import, bt::Uint32 from, bt::Uint32 to)
+{
+    if (active.contains(tc))
+        return;
+
+    const int idx = indexOf(tc);
+    if (idx >= 0) {
+        // already queued, but a user request may need to move it forward
+        if (!user || queued[idx].user)
+            return;
+
+        Check c = queued.takeAt(idx);
+        queue_index_dirty = true;
+        c.user = true;
+        c.from = 0;
+        c.to = tc->getStats().total_chunks;
+        c.bytes = tc->getStats().total_bytes;
+        int pos = 0;
+        while (pos < queued.count() && queued[pos].user)
+            pos++;
+        queued.insert(pos, c);
+    } else {
+        const TorrentStats &s = tc->getStats();
+        Check c;
+        c.tc = tc;
+        c.user = user;
+        c.auto_import = auto_import;
+        c.from = from;
+        c.to = to;
+        c.bytes = std::min<bt::Uint64>((bt::Uint64)(to - from + 1) * s.chunk_size, s.total_bytes);
+        c.device = qman->storageDevice(tc);
+        c.started = 0;
+
+        // user requests go after the other user requests, but before the automatic ones
+        int pos = queued.count();
+        if (user) {
+            pos = 0;
+            while (pos < queued.count() && queued[pos].user)
+                pos++;
+        }
+        queued.insert(pos, c);
+        queue_index_dirty = true;
+        qman->setDataCheckPending(tc, true);
+    }
+
+    estimates_time = 0;
+    dispatch();
+    Q_EMIT queueChanged();
+}
+
+void DataCheckScheduler::remove(bt::TorrentInterface *tc)
+{
+    const int idx = indexOf(tc);
+    if (idx >= 0) {
+        queued.removeAt(idx);
+        queue_index_dirty = true;
+        qman->setDataCheckPending(tc, false);
+    }
+
+    QHash<bt::TorrentInterface *, Check>::iterator i = active.find(tc);
+    if (i != active.end()) {
+        disconnect(i.value().done);
+        active.erase(i);
+    }
+
+    estimates.remove(tc);
+    estimates_time = 0;
+    dispatch();
+    Q_EMIT queueChanged();
+}
+
+void DataCheckScheduler::setMaxPerDevice(int m)
+{
+    if (max_per_device == m)
+        return;
+
+    max_per_device = m;
+    estimates_time = 0;
+    dispatch();
+}
+
+void DataCheckScheduler::setPaused(bool pause)
+{
+    if (paused == pause)
+        return;
+
+    paused = pause;
+    Out(SYS_GEN | LOG_NOTICE) << (paused ? "Pausing" : "Resuming") << " data checks, " << queued.count() << " queued" << endl;
+    estimates_time = 0;
+    dispatch();
+    Q_EMIT pausedChanged(paused);
+    Q_EMIT queueChanged();
+}
+
+bool DataCheckScheduler::isChecking(const bt::TorrentInterface *tc) const
+{
+    return active.contains(const_cast<bt::TorrentInterface *>(tc));
+}
+
+int DataCheckScheduler::position(const bt::TorrentInterface *tc) const
+{
+    return indexOf(tc) + 1;
+}
+
+int DataCheckScheduler::eta(const bt::TorrentInterface *tc) const
+{
+    if (paused && !isChecking(tc))
+        return -1;
+
+    const bt::TimeStamp now = bt::CurrentTime();
+    if (estimates_time == 0 || now - estimates_time >= ESTIMATE_INTERVAL) {
+        updateEstimates();
+        estimates_time = now;
+    }
+    return estimates.value(tc, -1);
+}
+
+int DataCheckScheduler::indexOf(const bt::TorrentInterface *tc) const
+{
+    // the position is looked up for every torrent on every view update, while the queue rarely changes
+    if (queue_index_dirty) {
+        queue_index.clear();
+        for (int i = 0; i < queued.count(); i++)
+            queue_index.insert(queued[i].tc, i);
+        queue_index_dirty = false;
+    }
+    return queue_index.value(tc, -1);
+}
+
+void DataCheckScheduler::dispatch()
+{
+    if (paused || queued.isEmpty())
+        return;
+
+    QHash<QString, int> running;
+    for (const Check &c : qAsConst(active))
+        running[c.device]++;
+
+    int i = 0;
+    while (i < queued.count()) {
+        const QString &device = queued[i].device;
+        if (max_per_device > 0 && running.value(device) >= max_per_device) {
+            i++;
+            continue;
+        }
+
+        running[device]++;
+        Check c = queued.takeAt(i);
+        queue_index_dirty = true;
+        startCheck(c);
+    }
+}
+
+void DataCheckScheduler::startCheck(Check &c)
+{
+    bt::TorrentInterface *tc = c.tc;
+    Out(SYS_GEN | LOG_NOTICE) << "Starting data check of " << tc->getStats().torrent_name << endl;
+
+    c.started = bt::CurrentTime();
+    c.done = connect(tc, &bt::TorrentInterface::runningJobsDone, this, [this, tc]() {
+        checkFinished(tc);
+    });
+    active.insert(tc, c);
+    qman->setDataCheckPending(tc, false);
+    tc->startDataCheck(c.auto_import, c.from, c.to);
+
+    // the check might not have resulted in a job, finish it once we are out of dispatch
+    if (!tc->getJobQueue()->runningJobs()) {
+        QTimer::singleShot(0, this, [this, tc]() {
+            checkFinished(tc);
+        });
+    }
+}
+
+void DataCheckScheduler::checkFinished(bt::TorrentInterface *tc)
+{
+    QHash<bt::TorrentInterface *, Check>::iterator i = active.find(tc);
+    if (i == active.end())
+        return;
+
+    const Check c = i.value();
+    disconnect(c.done);
+    active.erase(i);
+    estimates.remove(tc);
+
+    // remember how fast the device is, to estimate how long the next checks will take
+    const double elapsed = (bt::CurrentTime() - c.started) / 1000.0;
+    if (elapsed >= 1.0 && c.bytes > 0) {
+        const double rate = c.bytes / elapsed;
+        QHash<QString, double>::iterator r = device_rates.find(c.device);
+        if (r == device_rates.end())
+            device_rates.insert(c.device, rate);
+        else
+            r.value() = 0.5 * r.value() + 0.5 * rate;
+    }
+
+    estimates_time = 0;
+    dispatch();
+    Q_EMIT queueChanged();
+}
+
+double DataCheckScheduler::rateOf(const QString &device) const
+{
+    return device_rates.value(device, DEFAULT_CHECK_RATE);
+}
+
+void DataCheckScheduler::updateEstimates() const
+{
+    estimates.clear();
+    const bt::TimeStamp now = bt::CurrentTime();
+
+    // for each device, the time in seconds at which each of its check slots becomes free
+    QHash<QString, QList<double>> slots;
+    for (const Check &c : qAsConst(active)) {
+        const double duration = c.bytes / rateOf(c.device);
+        const double remaining = std::max(0.0, duration - (now - c.started) / 1000.0);
+        slots[c.device].append(remaining);
+        estimates.insert(c.tc, (int)remaining);
+    }
+
+    if (paused)
+        return;
+
+    for (const Check &c : qAsConst(queued)) {
+        QList<double> &s = slots[c.device];
+        const double duration = c.bytes / rateOf(c.device);
+        if (max_per_device == 0 || s.count() < max_per_device) {
+            s.append(duration);
+            estimates.insert(c.tc, (int)duration);
+        } else {
+            QList<double>::iterator first = std::min_element(s.begin(), s.end());
+            *first += duration;
+            estimates.insert(c.tc, (int)*first);
+        }
+    }
+}
+}
@@ -0,0 +1,137 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_DATACHECKSCHEDULER_H
+#define KT_DATACHECKSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+class QueueManager;
+
+/**
+ * Queues data checks, so that only a limited number of them run at the same
+ * time on each storage device. Checks requested by the user go before
+ * automatic ones. Torrents waiting for a check are not started by the QueueManager.
+ */
+class KTCORE_EXPORT DataCheckScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    DataCheckScheduler(QueueManager *qman, QObject *parent = nullptr);
+    ~DataCheckScheduler() override;
+
+    /**
+     * Queue a data check of a range of chunks.
+     * @param tc The torrent
+     * @param user Whether the check was requested by the user
+     * @param auto_import Whether the check is part of importing existing files
+     * @param from First chunk to check
+     * @param to Last chunk to check
+     */
+    void enqueue(bt::TorrentInterface *tc, bool user, bool auto_import, bt::Uint32 from, bt::Uint32 to);
+
+    /**
+     * Queue a data check of a whole torrent.
+     * @param tc The torrent
+     * @param user Whether the check was requested by the user
+     * @param auto_import Whether the check is part of importing existing files
+     */
+    void enqueue(bt::TorrentInterface *tc, bool user, bool auto_import = false);
+
+    /// Forget about a torrent, call this before it is removed
+    void remove(bt::TorrentInterface *tc);
+
+    /**
+     * Set the maximum number of checks running at the same time on a storage device.
+     * @param m Max checks per device (0 = no limit)
+     */
+    void setMaxPerDevice(int m);
+
+    /// Pause or resume starting queued checks, running checks are not interrupted
+    void setPaused(bool pause);
+
+    /// Whether or not the scheduler is paused
+    bool isPaused() const
+    {
+        return paused;
+    }
+
+    /// Get the number of queued checks
+    int numQueued() const
+    {
+        return queued.count();
+    }
+
+    /// Whether a check of a torrent is running
+    bool isChecking(const bt::TorrentInterface *tc) const;
+
+    /**
+     * Get the position of a torrent in the queue.
+     * @return The position starting at 1, or 0 if the torrent is not queued
+     */
+    int position(const bt::TorrentInterface *tc) const;
+
+    /**
+     * Estimate how long it will take before the check of a torrent is done,
+     * based on the speed of previous checks on the same device.
+     * @return The time in seconds, or -1 if it is unknown (not queued or paused)
+     */
+    int eta(const bt::TorrentInterface *tc) const;
+
+Q_SIGNALS:
+    /// Emitted when checks are queued, started or finished
+    void queueChanged();
+
+    /// Emitted when the paused state changes
+    void pausedChanged(bool paused);
+
+private:
+    struct Check {
+        bt::TorrentInterface *tc;
+        bool user;
+        bool auto_import;
+        bt::Uint32 from;
+        bt::Uint32 to;
+        bt::Uint64 bytes;
+        QString device;
+        bt::TimeStamp started;
+        QMetaObject::Connection done;
+    };
+
+    int indexOf(const bt::TorrentInterface *tc) const;
+    void dispatch();
+    void startCheck(Check &c);
+    void checkFinished(bt::TorrentInterface *tc);
+    double rateOf(const QString &device) const;
+    void updateEstimates() const;
+
+private:
+    QueueManager *qman;
+    QList<Check> queued;
+    QHash<bt::TorrentInterface *, Check> active;
+    QHash<QString, double> device_rates;
+    int max_per_device;
+    bool paused;
+    mutable QHash<const bt::TorrentInterface *, int> estimates;
+    mutable bt::TimeStamp estimates_time;
+    mutable QHash<const bt::TorrentInterface *, int> queue_index; // position in queued, rebuilt when the queue changed
+    mutable bool queue_index_dirty;
+};
+}
+
+#endif
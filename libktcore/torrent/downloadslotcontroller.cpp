@@ -0,0 +1,133 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "downloadslotcontroller.h"
+
+namespace kt
+{
+// the rate is sampled once per second
+const bt::TimeStamp SAMPLE_INTERVAL = 1000;
+// weight of a new sample in the average rate
+const double RATE_SMOOTHING = 0.2;
+// the highest rate measured slowly decays, so it follows changes of the link
+const double PEAK_DECAY = 0.999;
+// time given to the rate to settle after the number of slots changed
+const bt::TimeStamp SETTLE_TIME = 30 * 1000;
+// how long we stay away from a number of slots which did not help
+const bt::TimeStamp BACKOFF_TIME = 10 * 60 * 1000;
+// below this utilization another slot is tried
+const double LOW_UTILIZATION = 0.75;
+// above this utilization the bandwidth is saturated
+const double HIGH_UTILIZATION = 0.95;
+// minimum change of the rate for a slot change to be considered useful,
+// as a fraction of the rate one download got before the change
+const double MIN_GAIN = 0.25;
+
+DownloadSlotController::DownloadSlotController()
+{
+    reset(1);
+}
+
+DownloadSlotController::~DownloadSlotController()
+{
+}
+
+void DownloadSlotController::reset(int initial)
+{
+    num_slots = initial < 1 ? 1 : initial;
+    avg_rate = peak_rate = 0.0;
+    cap = 0;
+    last_sample = last_change = 0;
+    probe = NONE;
+    rate_before_change = 0.0;
+    slots_before_change = num_slots;
+    slot_ceiling = slot_floor = 0;
+    slot_ceiling_until = slot_floor_until = 0;
+}
+
+double DownloadSlotController::capacity() const
+{
+    return cap > 0 ? cap : peak_rate;
+}
+
+double DownloadSlotController::utilization() const
+{
+    const double c = capacity();
+    return c > 0.0 ? avg_rate / c : 0.0;
+}
+
+bool DownloadSlotController::update(bt::TimeStamp now, bt::Uint32 rate, bt::Uint32 c, int max, bool waiting)
+{
+    if (last_sample != 0 && now - last_sample < SAMPLE_INTERVAL)
+        return false;
+
+    if (last_sample == 0) {
+        avg_rate = rate;
+        last_change = now;
+    } else {
+        avg_rate += RATE_SMOOTHING * (rate - avg_rate);
+    }
+    last_sample = now;
+    peak_rate = avg_rate > peak_rate * PEAK_DECAY ? avg_rate : peak_rate * PEAK_DECAY;
+    cap = c;
+
+    const int old = num_slots;
+    if (max > 0 && num_slots > max) {
+        num_slots = max;
+        probe = NONE;
+        last_change = now;
+        return true;
+    }
+
+    if (now - last_change < SETTLE_TIME)
+        return false;
+
+    // what one download is expected to add or take away, so the threshold does not
+    // shrink relative to the gain of a slot as the number of slots grows
+    const double min_gain = MIN_GAIN * rate_before_change / slots_before_change;
+    if (probe == INCREASED) {
+        // the extra download did not increase the throughput, so take it away again
+        if (avg_rate < rate_before_change + min_gain) {
+            num_slots--;
+            slot_ceiling = num_slots;
+            slot_ceiling_until = now + BACKOFF_TIME;
+        }
+        probe = NONE;
+    } else if (probe == DECREASED) {
+        // one download less lowered the throughput, so give it back
+        if (avg_rate < rate_before_change - min_gain) {
+            num_slots++;
+            slot_floor = num_slots;
+            slot_floor_until = now + BACKOFF_TIME;
+        }
+        probe = NONE;
+    } else {
+        // Without a cap the rate is only compared against the highest rate measured, which
+        // the current rate always comes close to, so slots are only taken away below a cap.
+        // Without a cap the ceiling set by a failed increase keeps the number of slots stable.
+        const double u = utilization();
+        const bool saturated = cap > 0 && u > HIGH_UTILIZATION;
+        const bool room = cap > 0 ? u < LOW_UTILIZATION : true;
+        if (saturated && num_slots > 1 && (num_slots > slot_floor || now >= slot_floor_until)) {
+            rate_before_change = avg_rate;
+            slots_before_change = num_slots;
+            num_slots--;
+            probe = DECREASED;
+        } else if (room && waiting && (max == 0 || num_slots < max) && (num_slots < slot_ceiling || now >= slot_ceiling_until)) {
+            rate_before_change = avg_rate;
+            slots_before_change = num_slots;
+            num_slots++;
+            probe = INCREASED;
+        }
+    }
+
+    if (num_slots == old)
+        return false;
+
+    last_change = now;
+    return true;
+}
+}
@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_DOWNLOADSLOTCONTROLLER_H
+#define KT_DOWNLOADSLOTCONTROLLER_H
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace kt
+{
+/**
+ * Decides how many downloads should run at the same time, by looking at how well
+ * the available bandwidth is used. While the download rate stays below the cap
+ * (or when there is no cap), an extra slot is tried, which is kept only if the total
+ * rate goes up by a good part of what one download gets. When a cap is saturated, a slot
+ * is taken away as long as that does not lower the total rate. After each change the rate is given time to settle,
+ * and a change which did not help is not retried for a while, so the number of slots
+ * does not flap.
+ */
+class KTCORE_EXPORT DownloadSlotController
+{
+public:
+    DownloadSlotController();
+    ~DownloadSlotController();
+
+    /**
+     * Start again with a number of slots.
+     * @param initial The initial number of slots
+     */
+    void reset(int initial);
+
+    /**
+     * Feed the current total download rate to the controller.
+     * @param now The current time
+     * @param rate The total download rate in bytes per second
+     * @param cap The configured download cap in bytes per second, 0 if there is none
+     * @param max Upper bound of the number of slots, 0 if there is none
+     * @param waiting Whether there are downloads waiting for a slot
+     * @return true if the number of slots has changed
+     */
+    bool update(bt::TimeStamp now, bt::Uint32 rate, bt::Uint32 cap, int max, bool waiting);
+
+    /// Get the number of slots
+    int slots() const
+    {
+        return num_slots;
+    }
+
+    /// Get the capacity the rate is compared against, the cap or the highest rate measured
+    double capacity() const;
+
+    /// Get the fraction of the capacity which is used
+    double utilization() const;
+
+private:
+    int num_slots;
+    double avg_rate;
+    double peak_rate;
+    bt::Uint32 cap;
+    bt::TimeStamp last_sample;
+    bt::TimeStamp last_change;
+    enum Probe { NONE, INCREASED, DECREASED } probe;
+    double rate_before_change;
+    int slots_before_change;
+    int slot_ceiling;
+    bt::TimeStamp slot_ceiling_until;
+    int slot_floor;
+    bt::TimeStamp slot_floor_until;
+};
+}
+
+#endif
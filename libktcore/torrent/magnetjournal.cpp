@@ -0,0 +1,248 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "magnetjournal.h"
+
+#include <QSaveFile>
+#include <QThread>
+
+#include <bcodec/bencoder.h>
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+static QByteArray HashField(const bt::SHA1Hash &hash)
+{
+    return QByteArray((const char *)hash.getData(), 20).toHex();
+}
+
+static QByteArray StringField(const QString &str)
+{
+    // percent encode so that fields never contain spaces or newlines
+    return str.toUtf8().toPercentEncoding();
+}
+
+static bool WriteSnapshot(const QString &file, const QList<MagnetJournal::Entry> &entries)
+{
+    QByteArray data;
+    BEncoder enc(new BEncoderBufferOutput(data));
+    enc.beginList();
+    for (const MagnetJournal::Entry &e : entries) {
+        enc.beginDict();
+        enc.write(QByteArrayLiteral("magnet"), e.mlink.toString().toUtf8());
+        enc.write(QByteArrayLiteral("stopped"), e.stopped);
+        enc.write(QByteArrayLiteral("silent"), e.options.silently);
+        enc.write(QByteArrayLiteral("group"), e.options.group.toUtf8());
+        enc.write(QByteArrayLiteral("location"), e.options.location.toUtf8());
+        enc.write(QByteArrayLiteral("move_on_completion"), e.options.move_on_completion.toUtf8());
+        enc.end();
+    }
+    enc.end();
+
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly) || fptr.write(data) != data.size() || !fptr.commit()) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to write " << file << " : " << fptr.errorString() << endl;
+        return false;
+    }
+    return true;
+}
+
+static void ReadRecords(const QString &file, QList<MagnetJournal::Record> &records)
+{
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return;
+
+    while (!fptr.atEnd()) {
+        // a partially written last line is ignored
+        const QByteArray line = fptr.readLine();
+        if (!line.endsWith('\n'))
+            break;
+
+        const QList<QByteArray> parts = line.chopped(1).split(' ');
+        MagnetJournal::Record r;
+        if (parts[0] == "add" && parts.count() == 7) {
+            r.type = MagnetJournal::Record::ADD;
+            r.entry.stopped = parts[1] == "1";
+            r.entry.options.silently = parts[2] == "1";
+            r.entry.mlink = MagnetLink(QString::fromUtf8(QByteArray::fromPercentEncoding(parts[3])));
+            r.entry.options.group = QString::fromUtf8(QByteArray::fromPercentEncoding(parts[4]));
+            r.entry.options.location = QString::fromUtf8(QByteArray::fromPercentEncoding(parts[5]));
+            r.entry.options.move_on_completion = QString::fromUtf8(QByteArray::fromPercentEncoding(parts[6]));
+            if (!r.entry.mlink.isValid())
+                continue;
+            r.hash = r.entry.mlink.infoHash();
+        } else if (parts.count() == 2 && parts[1].size() == 40) {
+            if (parts[0] == "remove")
+                r.type = MagnetJournal::Record::REMOVE;
+            else if (parts[0] == "start")
+                r.type = MagnetJournal::Record::START;
+            else if (parts[0] == "stop")
+                r.type = MagnetJournal::Record::STOP;
+            else
+                continue;
+            r.hash = SHA1Hash((const Uint8 *)QByteArray::fromHex(parts[1]).constData());
+        } else {
+            continue;
+        }
+        records.append(r);
+    }
+}
+
+MagnetJournal::MagnetJournal()
+    : num_records(0)
+    , compactor(nullptr)
+{
+}
+
+MagnetJournal::~MagnetJournal()
+{
+    close();
+}
+
+QString MagnetJournal::journalFile(const QString &file)
+{
+    return file + QLatin1String(".journal");
+}
+
+QString MagnetJournal::oldJournalFile(const QString &file)
+{
+    return file + QLatin1String(".journal.old");
+}
+
+void MagnetJournal::open(const QString &file)
+{
+    close();
+    this->file = file;
+    journal.setFileName(journalFile(file));
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to open magnet journal " << journal.fileName() << " : " << journal.errorString() << endl;
+        return;
+    }
+    num_records = 0;
+}
+
+void MagnetJournal::close()
+{
+    wait();
+    journal.close();
+}
+
+void MagnetJournal::wait()
+{
+    if (!compactor)
+        return;
+
+    compactor->wait();
+    delete compactor;
+    compactor = nullptr;
+}
+
+void MagnetJournal::write(const QByteArray &lines, int count)
+{
+    if (!journal.isOpen())
+        return;
+
+    journal.write(lines);
+    journal.flush();
+    num_records += count;
+}
+
+QByteArray MagnetJournal::addLine(const Entry &e)
+{
+    return "add " + QByteArray(e.stopped ? "1" : "0") + ' ' + QByteArray(e.options.silently ? "1" : "0") + ' ' + StringField(e.mlink.toString()) + ' '
+        + StringField(e.options.group) + ' ' + StringField(e.options.location) + ' ' + StringField(e.options.move_on_completion) + '\n';
+}
+
+void MagnetJournal::added(const Entry &e)
+{
+    write(addLine(e));
+}
+
+void MagnetJournal::added(const QList<Entry> &entries)
+{
+    QByteArray lines;
+    for (const Entry &e : entries)
+        lines.append(addLine(e));
+    write(lines, entries.count());
+}
+
+void MagnetJournal::removed(const bt::SHA1Hash &hash)
+{
+    write("remove " + HashField(hash) + '\n');
+}
+
+void MagnetJournal::started(const bt::SHA1Hash &hash)
+{
+    write("start " + HashField(hash) + '\n');
+}
+
+void MagnetJournal::stopped(const bt::SHA1Hash &hash)
+{
+    write("stop " + HashField(hash) + '\n');
+}
+
+bool MagnetJournal::needsCompaction(int num_magnets, int pending) const
+{
+    // rewrite the magnets file once the journal has mostly outdated records
+    return journal.isOpen() && num_records + pending > 2 * num_magnets + 1000;
+}
+
+void MagnetJournal::compact(const QList<Entry> &entries)
+{
+    if (!journal.isOpen())
+        return;
+
+    wait();
+    journal.close();
+
+    // The current journal is set aside until the new magnets file has been committed,
+    // if that fails it is replayed together with the journal which is started now.
+    const QString old_journal = oldJournalFile(file);
+    if (QFile::exists(old_journal)) {
+        QFile old(old_journal);
+        QFile current(journal.fileName());
+        if (old.open(QIODevice::WriteOnly | QIODevice::Append) && current.open(QIODevice::ReadOnly))
+            old.write(current.readAll());
+        old.close();
+        QFile::remove(journal.fileName());
+    } else {
+        QFile::rename(journal.fileName(), old_journal);
+    }
+
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append))
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to open magnet journal " << journal.fileName() << " : " << journal.errorString() << endl;
+    num_records = 0;
+
+    const QString snapshot = file;
+    compactor = QThread::create([snapshot, entries, old_journal]() {
+        if (WriteSnapshot(snapshot, entries))
+            QFile::remove(old_journal);
+    });
+    compactor->start();
+}
+
+QList<MagnetJournal::Record> MagnetJournal::load(const QString &file)
+{
+    QList<Record> records;
+    ReadRecords(oldJournalFile(file), records);
+    ReadRecords(journalFile(file), records);
+    return records;
+}
+
+bool MagnetJournal::save(const QString &file, const QList<Entry> &entries)
+{
+    if (!WriteSnapshot(file, entries))
+        return false;
+
+    QFile::remove(oldJournalFile(file));
+    QFile::remove(journalFile(file));
+    return true;
+}
+
+}
@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_MAGNETJOURNAL_H
+#define KT_MAGNETJOURNAL_H
+
+#include <QFile>
+#include <QList>
+
+#include <interfaces/coreinterface.h>
+#include <ktcore_export.h>
+#include <magnet/magnetlink.h>
+#include <util/sha1hash.h>
+
+class QThread;
+
+namespace kt
+{
+/**
+ * Append-only journal of the changes to the magnet queue. Every add, remove,
+ * start and stop is written as one line to a journal next to the magnets file,
+ * so a crash loses nothing which has been journaled. Once the journal has grown
+ * too much compared to the number of magnets, the magnets file is rewritten on
+ * a background thread and the journal starts over.
+ */
+class KTCORE_EXPORT MagnetJournal
+{
+public:
+    MagnetJournal();
+    ~MagnetJournal();
+
+    /// A magnet as it is stored in the magnets file
+    struct Entry {
+        bt::MagnetLink mlink;
+        MagnetLinkLoadOptions options;
+        bool stopped;
+    };
+
+    /// One change to the magnet queue
+    struct Record {
+        enum Type {
+            ADD,
+            REMOVE,
+            START,
+            STOP,
+        };
+
+        Type type;
+        bt::SHA1Hash hash;
+        Entry entry; ///< Only used by ADD
+    };
+
+    /**
+     * Start journaling changes to the magnets file.
+     * @param file The magnets file, the journal is stored next to it
+     */
+    void open(const QString &file);
+
+    /// Stop journaling, waits for a running compaction
+    void close();
+
+    /// Whether or not changes are journaled
+    bool isOpen() const
+    {
+        return journal.isOpen();
+    }
+
+    void added(const Entry &e);
+    void added(const QList<Entry> &entries);
+    void removed(const bt::SHA1Hash &hash);
+    void started(const bt::SHA1Hash &hash);
+    void stopped(const bt::SHA1Hash &hash);
+
+    /**
+     * Whether the journal should be compacted.
+     * @param num_magnets The number of magnets currently in the queue
+     * @param pending The number of records which are about to be written
+     */
+    bool needsCompaction(int num_magnets, int pending = 0) const;
+
+    /**
+     * Rewrite the magnets file on a background thread and start a new journal.
+     * @param entries All magnets currently in the queue
+     */
+    void compact(const QList<Entry> &entries);
+
+    /**
+     * Read the changes which have not been written to the magnets file yet.
+     * A partially written last record is ignored.
+     * @param file The magnets file
+     * @return The changes, in the order they were made
+     */
+    static QList<Record> load(const QString &file);
+
+    /**
+     * Write the magnets file and remove the journal.
+     * @param file The magnets file
+     * @param entries The magnets
+     * @return true upon success
+     */
+    static bool save(const QString &file, const QList<Entry> &entries);
+
+private:
+    void write(const QByteArray &lines, int count = 1);
+    static QByteArray addLine(const Entry &e);
+    void wait();
+    static QString journalFile(const QString &file);
+    static QString oldJournalFile(const QString &file);
+
+private:
+    QString file;
+    QFile journal;
+    int num_records;
+    QThread *compactor;
+};
+
+}
+
+#endif
@@ -30,14 +30,27 @@
 #include <bcodec/bencoder.h>
 #include <bcodec/bnode.h>
 #include <util/error.h>
+#include <util/functions.h>
 #include <util/log.h>
 
 using namespace bt;
 
 namespace kt
 {
+// a downloading magnet which has not seen a single peer after this time is dead
+const bt::TimeStamp DEAD_TIME = 60 * 1000;
+// delay before a dead magnet is tried again, doubled after every failed attempt
+const bt::TimeStamp MIN_BACKOFF = 60 * 1000;
+const bt::TimeStamp MAX_BACKOFF = 4 * 60 * 60 * 1000;
+// number of queued magnets which are considered when a slot becomes free
+const int CANDIDATES = 16;
+// window over which the rate of finished magnets is measured
+const bt::TimeStamp RATE_WINDOW = 5 * 60 * 1000;
+// maximum number of slots in total
+const int MAX_SLOTS = 100;
+
 DownloadSlot::DownloadSlot(QObject *parent)
-    : magnetIdx(-1)
+    : magnetId(0)
     , timerDuration(0)
 {
     timer = new QTimer(parent);
@@ -71,17 +84,17 @@ void DownloadSlot::reset()
 {
     stopTimer();
     setTimerDuration(timerDuration);
-    magnetIdx = -1;
+    magnetId = 0;
 }
 
-void DownloadSlot::setMagnetIndex(int index)
+void DownloadSlot::setMagnetId(bt::Uint32 id)
 {
-    magnetIdx = index;
+    magnetId = id;
 }
 
-int DownloadSlot::getMagnetIndex() const
+bt::Uint32 DownloadSlot::getMagnetId() const
 {
-    return magnetIdx;
+    return magnetId;
 }
 
 bool DownloadSlot::isTimerActived() const
@@ -91,12 +104,61 @@ bool DownloadSlot::isTimerActived() const
 
 bool DownloadSlot::isOccupied() const
 {
-    return magnetIdx < 0;
+    return magnetId != 0;
 }
 
 void DownloadSlot::onTimeout()
 {
-    Q_EMIT timeout(magnetIdx);
+    Q_EMIT timeout(magnetId);
+}
+
+//---------------------------------------------------
+
+MagnetManager::MagnetList::MagnetList()
+    : first(nullptr)
+    , last(nullptr)
+    , count(0)
+{
+}
+
+void MagnetManager::MagnetList::append(Magnet *m)
+{
+    m->prev = last;
+    m->next = nullptr;
+    if (last)
+        last->next = m;
+    else
+        first = m;
+    last = m;
+    ++count;
+}
+
+void MagnetManager::MagnetList::prepend(Magnet *m)
+{
+    m->prev = nullptr;
+    m->next = first;
+    if (first)
+        first->prev = m;
+    else
+        last = m;
+    first = m;
+    ++count;
+}
+
+void MagnetManager::MagnetList::remove(Magnet *m)
+{
+    if (m->prev)
+        m->prev->next = m->next;
+    else
+        first = m->next;
+
+    if (m->next)
+        m->next->prev = m->prev;
+    else
+        last = m->prev;
+
+    m->prev = m->next = nullptr;
+    --count;
 }
 
 //---------------------------------------------------
@@ -105,170 +167,221 @@ MagnetManager::MagnetManager(QObject *parent)
     : QObject(parent)
     , useSlotTimer(true)
     , timerDuration(180000)
-    , usedDownloadingSlots()
     , freeDownloadingSlots()
-    , magnetQueue()
-    , stoppedList()
-    , magnetHashes()
-    , stoppedHashes()
+    , magnetsById()
+    , magnetIds()
+    , nextId(1)
+    , baseSlots(0)
+    , extraSlots(0)
+    , windowStart(0)
+    , fetched(0)
+    , lastFetched(0)
+    , cacheHits(0)
 {
     setDownloadingSlots(1);
 }
 
 MagnetManager::~MagnetManager()
 {
-    for (DownloadSlot *slot : qAsConst(usedDownloadingSlots))
-        delete slot;
+    for (Magnet *m : qAsConst(magnetsById)) {
+        delete m->slot;
+        delete m;
+    }
 
     for (DownloadSlot *slot : qAsConst(freeDownloadingSlots))
         delete slot;
 }
 
-void MagnetManager::addMagnet(const bt::MagnetLink &mlink, const kt::MagnetLinkLoadOptions &options, bool stopped)
+bt::Uint32 MagnetManager::addMagnet(const bt::MagnetLink &mlink, const kt::MagnetLinkLoadOptions &options, bool stopped)
 {
-    if (magnetHashes.contains(mlink.infoHash()))
-        return; // Already managed, do nothing
+    const bt::Uint32 existing = magnetIds.value(mlink.infoHash());
+    if (existing != 0) {
+        // merge with the magnet which is already managed
+        if (!stopped)
+            start({existing});
+        return existing;
+    }
 
-    MagnetDownloader *md = new MagnetDownloader(mlink, options, this);
-    connect(md, &MagnetDownloader::foundMetadata, this, &MagnetManager::onDownloadFinished);
+    if (!stopped && completeFromCache(mlink, options))
+        return 0;
 
-    int updateIndex = 0;
-    int updateCount = 0;
-    if (stopped) {
-        stoppedList.append(md);
-        stoppedHashes.insert(mlink.infoHash());
-        magnetHashes.insert(mlink.infoHash());
+    Magnet *m = createMagnet(mlink, options, stopped);
+    const MagnetJournal::Entry e = {mlink, options, stopped};
+    journal.added(e);
+    checkJournal();
 
-        updateIndex = magnetHashes.size() - 1;
-        updateCount = 1;
-    } else {
-        magnetQueue.append(md);
-        magnetHashes.insert(mlink.infoHash());
-
-        int nextIndex = startNextQueuedMagnets();
-        if (nextIndex >= 0)
-            updateIndex = nextIndex;
-        else
-            updateIndex = magnetQueue.size() - 1;
-        updateCount = magnetHashes.size() - updateIndex;
-    }
-    Q_EMIT updateQueue(updateIndex, updateCount);
+    Q_EMIT magnetAdded(m->id);
+    if (!stopped)
+        startNextQueuedMagnets();
+
+    return m->id;
 }
 
-void MagnetManager::removeMagnets(bt::Uint32 idx, bt::Uint32 count)
+int MagnetManager::addMagnets(const QList<bt::MagnetLink> &mlinks, const MagnetLinkLoadOptions &options, bool stopped)
 {
-    if (idx >= (Uint32)magnetHashes.size() || count < 1)
-        return;
+    int accepted = 0;
+    QList<bt::Uint32> ids;
+    QList<MagnetJournal::Entry> added;
+    for (const bt::MagnetLink &mlink : mlinks) {
+        if (!mlink.isValid() || magnetIds.contains(mlink.infoHash()))
+            continue;
 
-    while (count > 0 && idx < (Uint32)magnetHashes.size()) {
-        MagnetDownloader *md = 0;
-        Uint32 magnetQueueSize = magnetQueue.size();
-        if (idx < magnetQueueSize) {
-            md = magnetQueue.at(idx);
-            magnetQueue.removeAt(idx);
-            if (md->running())
-                freeDownloadSlot(idx);
-        } else {
-            int stoppedIdx = idx - magnetQueueSize;
-            md = stoppedList.at(stoppedIdx);
-            stoppedList.removeAt(stoppedIdx);
-            stoppedHashes.remove(md->magnetLink().infoHash());
-        }
-        magnetHashes.remove(md->magnetLink().infoHash());
-        md->deleteLater();
+        accepted++;
+        if (!stopped && completeFromCache(mlink, options))
+            continue;
 
-        --count;
+        Magnet *m = createMagnet(mlink, options, stopped);
+        ids.append(m->id);
+        const MagnetJournal::Entry e = {mlink, options, stopped};
+        added.append(e);
     }
 
-    int updateIndex = startNextQueuedMagnets();
-    if (updateIndex < 0)
-        updateIndex = idx;
+    if (ids.isEmpty())
+        return accepted;
+
+    // a batch which would make the journal grow too much goes straight to the magnets file
+    if (journal.needsCompaction(count(), added.count()))
+        journal.compact(entries());
+    else
+        journal.added(added);
+
+    Q_EMIT magnetsAdded(ids);
+    if (!stopped)
+        startNextQueuedMagnets();
 
-    Q_EMIT updateQueue(updateIndex, magnetHashes.size() - updateIndex);
+    return accepted;
 }
 
-void MagnetManager::start(bt::Uint32 idx, bt::Uint32 count)
+MagnetManager::Magnet *MagnetManager::createMagnet(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options, bool stopped)
 {
-    Uint32 magnetQueueSize = magnetQueue.size();
-    if (idx + count < magnetQueueSize || count < 1)
-        return;
+    MagnetDownloader *md = new MagnetDownloader(mlink, options, this);
+    connect(md, &MagnetDownloader::foundMetadata, this, &MagnetManager::onDownloadFinished);
 
-    if (idx < magnetQueueSize) { // jump to stopped magnets
-        int alreadyStarted = magnetQueueSize - idx;
-        idx += alreadyStarted;
-        count -= alreadyStarted;
+    Magnet *m = new Magnet;
+    m->id = nextId++;
+    m->md = md;
+    m->state = stopped ? STOPPED : QUEUED;
+    m->slot = nullptr;
+    m->started = 0;
+    m->peers = 0;
+    m->failures = 0;
+    m->retry = 0;
+    m->waiting = false;
+    list(m->state).append(m);
+    magnetsById.insert(m->id, m);
+    magnetIds.insert(mlink.infoHash(), m->id);
+    return m;
+}
+
+void MagnetManager::removeMagnets(const QList<bt::Uint32> &ids)
+{
+    for (bt::Uint32 id : ids) {
+        Magnet *m = magnetsById.value(id);
+        if (m)
+            removeMagnet(m);
     }
 
-    Uint32 updateIndex = idx;
-    Uint32 updateCount = 0;
+    startNextQueuedMagnets();
+}
 
-    int stoppedIdx = idx - magnetQueueSize;
-    Uint32 totalMagnets = magnetHashes.size();
-    while (count > 0 && idx < totalMagnets) {
-        MagnetDownloader *md = stoppedList.at(stoppedIdx);
-        stoppedList.removeAt(stoppedIdx);
-        stoppedHashes.remove(md->magnetLink().infoHash());
-        magnetQueue.append(md);
+void MagnetManager::removeMagnet(Magnet *m)
+{
+    Q_EMIT magnetRemoved(m->id);
+
+    journal.removed(m->md->magnetLink().infoHash());
+
+    if (m->state == DOWNLOADING)
+        freeDownloadSlot(m);
+    unlink(m);
+    magnetsById.remove(m->id);
+    magnetIds.remove(m->md->magnetLink().infoHash());
+    m->md->deleteLater();
+    delete m;
+
+    // only compact once the magnet is gone, the snapshot would bring it back otherwise
+    checkJournal();
+}
 
-        --count;
-        ++idx;
-        ++updateCount;
+void MagnetManager::start(const QList<bt::Uint32> &ids)
+{
+    for (bt::Uint32 id : ids) {
+        Magnet *m = magnetsById.value(id);
+        if (m && m->state == STOPPED && completeFromCache(m->md->magnetLink(), m->md->options)) {
+            removeMagnet(m);
+        } else if (m && m->state == STOPPED) {
+            journal.started(m->md->magnetLink().infoHash());
+            m->failures = 0;
+            moveTo(m, QUEUED);
+            Q_EMIT magnetChanged(m->id);
+        }
     }
 
-    int startedIdx = startNextQueuedMagnets();
-    if (startedIdx >= 0)
-        updateIndex = startedIdx;
+    startNextQueuedMagnets();
+}
+
+bool MagnetManager::completeFromCache(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options)
+{
+    QByteArray data;
+    if (!cache.find(mlink.infoHash(), data))
+        return false;
 
-    if (updateCount > 0)
-        Q_EMIT updateQueue(updateIndex, updateCount);
+    Out(SYS_GEN | LOG_NOTICE) << "Found metadata of " << mlink.displayName() << " in the cache" << endl;
+    cacheHits++;
+    Q_EMIT metadataDownloaded(mlink, data, options);
+    return true;
 }
 
-void MagnetManager::stop(bt::Uint32 idx, bt::Uint32 count)
+void MagnetManager::setMetadataCacheDir(const QString &dir)
 {
-    Uint32 magnetQueueSize = magnetQueue.size();
-    if (idx >= magnetQueueSize || count < 1)
-        return;
+    cache.open(dir);
+}
 
-    if (idx + count >= magnetQueueSize)
-        count -= (idx + count) - magnetQueueSize; // do not include already stopped magnets
+void MagnetManager::setMetadataCacheSize(bt::Uint32 size)
+{
+    cache.setMaxSize((bt::Uint64)size * 1024 * 1024);
+}
 
-    Uint32 updateCount = count;
-    Uint32 updateIndex = idx;
+void MagnetManager::stop(const QList<bt::Uint32> &ids)
+{
+    for (bt::Uint32 id : ids) {
+        Magnet *m = magnetsById.value(id);
+        if (!m || m->state == STOPPED)
+            continue;
 
-    while (count > 0) {
-        MagnetDownloader *md = magnetQueue.at(idx);
-        if (md->running()) {
-            md->stop();
-            freeDownloadSlot(idx);
+        if (m->state == DOWNLOADING) {
+            m->md->stop();
+            freeDownloadSlot(m);
         }
-        magnetQueue.removeAt(idx);
-        stoppedList.append(md);
-        stoppedHashes.insert(md->magnetLink().infoHash());
-
-        --count;
+        journal.stopped(m->md->magnetLink().infoHash());
+        moveTo(m, STOPPED);
+        Q_EMIT magnetChanged(m->id);
     }
 
-    int startedIdx = startNextQueuedMagnets();
-    if (startedIdx >= 0)
-        updateIndex = startedIdx;
+    checkJournal();
+    startNextQueuedMagnets();
+}
 
-    if (updateCount > 0)
-        Q_EMIT updateQueue(updateIndex, updateCount);
+bool MagnetManager::isStopped(bt::Uint32 id) const
+{
+    Magnet *m = magnetsById.value(id);
+    return !m || m->state == STOPPED;
 }
 
-bool MagnetManager::isStopped(bt::Uint32 idx) const
+void MagnetManager::setDownloadingSlots(bt::Uint32 count)
 {
-    if (idx < (Uint32)magnetQueue.size())
-        return false;
+    baseSlots = count;
+    extraSlots = 0;
+    resizeSlots(baseSlots);
+}
 
-    return true;
+int MagnetManager::downloadingSlots() const
+{
+    return downloadingMagnets.count + freeDownloadingSlots.size();
 }
 
-void MagnetManager::setDownloadingSlots(bt::Uint32 count)
+void MagnetManager::resizeSlots(int count)
 {
-    int updateIndex = 0;
-    int updateCount = 0;
-    int totalSlots = usedDownloadingSlots.size() + freeDownloadingSlots.size();
+    int totalSlots = downloadingSlots();
     int slotsToAdd = count - totalSlots;
     if (slotsToAdd > 0) { // add new slots
         for (int i = 0; i < slotsToAdd; ++i) {
@@ -277,61 +390,48 @@ void MagnetManager::setDownloadingSlots(bt::Uint32 count)
             freeDownloadingSlots.push_back(slot);
             connect(slot, &DownloadSlot::timeout, this, &MagnetManager::onSlotTimeout);
         }
-        updateIndex = startNextQueuedMagnets();
-        updateCount = slotsToAdd;
+        startNextQueuedMagnets();
     } else { // remove slots
         int slotsToRemove = std::abs(slotsToAdd);
 
         // try to remove free slots
-        if (!freeDownloadingSlots.isEmpty()) {
-            while (slotsToRemove > 0 && !freeDownloadingSlots.isEmpty()) {
-                DownloadSlot *slot = freeDownloadingSlots.front();
-                freeDownloadingSlots.pop_front();
-                delete slot;
-
-                --slotsToRemove;
-            }
+        while (slotsToRemove > 0 && !freeDownloadingSlots.isEmpty()) {
+            DownloadSlot *slot = freeDownloadingSlots.front();
+            freeDownloadingSlots.pop_front();
+            delete slot;
+
+            --slotsToRemove;
         }
 
-        if (slotsToRemove == 0) {
-            // all removed slots where unused so we don't need to emit an updateQueue signal
-            updateIndex = -1;
-        } else { // remove used slots
-            updateIndex = usedDownloadingSlots.size() - slotsToRemove;
-            if (updateIndex < 0)
-                updateIndex = 0;
-            updateCount = slotsToRemove;
-
-            while (slotsToRemove > 0 && !usedDownloadingSlots.isEmpty()) {
-                DownloadSlot *slot = usedDownloadingSlots.back();
-                usedDownloadingSlots.pop_back();
-                slot->stopTimer();
-                magnetQueue.at(slot->getMagnetIndex())->stop();
-                delete slot;
-
-                --slotsToRemove;
-            }
+        // remove used slots, the magnets which occupied them go back to the front of the queue
+        while (slotsToRemove > 0 && downloadingMagnets.last) {
+            Magnet *m = downloadingMagnets.last;
+            DownloadSlot *slot = m->slot;
+            m->slot = nullptr;
+            m->md->stop();
+            downloadingMagnets.remove(m);
+            m->state = QUEUED;
+            queuedMagnets.prepend(m);
+            delete slot;
+            Q_EMIT magnetChanged(m->id);
+
+            --slotsToRemove;
         }
     }
-    if (updateIndex >= 0)
-        Q_EMIT updateQueue(updateIndex, updateCount);
 }
 
 void MagnetManager::setUseSlotTimer(bool value)
 {
     useSlotTimer = value;
 
-    if (!useSlotTimer) {
-        for (DownloadSlot *slot : qAsConst(usedDownloadingSlots)) {
+    for (Magnet *m = downloadingMagnets.first; m; m = m->next) {
+        DownloadSlot *slot = m->slot;
+        if (!useSlotTimer) {
             slot->stopTimer();
             slot->setTimerDuration(timerDuration);
-        }
-    } else {
-        for (DownloadSlot *slot : qAsConst(usedDownloadingSlots)) {
-            if (!slot->isTimerActived()) {
-                slot->setTimerDuration(timerDuration);
-                slot->startTimer();
-            }
+        } else if (!slot->isTimerActived()) {
+            slot->setTimerDuration(timerDuration);
+            slot->startTimer();
         }
     }
 }
@@ -339,24 +439,105 @@ void MagnetManager::setUseSlotTimer(bool value)
 void MagnetManager::setTimerDuration(bt::Uint32 duration)
 {
     timerDuration = duration * 60000; // convert to milliseconds
-    for (DownloadSlot *slot : qAsConst(usedDownloadingSlots))
-        slot->setTimerDuration(timerDuration);
+    for (Magnet *m = downloadingMagnets.first; m; m = m->next) {
+        m->slot->setTimerDuration(timerDuration);
+        Q_EMIT magnetChanged(m->id);
+    }
 
     for (DownloadSlot *slot : qAsConst(freeDownloadingSlots))
         slot->setTimerDuration(timerDuration);
-
-    Q_EMIT updateQueue(0, usedDownloadingSlots.size());
 }
 
 void MagnetManager::update()
 {
-    for (DownloadSlot *slot : qAsConst(usedDownloadingSlots))
-        magnetQueue.at(slot->getMagnetIndex())->update();
+    const bt::TimeStamp now = bt::CurrentTime();
+
+    Magnet *m = downloadingMagnets.first;
+    while (m) {
+        Magnet *next = m->next;
+        m->md->update();
+        m->peers = std::max<bt::Uint32>(m->peers, m->md->numPeers());
+        if (m->peers == 0 && now - m->started >= DEAD_TIME)
+            backOff(m, now);
+        else if (m->peers > 0)
+            m->failures = 0;
+        Q_EMIT magnetChanged(m->id);
+        m = next;
+    }
+
+    // dead magnets whose delay has passed get back in the queue
+    while (!backoff.isEmpty() && backoff.firstKey() <= now) {
+        m = backoff.first();
+        unlink(m);
+        queuedMagnets.append(m);
+    }
+
+    adaptSlots(now);
+    startNextQueuedMagnets();
+}
+
+void MagnetManager::backOff(Magnet *m, bt::TimeStamp now)
+{
+    Out(SYS_GEN | LOG_DEBUG) << "No peers found for " << m->md->magnetLink().displayName() << ", trying again later" << endl;
+    m->md->stop();
+    freeDownloadSlot(m);
+    unlink(m);
+    m->state = QUEUED;
+
+    const int shift = std::min<bt::Uint32>(m->failures, 8);
+    m->failures++;
+    m->retry = now + std::min(MIN_BACKOFF << shift, MAX_BACKOFF);
+    m->waiting = true;
+    backoff.insert(m->retry, m);
+}
+
+void MagnetManager::adaptSlots(bt::TimeStamp now)
+{
+    if (windowStart == 0) {
+        windowStart = now;
+        return;
+    }
+
+    if (now - windowStart < RATE_WINDOW)
+        return;
 
-    Q_EMIT updateQueue(0, usedDownloadingSlots.size());
+    // Hill climbing on the number of finished magnets per window: keep adding
+    // slots while that goes up and magnets are waiting, step back when it drops.
+    const int max_extra = std::min(baseSlots, MAX_SLOTS - baseSlots);
+    const bool waiting = queuedMagnets.count > 0;
+    if (fetched > lastFetched && waiting && extraSlots < max_extra)
+        extraSlots++;
+    else if ((fetched < lastFetched || !waiting) && extraSlots > 0)
+        extraSlots--;
+
+    lastFetched = fetched;
+    fetched = 0;
+    windowStart = now;
+
+    if (baseSlots + extraSlots != downloadingSlots()) {
+        Out(SYS_GEN | LOG_DEBUG) << "Magnet download slots: " << baseSlots << " + " << extraSlots << endl;
+        resizeSlots(baseSlots + extraSlots);
+    }
 }
 
 void MagnetManager::loadMagnets(const QString &file)
+{
+    journal.close();
+    const bt::Uint32 hits = cacheHits;
+    loadSnapshot(file);
+
+    const QList<MagnetJournal::Record> records = MagnetJournal::load(file);
+    for (const MagnetJournal::Record &r : records)
+        replay(r);
+
+    journal.open(file);
+    // write the replayed changes and the magnets completed from the cache
+    // to the magnets file, so the journal starts empty
+    if (!records.isEmpty() || hits != cacheHits)
+        journal.compact(entries());
+}
+
+void MagnetManager::loadSnapshot(const QString &file)
 {
     QFile fptr(file);
     if (!fptr.open(QIODevice::ReadOnly)) {
@@ -398,155 +579,203 @@ void MagnetManager::loadMagnets(const QString &file)
     delete node;
 }
 
-void MagnetManager::saveMagnets(const QString &file)
+void MagnetManager::replay(const MagnetJournal::Record &r)
 {
-    File fptr;
-    if (!fptr.open(file, QStringLiteral("wb"))) {
-        Out(SYS_GEN | LOG_NOTICE) << "Failed to open " << file << " : " << fptr.errorString() << endl;
+    if (r.type == MagnetJournal::Record::ADD) {
+        addMagnet(r.entry.mlink, r.entry.options, r.entry.stopped);
         return;
     }
 
-    BEncoder enc(&fptr);
-    enc.beginList();
-
-    for (MagnetDownloader *md : qAsConst(magnetQueue))
-        writeEncoderInfo(enc, md);
-
-    for (MagnetDownloader *md : qAsConst(stoppedList))
-        writeEncoderInfo(enc, md);
+    const bt::Uint32 id = magnetIds.value(r.hash);
+    if (id == 0)
+        return;
 
-    enc.end();
+    switch (r.type) {
+    case MagnetJournal::Record::REMOVE:
+        removeMagnets({id});
+        break;
+    case MagnetJournal::Record::START:
+        start({id});
+        break;
+    case MagnetJournal::Record::STOP:
+        stop({id});
+        break;
+    default:
+        break;
+    }
 }
 
-void MagnetManager::writeEncoderInfo(bt::BEncoder &enc, kt::MagnetDownloader *md)
+void MagnetManager::checkJournal()
 {
-    enc.beginDict();
-    enc.write(QByteArrayLiteral("magnet"), md->magnetLink().toString().toUtf8());
-    enc.write(QByteArrayLiteral("stopped"), stoppedHashes.contains(md->magnetLink().infoHash()));
-    enc.write(QByteArrayLiteral("silent"), md->options.silently);
-    enc.write(QByteArrayLiteral("group"), md->options.group.toUtf8());
-    enc.write(QByteArrayLiteral("location"), md->options.location.toUtf8());
-    enc.write(QByteArrayLiteral("move_on_completion"), md->options.move_on_completion.toUtf8());
-    enc.end();
+    if (journal.needsCompaction(count()))
+        journal.compact(entries());
 }
 
-MagnetManager::MagnetState MagnetManager::status(bt::Uint32 idx) const
+QList<MagnetJournal::Entry> MagnetManager::entries() const
 {
-    Q_ASSERT(idx < (Uint32)magnetHashes.size());
+    QList<MagnetJournal::Entry> ret;
+    ret.reserve(magnetsById.size());
+    const QList<Magnet *> all = ordered();
+    for (Magnet *m : all) {
+        const MagnetJournal::Entry e = {m->md->magnetLink(), m->md->options, m->state == STOPPED};
+        ret.append(e);
+    }
+    return ret;
+}
 
-    const MagnetDownloader *md = getMagnetDownloader(idx);
+void MagnetManager::saveMagnets(const QString &file)
+{
+    journal.close();
+    MagnetJournal::save(file, entries());
+    journal.open(file);
+}
 
-    if (idx >= (Uint32)magnetQueue.size())
-        return STOPPED;
-    else if (md->running())
-        return DOWNLOADING;
-    else
-        return QUEUED;
+MagnetManager::MagnetState MagnetManager::status(bt::Uint32 id) const
+{
+    Magnet *m = magnetsById.value(id);
+    Q_ASSERT(m);
+    return m ? m->state : STOPPED;
 }
 
 int MagnetManager::count() const
 {
-    return magnetHashes.size();
+    return magnetsById.size();
 }
 
-const MagnetDownloader *MagnetManager::getMagnetDownloader(bt::Uint32 idx) const
+QList<bt::Uint32> MagnetManager::magnets() const
 {
-    Q_ASSERT(idx < (Uint32)magnetHashes.size());
-
-    MagnetDownloader *md = nullptr;
-
-    Uint32 downloadQueueSize = magnetQueue.size();
-    if (idx < downloadQueueSize)
-        md = magnetQueue.at(idx);
-    else
-        md = stoppedList.at(idx - downloadQueueSize);
+    QList<bt::Uint32> ids;
+    ids.reserve(magnetsById.size());
+    const QList<Magnet *> all = ordered();
+    for (Magnet *m : all)
+        ids.append(m->id);
+    return ids;
+}
 
-    return md;
+const MagnetDownloader *MagnetManager::getMagnetDownloader(bt::Uint32 id) const
+{
+    Magnet *m = magnetsById.value(id);
+    return m ? m->md : nullptr;
 }
 
 void MagnetManager::onDownloadFinished(bt::MagnetDownloader *md, const QByteArray &data)
 {
     MagnetDownloader *ktmd = (MagnetDownloader *)md;
+    fetched++;
+    cache.insert(md->magnetLink().infoHash(), data);
     Q_EMIT metadataDownloaded(md->magnetLink(), data, ktmd->options);
 
-    int magnetIndex = getMagnetIndex((MagnetDownloader *)md);
-    if (magnetIndex >= 0)
-        removeMagnets(magnetIndex, 1);
+    Magnet *m = magnetsById.value(magnetIds.value(md->magnetLink().infoHash()));
+    if (m) {
+        removeMagnet(m);
+        startNextQueuedMagnets();
+    }
 }
 
-void MagnetManager::onSlotTimeout(int magnetIdx)
+void MagnetManager::onSlotTimeout(bt::Uint32 magnetId)
 {
-    if (magnetIdx >= usedDownloadingSlots.size())
+    Magnet *m = magnetsById.value(magnetId);
+    if (!m || m->state != DOWNLOADING)
         return;
 
-    freeDownloadSlot(magnetIdx);
-    MagnetDownloader *md = magnetQueue.at(magnetIdx);
-    md->stop();
-    magnetQueue.removeAt(magnetIdx);
-    magnetQueue.push_back(md);
-
-    int updateIndex = startNextQueuedMagnets();
-    if (updateIndex < 0)
-        updateIndex = magnetIdx;
+    if (m->peers == 0) {
+        backOff(m, bt::CurrentTime());
+    } else {
+        m->md->stop();
+        freeDownloadSlot(m);
+        moveTo(m, QUEUED);
+    }
+    Q_EMIT magnetChanged(m->id);
 
-    Q_EMIT updateQueue(updateIndex, magnetQueue.size() - updateIndex);
+    startNextQueuedMagnets();
 }
 
-int MagnetManager::startNextQueuedMagnets()
+MagnetManager::Magnet *MagnetManager::nextQueuedMagnet() const
 {
-    if (magnetQueue.empty() || freeDownloadingSlots.isEmpty())
-        return -1;
-
-    int firstStartedIdx = usedDownloadingSlots.size();
-    int queued = magnetQueue.size() - firstStartedIdx;
-    int magnetsToStart = std::min(freeDownloadingSlots.size(), queued);
+    // the magnet which saw the most peers before is the most likely to finish,
+    // only the front of the queue is considered so new magnets get their turn too
+    Magnet *best = queuedMagnets.first;
+    int i = 0;
+    for (Magnet *m = queuedMagnets.first; m && i < CANDIDATES; m = m->next, ++i) {
+        if (m->peers > best->peers)
+            best = m;
+    }
+    return best;
+}
 
-    int nextIdx = firstStartedIdx;
-    while (magnetsToStart > 0) {
+void MagnetManager::startNextQueuedMagnets()
+{
+    while (queuedMagnets.first && !freeDownloadingSlots.isEmpty()) {
+        Magnet *m = nextQueuedMagnet();
         DownloadSlot *slot = freeDownloadingSlots.front();
         freeDownloadingSlots.pop_front();
-        slot->setMagnetIndex(nextIdx);
-        usedDownloadingSlots.push_back(slot);
+        slot->setMagnetId(m->id);
+        m->slot = slot;
+        moveTo(m, DOWNLOADING);
 
-        magnetQueue.at(nextIdx)->start();
+        m->md->start();
+        m->started = bt::CurrentTime();
+        m->peers = 0;
         if (useSlotTimer)
             slot->startTimer();
 
-        --magnetsToStart;
-        ++nextIdx;
+        Q_EMIT magnetChanged(m->id);
     }
+}
 
-    return firstStartedIdx;
+void MagnetManager::moveTo(Magnet *m, MagnetState state)
+{
+    unlink(m);
+    m->state = state;
+    list(state).append(m);
 }
 
-void MagnetManager::freeDownloadSlot(bt::Uint32 magnetIdx)
+void MagnetManager::unlink(Magnet *m)
 {
-    Uint32 usedDownloadingSlotsSize = usedDownloadingSlots.size();
-    if (magnetIdx >= usedDownloadingSlotsSize)
-        return;
+    if (m->waiting) {
+        backoff.remove(m->retry, m);
+        m->waiting = false;
+    } else {
+        list(m->state).remove(m);
+    }
+}
 
-    // free the slot used by magnetIdx
-    DownloadSlot *slot = usedDownloadingSlots.at(magnetIdx);
-    usedDownloadingSlots.removeAt(magnetIdx);
-    slot->reset();
-    freeDownloadingSlots.push_front(slot);
+QList<MagnetManager::Magnet *> MagnetManager::ordered() const
+{
+    QList<Magnet *> ret;
+    ret.reserve(magnetsById.size());
+    for (Magnet *m = downloadingMagnets.first; m; m = m->next)
+        ret.append(m);
+    for (Magnet *m = queuedMagnets.first; m; m = m->next)
+        ret.append(m);
+    for (Magnet *m : backoff)
+        ret.append(m);
+    for (Magnet *m = stoppedMagnets.first; m; m = m->next)
+        ret.append(m);
+    return ret;
+}
 
-    // sync magnet indices of next slots
-    --usedDownloadingSlotsSize;
-    for (Uint32 i = magnetIdx; i < usedDownloadingSlotsSize; ++i)
-        usedDownloadingSlots.at(i)->setMagnetIndex(i);
+MagnetManager::MagnetList &MagnetManager::list(MagnetState state)
+{
+    switch (state) {
+    case DOWNLOADING:
+        return downloadingMagnets;
+    case QUEUED:
+        return queuedMagnets;
+    default:
+        return stoppedMagnets;
+    }
 }
 
-int MagnetManager::getMagnetIndex(kt::MagnetDownloader *md)
+void MagnetManager::freeDownloadSlot(Magnet *m)
 {
-    if (stoppedHashes.contains(md->magnetLink().infoHash())) {
-        int magnetIndex = magnetQueue.size() + stoppedList.indexOf(md);
-        if (magnetIndex >= magnetQueue.size()) // md is inside of magnetStopList
-            return magnetIndex;
-    } else
-        return magnetQueue.indexOf(md);
+    DownloadSlot *slot = m->slot;
+    if (!slot)
+        return;
 
-    return -1;
+    m->slot = nullptr;
+    slot->reset();
+    freeDownloadingSlots.push_front(slot);
 }
 
 }
@@ -21,9 +21,14 @@
 #ifndef MAGNETMANAGER_H
 #define MAGNETMANAGER_H
 
+#include <QHash>
+#include <QMap>
+
 #include <bcodec/bencoder.h>
 #include <interfaces/coreinterface.h>
 #include <magnet/magnetdownloader.h>
+#include <torrent/magnetjournal.h>
+#include <torrent/metadatacache.h>
 
 namespace kt
 {
@@ -45,7 +50,7 @@ public:
 };
 
 /// This class represent a downloading slot.
-/// A downloading slot has the index of the magnet that occupy it and a timer that
+/// A downloading slot has the id of the magnet that occupy it and a timer that
 /// controls the maximum time that one magnet can occupy the downloading slot.
 class DownloadSlot : public QObject
 {
@@ -58,19 +63,19 @@ public:
     void startTimer();
     void stopTimer();
     void reset();
-    void setMagnetIndex(int index);
-    int getMagnetIndex() const;
+    void setMagnetId(bt::Uint32 id);
+    bt::Uint32 getMagnetId() const;
     bool isTimerActived() const;
     bool isOccupied() const;
 
 Q_SIGNALS:
-    void timeout(int magnetIdx);
+    void timeout(bt::Uint32 magnetId);
 
 private Q_SLOTS:
     void onTimeout();
 
 private:
-    int magnetIdx;
+    bt::Uint32 magnetId;
     unsigned int timerDuration;
     QTimer *timer;
 };
@@ -82,6 +87,14 @@ private:
 /// within this time, that magnet will be pushed back at the end of the queued list,
 /// just above the stopped magnets list.
 /// The stopped magnet links always will occupy the latests positions of the queue.
+///
+/// Magnets which do not find a single peer are given up on early and are retried
+/// after an exponentially growing delay. Free slots go to the queued magnets which
+/// had the most peers before, and extra slots are added on top of the configured
+/// number as long as that makes more magnets finish.
+///
+/// Magnets are identified by an id which does not change while the magnet is managed,
+/// all operations on a single magnet take constant time.
 class KTCORE_EXPORT MagnetManager : public QObject
 {
     Q_OBJECT
@@ -89,27 +102,50 @@ public:
     MagnetManager(QObject *parent = nullptr);
     ~MagnetManager() override;
 
-    /// Adds a magnet link to the queue
+    /// Adds a magnet link to the queue. If the metadata is in the cache, metadataDownloaded
+    /// is emitted right away instead. Adding a magnet which is already managed starts the
+    /// existing magnet unless stopped is set.
     /// @param mlink magnet link to be added
     /// @param options magnet link options
     /// @param stopped whether this magnet should be added to the queue stopped
-    void addMagnet(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options, bool stopped);
+    /// @return the id of the magnet, 0 if the metadata was found in the cache
+    bt::Uint32 addMagnet(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options, bool stopped);
+
+    /// Adds a batch of magnet links to the queue. Links which are already managed or
+    /// appear more than once are skipped. The batch is announced with a single
+    /// magnetsAdded signal and written to the journal at once.
+    /// @param mlinks magnet links to be added
+    /// @param options magnet link options, the same for all links
+    /// @param stopped whether the magnets should be added to the queue stopped
+    /// @return the number of magnets which were queued or completed from the cache
+    int addMagnets(const QList<bt::MagnetLink> &mlinks, const MagnetLinkLoadOptions &options, bool stopped);
+
+    /// Removes magnets
+    void removeMagnets(const QList<bt::Uint32> &ids);
+
+    /// Starts magnets
+    void start(const QList<bt::Uint32> &ids);
 
-    /// Removes count successive magnets, starting on idx
-    void removeMagnets(bt::Uint32 idx, bt::Uint32 count);
+    /// Stops magnets
+    void stop(const QList<bt::Uint32> &ids);
 
-    /// Starts count successive magnets, starting on idx
-    void start(bt::Uint32 idx, bt::Uint32 count);
+    /// Returns whether the magnet with id is stopped
+    bool isStopped(bt::Uint32 id) const;
 
-    /// Stops count successive magnets, starting on idx
-    void stop(bt::Uint32 idx, bt::Uint32 count);
+    /// Open the metadata cache
+    /// @param dir directory of the cache
+    void setMetadataCacheDir(const QString &dir);
 
-    /// Returns whether the magnet corresponding with idx is stopped
-    bool isStopped(bt::Uint32 idx) const;
+    /// Set the maximum size of the metadata cache
+    /// @param size size in MiB, 0 disables the cache
+    void setMetadataCacheSize(bt::Uint32 size);
 
-    /// Set the number of concurrent downloading magnets
+    /// Set the number of concurrent downloading magnets, extra slots may be added when that helps
     void setDownloadingSlots(bt::Uint32 count);
 
+    /// Get the number of download slots, including the extra ones
+    int downloadingSlots() const;
+
     /// Sets if the slot timer must be used
     void setUseSlotTimer(bool value);
 
@@ -117,13 +153,13 @@ public:
     /// @param duration time in minutes
     void setTimerDuration(bt::Uint32 duration);
 
-    /// Updates the downloading magnets
+    /// Updates the downloading magnets, gives up on dead magnets and adapts the number of slots
     void update();
 
-    /// Load all magnets from a file
+    /// Load all magnets from a file and replay its journal, changes are journaled from then on
     void loadMagnets(const QString &file);
 
-    /// Save all magnets to a file
+    /// Save all magnets to a file, this also compacts the journal
     void saveMagnets(const QString &file);
 
     /// Defines the magnet state on the MagnetManager
@@ -133,55 +169,139 @@ public:
         STOPPED, ///< Stopped
     };
 
-    /// Return the state of the magnet corresponding to idx
-    MagnetState status(bt::Uint32 idx) const;
+    /// Return the state of the magnet with id
+    MagnetState status(bt::Uint32 id) const;
 
     /// Return the number of managed magnets
     int count() const;
 
-    /// Get the magnet downloader at index idx in the list
-    /// @param idx index of the magnet
-    /// @return the magnet downloader or nullptr if idx is out of bounds
-    const kt::MagnetDownloader *getMagnetDownloader(bt::Uint32 idx) const;
+    /// Return the ids of all magnets, in queue order
+    QList<bt::Uint32> magnets() const;
+
+    /// Get the magnet downloader of a magnet
+    /// @param id id of the magnet
+    /// @return the magnet downloader or nullptr if there is no magnet with id
+    const kt::MagnetDownloader *getMagnetDownloader(bt::Uint32 id) const;
 
 Q_SIGNALS:
     /// Emitted when metadata has been downloaded for a MagnetLink.
     void metadataDownloaded(const bt::MagnetLink &mlink, const QByteArray &data, const kt::MagnetLinkLoadOptions &options);
 
-    /// Emitted when the queue has been altered in some form, so the
-    /// magnets order and/or number could be altered.
-    /// The range of the altered magnets is determined by idx and count.
-    /// @param idx determines the index of the first altered magnet
-    /// @param count determines the number of magnets that must be updated
-    void updateQueue(bt::Uint32 idx, bt::Uint32 count);
+    /// Emitted when a magnet has been added
+    void magnetAdded(bt::Uint32 id);
+
+    /// Emitted when a batch of magnets has been added
+    void magnetsAdded(const QList<bt::Uint32> &ids);
+
+    /// Emitted when a magnet is about to be removed, it is still managed when this is emitted
+    void magnetRemoved(bt::Uint32 id);
+
+    /// Emitted when the state or the number of peers of a magnet changed
+    void magnetChanged(bt::Uint32 id);
 
 private Q_SLOTS:
     void onDownloadFinished(bt::MagnetDownloader *md, const QByteArray &data);
-    void onSlotTimeout(int magnetIdx);
+    void onSlotTimeout(bt::Uint32 magnetId);
 
 private:
-    /// Start the next queued magnets and return the index of the first started magnet
-    int startNextQueuedMagnets();
+    struct Magnet;
+
+    /// Intrusive doubly linked list of magnets, the magnets of each state have their own list
+    struct MagnetList {
+        Magnet *first;
+        Magnet *last;
+        int count;
+
+        MagnetList();
+        void append(Magnet *m);
+        void prepend(Magnet *m);
+        void remove(Magnet *m);
+    };
+
+    struct Magnet {
+        bt::Uint32 id;
+        kt::MagnetDownloader *md;
+        MagnetState state;
+        DownloadSlot *slot; // the slot the magnet occupies while it is downloading
+        Magnet *prev;
+        Magnet *next;
+        bt::TimeStamp started; // when the current download attempt started
+        bt::Uint32 peers; // most peers seen during the last download attempt
+        bt::Uint32 failures; // number of attempts in a row which did not find any peer
+        bt::TimeStamp retry; // when a dead magnet may be tried again
+        bool waiting; // in the backoff map instead of the queued list
+    };
+
+    /// Start the next queued magnets while there are free slots
+    void startNextQueuedMagnets();
+
+    /// Pick the queued magnet which is the most likely to finish
+    Magnet *nextQueuedMagnet() const;
+
+    /// Stop a dead magnet and retry it later
+    void backOff(Magnet *m, bt::TimeStamp now);
+
+    /// Change the number of slots
+    void resizeSlots(int count);
+
+    /// Adapt the number of extra slots to the rate at which metadata is fetched
+    void adaptSlots(bt::TimeStamp now);
+
+    /// Take a magnet out of the list or the backoff map it is in
+    void unlink(Magnet *m);
+
+    /// Get all magnets in queue order
+    QList<Magnet *> ordered() const;
+
+    /// Move a magnet to the end of the list of a state
+    void moveTo(Magnet *m, MagnetState state);
+
+    /// Get the list of a state
+    MagnetList &list(MagnetState state);
+
+    /// Free the download slot that the magnet is occupying
+    void freeDownloadSlot(Magnet *m);
+
+    /// Create a magnet and put it in the queue, without notifying anybody
+    Magnet *createMagnet(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options, bool stopped);
+
+    /// Remove a magnet
+    void removeMagnet(Magnet *m);
+
+    /// Complete a magnet using the metadata cache
+    /// @return true if the metadata was in the cache
+    bool completeFromCache(const bt::MagnetLink &mlink, const MagnetLinkLoadOptions &options);
+
+    /// Load the magnets file without its journal
+    void loadSnapshot(const QString &file);
 
-    /// Free the download slot that is occupying the magnet with magnetIdx, updating
-    /// the indices of the magnets in all magnets slots to keep it in sync with the magnet
-    /// queue indices.
-    void freeDownloadSlot(bt::Uint32 magnetIdx);
+    /// Get all magnets as they are stored in the magnets file
+    QList<MagnetJournal::Entry> entries() const;
 
-    /// Return the magnet index in the queue + the stopped list
-    int getMagnetIndex(kt::MagnetDownloader *md);
+    /// Apply a change from the journal
+    void replay(const MagnetJournal::Record &r);
 
-    /// Writes the encoder info of one magnet
-    void writeEncoderInfo(bt::BEncoder &enc, kt::MagnetDownloader *md);
+    /// Compact the journal if it has grown too much
+    void checkJournal();
 
     bool useSlotTimer;
     int timerDuration;
-    QList<DownloadSlot *> usedDownloadingSlots;
     QList<DownloadSlot *> freeDownloadingSlots;
-    QList<kt::MagnetDownloader *> magnetQueue;
-    QList<kt::MagnetDownloader *> stoppedList;
-    QSet<bt::SHA1Hash> magnetHashes;
-    QSet<bt::SHA1Hash> stoppedHashes;
+    QHash<bt::Uint32, Magnet *> magnetsById;
+    QHash<bt::SHA1Hash, bt::Uint32> magnetIds;
+    MagnetList downloadingMagnets;
+    MagnetList queuedMagnets;
+    MagnetList stoppedMagnets;
+    bt::Uint32 nextId;
+    QMultiMap<bt::TimeStamp, Magnet *> backoff; // dead magnets by retry time
+    int baseSlots;
+    int extraSlots;
+    bt::TimeStamp windowStart;
+    bt::Uint32 fetched; // metadata downloads finished in the current window
+    bt::Uint32 lastFetched; // metadata downloads finished in the previous window
+    MagnetJournal journal;
+    MetadataCache cache;
+    bt::Uint32 cacheHits;
 };
 
 }
@@ -0,0 +1,153 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "metadatacache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+MetadataCache::MetadataCache()
+    : max_size(0)
+    , total_size(0)
+    , next_stamp(0)
+{
+}
+
+MetadataCache::~MetadataCache()
+{
+}
+
+void MetadataCache::open(const QString &dir)
+{
+    this->dir = dir;
+    items.clear();
+    lru.clear();
+    total_size = 0;
+    next_stamp = 0;
+
+    QDir d(dir);
+    if (!d.exists() && !d.mkpath(QStringLiteral("."))) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to create metadata cache " << dir << endl;
+        return;
+    }
+
+    // oldest first, so that the use stamps follow the modification times
+    const QFileInfoList files = d.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo &fi : files) {
+        const QByteArray raw = QByteArray::fromHex(fi.fileName().toLatin1());
+        if (fi.fileName().length() != 40 || raw.size() != 20)
+            continue;
+
+        SHA1Hash hash((const Uint8 *)raw.constData());
+        Item item = {(Uint64)fi.size(), next_stamp++};
+        items.insert(hash, item);
+        lru.insert(item.stamp, hash);
+        total_size += item.size;
+    }
+
+    evict();
+}
+
+void MetadataCache::setMaxSize(bt::Uint64 size)
+{
+    max_size = size;
+    evict();
+}
+
+QString MetadataCache::path(const bt::SHA1Hash &hash) const
+{
+    return dir + QLatin1Char('/') + hash.toString();
+}
+
+bool MetadataCache::find(const bt::SHA1Hash &hash, QByteArray &data)
+{
+    if (max_size == 0 || !items.contains(hash))
+        return false;
+
+    QFile fptr(path(hash));
+    if (!fptr.open(QIODevice::ReadWrite)) {
+        remove(hash);
+        return false;
+    }
+
+    data = fptr.readAll();
+    if (SHA1Hash::generate((const Uint8 *)data.constData(), data.size()) != hash) {
+        Out(SYS_GEN | LOG_NOTICE) << "Cached metadata of " << hash.toString() << " is corrupted" << endl;
+        fptr.close();
+        remove(hash);
+        data.clear();
+        return false;
+    }
+
+    // keep the LRU order across restarts
+    fptr.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    touch(hash);
+    return true;
+}
+
+void MetadataCache::insert(const bt::SHA1Hash &hash, const QByteArray &data)
+{
+    if (max_size == 0 || dir.isEmpty() || (Uint64)data.size() > max_size)
+        return;
+
+    if (SHA1Hash::generate((const Uint8 *)data.constData(), data.size()) != hash)
+        return;
+
+    if (items.contains(hash)) {
+        touch(hash);
+        return;
+    }
+
+    QSaveFile fptr(path(hash));
+    if (!fptr.open(QIODevice::WriteOnly) || fptr.write(data) != data.size() || !fptr.commit()) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to write " << path(hash) << " : " << fptr.errorString() << endl;
+        return;
+    }
+
+    Item item = {(Uint64)data.size(), next_stamp++};
+    items.insert(hash, item);
+    lru.insert(item.stamp, hash);
+    total_size += item.size;
+    evict();
+}
+
+void MetadataCache::touch(const bt::SHA1Hash &hash)
+{
+    Item &item = items[hash];
+    lru.remove(item.stamp);
+    item.stamp = next_stamp++;
+    lru.insert(item.stamp, hash);
+}
+
+void MetadataCache::remove(const bt::SHA1Hash &hash)
+{
+    auto i = items.find(hash);
+    if (i == items.end())
+        return;
+
+    QFile::remove(path(hash));
+    lru.remove(i->stamp);
+    total_size -= i->size;
+    items.erase(i);
+}
+
+void MetadataCache::evict()
+{
+    while (total_size > max_size && !lru.isEmpty()) {
+        const SHA1Hash hash = lru.first();
+        remove(hash);
+    }
+}
+
+}
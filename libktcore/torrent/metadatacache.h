@@ -0,0 +1,80 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_METADATACACHE_H
+#define KT_METADATACACHE_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+
+#include <ktcore_export.h>
+#include <util/sha1hash.h>
+
+namespace kt
+{
+/**
+ * Cache of the info dictionaries downloaded for magnet links. Every info
+ * dictionary is stored in a file named after its info hash and is verified
+ * against that hash when it is read back. The total size of the cache is
+ * limited, the least recently used entries are evicted first.
+ */
+class KTCORE_EXPORT MetadataCache
+{
+public:
+    MetadataCache();
+    ~MetadataCache();
+
+    /**
+     * Open the cache, the entries already in dir are picked up.
+     * @param dir The directory of the cache
+     */
+    void open(const QString &dir);
+
+    /**
+     * Set the maximum size of the cache, 0 disables the cache.
+     * @param size The size in bytes
+     */
+    void setMaxSize(bt::Uint64 size);
+
+    /**
+     * Look up the info dictionary of a torrent.
+     * @param hash The info hash
+     * @param data Will be set to the info dictionary
+     * @return true if the info dictionary was found
+     */
+    bool find(const bt::SHA1Hash &hash, QByteArray &data);
+
+    /**
+     * Add an info dictionary to the cache, it is ignored if it does not match the hash.
+     * @param hash The info hash
+     * @param data The info dictionary
+     */
+    void insert(const bt::SHA1Hash &hash, const QByteArray &data);
+
+private:
+    struct Item {
+        bt::Uint64 size;
+        bt::Uint64 stamp;
+    };
+
+    QString path(const bt::SHA1Hash &hash) const;
+    void touch(const bt::SHA1Hash &hash);
+    void remove(const bt::SHA1Hash &hash);
+    void evict();
+
+private:
+    QString dir;
+    bt::Uint64 max_size;
+    bt::Uint64 total_size;
+    bt::Uint64 next_stamp;
+    QHash<bt::SHA1Hash, Item> items;
+    QMap<bt::Uint64, bt::SHA1Hash> lru; // use stamp to info hash, oldest first
+};
+
+}
+
+#endif
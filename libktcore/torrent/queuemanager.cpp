@@ -21,10 +21,11 @@
 
 #include "queuemanager.h"
 
+#include <QDir>
+#include <QMap>
 #include <QNetworkConfigurationManager>
 
 #include <KLocalizedString>
-#include <KMessageBox>
 
 #include <algorithm>
 #include <climits>
@@ -46,18 +47,42 @@ using namespace bt;
 
 namespace kt
 {
+// space between the priorities of successive torrents, after reindexing the queue
+const int PRIORITY_GAP = 1024;
+// when respacing a part of the queue, the priorities must be at least this far apart
+const int MIN_PRIORITY_GAP = 16;
+// interval at which the upload rate of running seeds is sampled for the seed ranking
+const bt::TimeStamp SEED_SAMPLE_INTERVAL = 5000;
+// number of idle seeds scraped at each seed rotation
+const int SEED_SCRAPE_BATCH = 50;
+
 QueueManager::QueueManager()
     : QObject()
 {
     max_downloads = 0;
     max_seeds = 0; // for testing. Needs to be added to Settings::
+    max_downloads_per_device = 0;
+    adaptive_slots = false;
+    rotate_seeds = false;
+    rotation_interval = 30 * 60 * 1000;
+    last_rotation = 0;
+    last_seed_sample = 0;
+    scrape_cursor = 0;
+    seed_ranker.setScrapeResults(&scrape_batcher);
 
     keep_seeding = true; // test. Will be passed from Core
     suspended_state = false;
     exiting = false;
     ordering = false;
+    full_reorder = false;
 
     last_stats_sync_permitted = 0;
+    stats_journal_enabled = false;
+    stall_time = 0;
+
+    order_timer.setSingleShot(true);
+    order_timer.setInterval(0);
+    connect(&order_timer, &QTimer::timeout, this, &QueueManager::delayedOrderQueue);
 
     QNetworkConfigurationManager *networkConfigurationManager = new QNetworkConfigurationManager(this);
     connect(networkConfigurationManager, &QNetworkConfigurationManager::onlineStateChanged, this, &QueueManager::onOnlineStateChanged);
@@ -71,14 +96,64 @@ QueueManager::~QueueManager()
 void QueueManager::append(bt::TorrentInterface *tc)
 {
     downloads.append(tc);
+    torrent_index.insert(tc->getInfoHash(), tc);
+    if (suspended_state && suspended_hashes.remove(tc->getInfoHash().toString()))
+        suspended_torrents.insert(tc);
     connect(tc, &TorrentInterface::diskSpaceLow, this, &QueueManager::onLowDiskSpace);
     connect(tc, &TorrentInterface::torrentStopped, this, &QueueManager::torrentStopped);
-    connect(tc, &TorrentInterface::updateQueue, this, &QueueManager::orderQueue);
+    connect(tc, &TorrentInterface::updateQueue, this, [this, tc]() {
+        requeue(tc);
+    });
+    // a status change can move the torrent to another queue, or out of the queues
+    connect(tc, &TorrentInterface::statusChanged, this, [this, tc]() {
+        requeue(tc);
+        updateRunning(tc);
+        // data checks occupy a slot on the device of the torrent
+        if (tc->getStats().status == bt::CHECKING_DATA)
+            checking.insert(tc);
+        else
+            checking.erase(tc);
+    });
+    // files might have been moved, so they need to be indexed again, and the torrent may be queued again
+    connect(tc, &TorrentInterface::runningJobsDone, this, [this, tc]() {
+        stale_files.insert(tc);
+        requeue(tc);
+    });
+    // the file index is filled in when it is needed
+    stale_files.insert(tc);
+    updateRunning(tc);
+}
+
+void QueueManager::updateRunning(bt::TorrentInterface *tc)
+{
+    if (tc->getStats().running) {
+        if (running.insert(tc).second)
+            scheduleStallCheck(tc);
+    } else {
+        if (running.erase(tc) > 0 && tc->getStats().completed)
+            seed_ranker.stopped(tc, bt::CurrentTime());
+        stall_wheel.cancel(tc);
+    }
 }
 
 void QueueManager::remove(bt::TorrentInterface *tc)
 {
     suspended_torrents.erase(tc);
+    running.erase(tc);
+    checking.erase(tc);
+    pending_checks.erase(tc);
+    seed_ranker.remove(tc);
+    announce_scheduler.remove(tc);
+    scrape_batcher.remove(tc);
+    if (ranked_seeds.remove(tc))
+        seed_ranking.removeOne(tc);
+    stall_wheel.cancel(tc);
+    torrent_index.remove(tc->getInfoHash());
+    dirty.erase(tc);
+    stale_files.erase(tc);
+    unindexFiles(tc);
+    download_queue.removeOne(tc);
+    seed_queue.removeOne(tc);
     int index = downloads.indexOf(tc);
     if (index != -1)
         downloads.takeAt(index)->deleteLater();
@@ -88,6 +163,24 @@ void QueueManager::clear()
 {
     exiting = true;
     suspended_torrents.clear();
+    suspended_hashes.clear();
+    running.clear();
+    checking.clear();
+    pending_checks.clear();
+    seed_ranker.clear();
+    announce_scheduler.clear();
+    scrape_batcher.clear();
+    seed_ranking.clear();
+    ranked_seeds.clear();
+    stall_wheel.clear();
+    torrent_index.clear();
+    dirty.clear();
+    download_queue.clear();
+    seed_queue.clear();
+    order_timer.stop();
+    file_index.clear();
+    indexed_files.clear();
+    stale_files.clear();
     qDeleteAll(downloads);
     downloads.clear();
 }
@@ -123,7 +216,7 @@ bool QueueManager::checkLimits(TorrentInterface *tc, bool interactive)
     else
         return true;
 
-    if (interactive && KMessageBox::questionYesNo(0, msg, i18n("Limits reached.")) == KMessageBox::Yes) {
+    if (interactive && askStartAnyway(msg, i18n("Limits reached."), QStringList())) {
         if (max_ratio_reached)
             tc->setMaxShareRatio(0.00f);
         if (max_seed_time_reached)
@@ -134,6 +227,14 @@ bool QueueManager::checkLimits(TorrentInterface *tc, bool interactive)
     return false;
 }
 
+bool QueueManager::askStartAnyway(const QString &msg, const QString &caption, const QStringList &names)
+{
+    // nobody answering means the limits are respected
+    bool start = false;
+    Q_EMIT startAnywayQuestion(msg, caption, names, &start);
+    return start;
+}
+
 bool QueueManager::checkDiskSpace(TorrentInterface *tc, bool interactive)
 {
     if (tc->checkDiskSpace(false))
@@ -150,7 +251,7 @@ bool QueueManager::checkDiskSpace(TorrentInterface *tc, bool interactive)
             "Are you sure you want to continue?");
 
         QString caption = i18n("Insufficient disk space for %1", s.torrent_name);
-        if (!interactive || KMessageBox::questionYesNo(0, msg, caption) == KMessageBox::No)
+        if (!interactive || !askStartAnyway(msg, caption, QStringList()))
             return false;
         else
             break;
@@ -164,7 +265,7 @@ bool QueueManager::checkDiskSpace(TorrentInterface *tc, bool interactive)
 
 TorrentStartResponse QueueManager::start(bt::TorrentInterface *tc)
 {
-    if (tc->getJobQueue()->runningJobs()) {
+    if (tc->getJobQueue()->runningJobs() || pending_checks.count(tc)) {
         tc->setAllowedToStart(true);
         return BUSY_WITH_JOB;
     }
@@ -180,7 +281,7 @@ TorrentStartResponse QueueManager::start(bt::TorrentInterface *tc)
         return startInternal(tc);
     } else {
         tc->setAllowedToStart(true);
-        orderQueue();
+        requeue(tc);
         return START_OK;
     }
 }
@@ -191,8 +292,10 @@ void QueueManager::stop(bt::TorrentInterface *tc)
         return;
 
     const TorrentStats &s = tc->getStats();
-    if (enabled())
+    if (enabled()) {
         tc->setAllowedToStart(false);
+        requeue(tc);
+    }
 
     if (s.running)
         stopSafely(tc);
@@ -208,7 +311,7 @@ void QueueManager::stop(QList<bt::TorrentInterface *> &todo)
     }
     ordering = false;
     if (enabled())
-        orderQueue();
+        scheduleOrderQueue();
 }
 
 void QueueManager::checkDiskSpace(QList<bt::TorrentInterface *> &todo)
@@ -226,8 +329,7 @@ void QueueManager::checkDiskSpace(QList<bt::TorrentInterface *> &todo)
         }
 
         if (tmp.count() > 0) {
-            if (KMessageBox::questionYesNoList(0, i18n("Not enough disk space for the following torrents. Do you want to start them anyway?"), names)
-                == KMessageBox::No) {
+            if (!askStartAnyway(i18n("Not enough disk space for the following torrents. Do you want to start them anyway?"), QString(), names)) {
                 for (bt::TorrentInterface *tc : qAsConst(tmp))
                     todo.removeAll(tc);
             }
@@ -260,8 +362,7 @@ void QueueManager::checkMaxSeedTime(QList<bt::TorrentInterface *> &todo)
     }
 
     if (tmp.count() > 0) {
-        if (KMessageBox::questionYesNoList(0, i18n("The following torrents have reached their maximum seed time. Do you want to start them anyway?"), names)
-            == KMessageBox::No) {
+        if (!askStartAnyway(i18n("The following torrents have reached their maximum seed time. Do you want to start them anyway?"), QString(), names)) {
             for (bt::TorrentInterface *tc : qAsConst(tmp))
                 todo.removeAll(tc);
         } else {
@@ -284,8 +385,7 @@ void QueueManager::checkMaxRatio(QList<bt::TorrentInterface *> &todo)
     }
 
     if (tmp.count() > 0) {
-        if (KMessageBox::questionYesNoList(0, i18n("The following torrents have reached their maximum share ratio. Do you want to start them anyway?"), names)
-            == KMessageBox::No) {
+        if (!askStartAnyway(i18n("The following torrents have reached their maximum share ratio. Do you want to start them anyway?"), QString(), names)) {
             for (bt::TorrentInterface *tc : qAsConst(tmp))
                 todo.removeAll(tc);
         } else {
@@ -319,17 +419,18 @@ void QueueManager::start(QList<bt::TorrentInterface *> &todo)
         if (s.running)
             continue;
 
-        if (tc->getJobQueue()->runningJobs())
+        if (tc->getJobQueue()->runningJobs() || pending_checks.count(tc))
             continue;
 
-        if (enabled())
+        if (enabled()) {
             tc->setAllowedToStart(true);
-        else
+            dirty.insert(tc);
+        } else
             startSafely(tc);
     }
 
     if (enabled())
-        orderQueue();
+        scheduleOrderQueue();
 }
 
 void QueueManager::startAll()
@@ -410,17 +511,14 @@ int QueueManager::countSeeds()
 
 int QueueManager::getNumRunning(Flags flags)
 {
+    if (flags == ALL)
+        return running.size();
+
     int nr = 0;
-    QList<TorrentInterface *>::const_iterator i = downloads.constBegin();
-    while (i != downloads.constEnd()) {
-        const TorrentInterface *tc = *i;
+    for (const TorrentInterface *tc : running) {
         const TorrentStats &s = tc->getStats();
-
-        if (s.running) {
-            if (flags == ALL || (flags == DOWNLOADS && !s.completed) || (flags == SEEDS && s.completed))
-                nr++;
-        }
-        i++;
+        if ((flags == DOWNLOADS && !s.completed) || (flags == SEEDS && s.completed))
+            nr++;
     }
     return nr;
 }
@@ -466,13 +564,166 @@ void QueueManager::setMaxDownloads(int m)
     max_downloads = m;
 }
 
+void QueueManager::setAdaptiveDownloadSlots(bool on)
+{
+    if (adaptive_slots == on)
+        return;
+
+    adaptive_slots = on;
+    if (on)
+        slot_controller.reset(getNumRunning(DOWNLOADS));
+    scheduleOrderQueue();
+}
+
+void QueueManager::updateDownloadSlots(bt::TimeStamp now, bt::Uint32 rate, bt::Uint32 cap)
+{
+    if (!adaptive_slots || !enabled() || suspended_state)
+        return;
+
+    const bool waiting = download_queue.count() > getNumRunning(DOWNLOADS);
+    if (slot_controller.update(now, rate, cap, max_downloads, waiting)) {
+        Out(SYS_GEN | LOG_DEBUG) << "QM: download slots changed to " << slot_controller.slots() << " (utilization "
+                                 << QString::number(slot_controller.utilization() * 100.0, 'f', 0) << "%)" << endl;
+        scheduleOrderQueue();
+    }
+}
+
+int QueueManager::downloadSlots() const
+{
+    return adaptive_slots ? slot_controller.slots() : max_downloads;
+}
+
+void QueueManager::setSeedRotation(bool on, bt::Uint32 interval)
+{
+    rotation_interval = (bt::TimeStamp)interval * 60 * 1000;
+    if (rotate_seeds == on)
+        return;
+
+    rotate_seeds = on;
+    last_rotation = 0;
+    if (!on) {
+        seed_ranking.clear();
+        ranked_seeds.clear();
+    }
+    scheduleOrderQueue();
+}
+
+void QueueManager::rotateSeeds(bt::TimeStamp now)
+{
+    if (!rotate_seeds || !enabled() || suspended_state)
+        return;
+
+    // keep track of the upload rate of running seeds
+    if (now - last_seed_sample >= SEED_SAMPLE_INTERVAL) {
+        last_seed_sample = now;
+        for (bt::TorrentInterface *tc : running) {
+            if (tc->getStats().completed)
+                seed_ranker.sample(tc, now);
+        }
+    }
+
+    if (last_rotation != 0 && now - last_rotation < rotation_interval)
+        return;
+
+    // a new time slice starts, give the seed slots to the seeds which need them most
+    last_rotation = now;
+    seed_ranking = seed_ranker.rank(seed_queue, now);
+    ranked_seeds.clear();
+    for (bt::TorrentInterface *tc : qAsConst(seed_ranking))
+        ranked_seeds.insert(tc);
+
+    if (!seed_ranking.isEmpty()) {
+        bt::TorrentInterface *best = seed_ranking.first();
+        Out(SYS_GEN | LOG_DEBUG) << "QM: ranked " << seed_ranking.count() << " seeds, best is " << best->getStats().torrent_name << " (score "
+                                 << QString::number(seed_ranker.lastScore(best), 'f', 2) << ")" << endl;
+    }
+
+    scrapeIdleSeeds();
+    scheduleOrderQueue();
+}
+
+void QueueManager::scrapeIdleSeeds()
+{
+    // scrape a few seeds which are not running, so the next ranking knows how much their swarms need us
+    int scraped = 0;
+    const int count = seed_ranking.count();
+    for (int i = 0; i < count && scraped < SEED_SCRAPE_BATCH; i++) {
+        if (scrape_cursor >= count)
+            scrape_cursor = 0;
+
+        bt::TorrentInterface *tc = seed_ranking.at(scrape_cursor++);
+        if (!tc->getStats().running) {
+            scrape_batcher.scrape(tc);
+            scraped++;
+        }
+    }
+}
+
+void QueueManager::setMaxDownloadsPerDevice(int m)
+{
+    max_downloads_per_device = m;
+}
+
+QString QueueManager::storageDevice(bt::TorrentInterface *tc)
+{
+    return storage_devices.deviceOf(tc->getStats().output_path);
+}
+
+void QueueManager::setDataCheckPending(bt::TorrentInterface *tc, bool pending)
+{
+    // a torrent waiting for a data check is kept out of the queues
+    if (pending) {
+        pending_checks.insert(tc);
+        requeue(tc);
+    } else if (pending_checks.erase(tc) > 0) {
+        requeue(tc);
+    }
+}
+
+QList<QueueManager::DeviceStats> QueueManager::deviceStats()
+{
+    QMap<QString, DeviceStats> devices;
+    auto add = [this, &devices](bt::TorrentInterface *tc) -> DeviceStats & {
+        const QString device = storageDevice(tc);
+        QMap<QString, DeviceStats>::iterator i = devices.find(device);
+        if (i == devices.end()) {
+            DeviceStats ds;
+            ds.device = storage_devices.deviceName(device);
+            ds.mount_point = storage_devices.mountPoint(device);
+            ds.downloads = ds.seeds = ds.data_checks = 0;
+            ds.download_rate = ds.upload_rate = 0;
+            ds.bytes_downloaded = ds.bytes_uploaded = 0;
+            i = devices.insert(device, ds);
+        }
+        return i.value();
+    };
+
+    for (bt::TorrentInterface *tc : running) {
+        const TorrentStats &s = tc->getStats();
+        DeviceStats &ds = add(tc);
+        if (s.completed)
+            ds.seeds++;
+        else
+            ds.downloads++;
+        ds.download_rate += s.download_rate;
+        ds.upload_rate += s.upload_rate;
+        ds.bytes_downloaded += s.session_bytes_downloaded;
+        ds.bytes_uploaded += s.session_bytes_uploaded;
+    }
+
+    for (bt::TorrentInterface *tc : checking)
+        add(tc).data_checks++;
+
+    return devices.values();
+}
+
 void QueueManager::onLowDiskSpace(bt::TorrentInterface *tc, bool toStop)
 {
     if (toStop) {
         stopSafely(tc);
         if (enabled()) {
             tc->setAllowedToStart(false);
-            orderQueue();
+            requeue(tc);
         }
     }
 
@@ -492,34 +743,38 @@ void QueueManager::setKeepSeeding(bool ks)
 
 bool QueueManager::alreadyLoaded(const bt::SHA1Hash &ih) const
 {
-    for (const bt::TorrentInterface *tor : qAsConst(downloads)) {
-        if (tor->getInfoHash() == ih)
-            return true;
-    }
-    return false;
+    return torrent_index.contains(ih);
+}
+
+bt::TorrentInterface *QueueManager::find(const bt::SHA1Hash &ih) const
+{
+    return torrent_index.value(ih, 0);
 }
 
 void QueueManager::mergeAnnounceList(const bt::SHA1Hash &ih, const TrackerTier *trk)
 {
-    for (bt::TorrentInterface *tor : qAsConst(downloads)) {
-        if (tor->getInfoHash() == ih) {
-            TrackersList *ta = tor->getTrackersList();
-            const int cnt = ta->getTrackers().count();
-            ta->merge(trk);
-            if (cnt < ta->getTrackers().count()) {
-                // new trackers were added
-                // do "Manual Announce" for this torrent
-                if (tor->getStats().running) {
-                    tor->updateTracker();
-                }
-            }
-            return;
+    bt::TorrentInterface *tor = find(ih);
+    if (!tor)
+        return;
+
+    TrackersList *ta = tor->getTrackersList();
+    const int cnt = ta->getTrackers().count();
+    ta->merge(trk);
+    if (cnt < ta->getTrackers().count()) {
+        // new trackers were added
+        // do "Manual Announce" for this torrent
+        if (tor->getStats().running) {
+            announce_scheduler.announce(tor);
         }
     }
 }
 
 bool QueueManager::permitStatsSync(TorrentControl *tc)
 {
+    // the journal keeps the stats on disk up to date, without blocking
+    if (stats_journal_enabled)
+        return false;
+
     // we want to assure that minimum time interval delay is happen
     // before next TorrentControl dumps its State to the file
 
@@ -540,12 +795,88 @@ bool QueueManager::permitStatsSync(TorrentControl *tc)
 
 void QueueManager::orderQueue()
 {
-    if (ordering || !downloads.count() || exiting)
+    if (exiting)
+        return;
+
+    full_reorder = true;
+    scheduleOrderQueue();
+}
+
+void QueueManager::requeue(bt::TorrentInterface *tc)
+{
+    dirty.insert(tc);
+    scheduleOrderQueue();
+}
+
+void QueueManager::scheduleOrderQueue()
+{
+    if (!ordering && !exiting)
+        order_timer.start();
+}
+
+QueuePtrList *QueueManager::queueFor(bt::TorrentInterface *tc)
+{
+    const TorrentStats &s = tc->getStats();
+    if (!s.running && (!tc->isAllowedToStart() || s.stopped_by_error || tc->getJobQueue()->runningJobs() || pending_checks.count(tc)))
+        return 0;
+
+    if (!s.completed)
+        return &download_queue;
+    else if (s.running || (!tc->overMaxRatio() && !tc->overMaxSeedTime()))
+        return &seed_queue;
+    else
+        return 0;
+}
+
+void QueueManager::delayedOrderQueue()
+{
+    if (ordering || exiting)
         return;
 
+    if (!downloads.count()) {
+        dirty.clear();
+        full_reorder = false;
+        return;
+    }
+
     Q_EMIT orderingQueue();
 
-    downloads.sort(); // sort downloads, even when suspended so that the QM widget is updated
+    // torrents which become dirty while starting and stopping, are handled by the next pass
+    std::set<bt::TorrentInterface *> changed;
+    changed.swap(dirty);
+    const bool full = full_reorder;
+    full_reorder = false;
+
+    // sort downloads, even when suspended so that the QM widget is updated
+    if (full) {
+        // filesystems might have been mounted somewhere else in the meantime
+        storage_devices.clear();
+        downloads.sort();
+        download_queue.clear();
+        seed_queue.clear();
+        for (TorrentInterface *tc : qAsConst(downloads)) {
+            QueuePtrList *queue = queueFor(tc);
+            if (queue)
+                queue->append(tc);
+        }
+    } else {
+        // Everything queueFor looks at marks a torrent dirty when it changes (status changes,
+        // jobs, data checks, limits, starting and stopping), so only dirty torrents can move.
+        // First take them all out, so the queues stay sorted when putting them back.
+        // The queues are sorted on the current priorities, changePriority takes a
+        // torrent out before its priority changes.
+        for (TorrentInterface *tc : changed) {
+            if (!download_queue.removeSorted(tc))
+                seed_queue.removeSorted(tc);
+        }
+
+        for (TorrentInterface *tc : changed) {
+            QueuePtrList *queue = queueFor(tc);
+            if (queue)
+                queue->insertSorted(tc);
+        }
+    }
+
     if (Settings::manuallyControlTorrents() || suspended_state) {
         Q_EMIT queueOrdered();
         return;
@@ -553,50 +884,60 @@ void QueueManager::orderQueue()
 
     RecursiveEntryGuard guard(&ordering); // make sure that recursive entering of this function is not possible
 
-    QueuePtrList download_queue;
-    QueuePtrList seed_queue;
+    const std::set<bt::TorrentInterface *> *moved = full ? nullptr : &changed;
+    const QList<bt::TorrentInterface *> no_ranking;
+    startQueue(download_queue, no_ranking, downloadSlots(), max_downloads_per_device, moved);
+    startQueue(seed_queue, rotate_seeds ? seed_ranking : no_ranking, max_seeds, 0, moved);
 
-    for (TorrentInterface *tc : qAsConst(downloads)) {
-        const TorrentStats &s = tc->getStats();
-        if (s.running || (tc->isAllowedToStart() && !s.stopped_by_error && !tc->getJobQueue()->runningJobs())) {
-            if (s.completed) {
-                if (s.running || (!tc->overMaxRatio() && !tc->overMaxSeedTime()))
-                    seed_queue.append(tc);
-            } else
-                download_queue.append(tc);
-        }
+    Q_EMIT queueOrdered();
+}
+
+void QueueManager::startQueue(QueuePtrList &queue,
+                              const QList<bt::TorrentInterface *> &ranking,
+                              int max,
+                              int max_per_device,
+                              const std::set<bt::TorrentInterface *> *changed)
+{
+    // number of slots in use on each device, data checks take up a slot as well
+    QHash<QString, int> device_slots;
+    if (max_per_device > 0) {
+        for (bt::TorrentInterface *tc : checking)
+            device_slots[storageDevice(tc)]++;
     }
 
+    // Hand out the slots in queue order. After a full reorder the whole queue is walked, otherwise
+    // the walk stops once all slots are taken: the rest of the queue was already queued by an earlier
+    // pass, except for running torrents which lost their slot and torrents which were just moved.
+    std::set<bt::TorrentInterface *> visited;
     int num_running = 0;
-    for (bt::TorrentInterface *tc : qAsConst(download_queue)) {
+    auto visit = [&](bt::TorrentInterface *tc) -> bool {
+        if (changed && max > 0 && num_running >= max)
+            return false;
+
+        visited.insert(tc);
         const TorrentStats &s = tc->getStats();
 
-        if (num_running < max_downloads || max_downloads == 0) {
-            if (!s.running) {
-                Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
-                if (startInternal(tc) == bt::START_OK)
-                    num_running++;
-            } else
-                num_running++;
-        } else {
-            if (s.running) {
-                Out(SYS_GEN | LOG_DEBUG) << "QM Stopping: " << s.torrent_name << endl;
-                stopSafely(tc);
-            }
-            tc->setQueued(true);
+        // when the device of a torrent is full, the slot goes to the next torrent on another device
+        QString device;
+        bool device_full = false;
+        if (max_per_device > 0 && checking.count(tc) == 0) {
+            device = storageDevice(tc);
+            device_full = !device.isEmpty() && device_slots.value(device) >= max_per_device;
         }
-    }
 
-    num_running = 0;
-    for (bt::TorrentInterface *tc : qAsConst(seed_queue)) {
-        const TorrentStats &s = tc->getStats();
-        if (num_running < max_seeds || max_seeds == 0) {
+        if ((num_running < max || max == 0) && !device_full) {
             if (!s.running) {
                 Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
-                if (startInternal(tc) == bt::START_OK)
+                if (startInternal(tc) == bt::START_OK) {
                     num_running++;
-            } else
+                    if (!device.isEmpty())
+                        device_slots[device]++;
+                }
+            } else {
                 num_running++;
+                if (!device.isEmpty())
+                    device_slots[device]++;
+            }
         } else {
             if (s.running) {
                 Out(SYS_GEN | LOG_DEBUG) << "QM Stopping: " << s.torrent_name << endl;
@@ -604,9 +945,45 @@ void QueueManager::orderQueue()
             }
             tc->setQueued(true);
         }
+        return true;
+    };
+
+    // ranked seeds go in the order of their ranking, new seeds go after
+    // them in queue order until they are ranked at the next rotation
+    bool more = true;
+    for (int i = 0; more && i < ranking.count(); i++) {
+        bt::TorrentInterface *tc = ranking.at(i);
+        if (queueFor(tc) == &queue)
+            more = visit(tc);
     }
 
-    Q_EMIT queueOrdered();
+    for (int i = 0; more && i < queue.count(); i++) {
+        bt::TorrentInterface *tc = queue.at(i);
+        if (ranking.isEmpty() || !ranked_seeds.contains(tc))
+            more = visit(tc);
+    }
+
+    if (more || !changed)
+        return;
+
+    QList<bt::TorrentInterface *> rest;
+    for (bt::TorrentInterface *tc : running) {
+        if (visited.count(tc) == 0 && queueFor(tc) == &queue)
+            rest.append(tc);
+    }
+
+    for (bt::TorrentInterface *tc : *changed) {
+        if (visited.count(tc) == 0 && !tc->getStats().running && queueFor(tc) == &queue)
+            rest.append(tc);
+    }
+
+    for (bt::TorrentInterface *tc : qAsConst(rest)) {
+        if (tc->getStats().running) {
+            Out(SYS_GEN | LOG_DEBUG) << "QM Stopping: " << tc->getStats().torrent_name << endl;
+            stopSafely(tc);
+        }
+        tc->setQueued(true);
+    }
 }
 
 void QueueManager::torrentFinished(bt::TorrentInterface *tc)
@@ -618,22 +995,22 @@ void QueueManager::torrentFinished(bt::TorrentInterface *tc)
         stopSafely(tc);
     }
 
-    orderQueue();
+    requeue(tc);
 }
 
 void QueueManager::torrentAdded(bt::TorrentInterface *tc, bool start_torrent)
 {
     if (enabled()) {
-        // new torrents have the lowest priority
-        // so everybody else gets a higher priority
-        for (TorrentInterface *otc : qAsConst(downloads)) {
-            int p = otc->getPriority();
-            otc->setPriority(p + 1);
-        }
+        // new torrents have the lowest priority, so put it at the back of the queue
+        int idx = downloads.indexOf(tc);
+        if (idx < 0)
+            return;
+
+        downloads.removeAt(idx);
+        downloads.append(tc);
         tc->setAllowedToStart(start_torrent);
-        tc->setPriority(0);
-        rearrangeQueue();
-        orderQueue();
+        assignPriority(downloads.count() - 1);
+        requeue(tc);
     } else {
         if (start_torrent)
             start(tc);
@@ -643,16 +1020,14 @@ void QueueManager::torrentAdded(bt::TorrentInterface *tc, bool start_torrent)
 void QueueManager::torrentRemoved(bt::TorrentInterface *tc)
 {
     remove(tc);
-    rearrangeQueue();
-    orderQueue();
+    scheduleOrderQueue();
 }
 
 void QueueManager::torrentsRemoved(QList<bt::TorrentInterface *> &tors)
 {
     for (bt::TorrentInterface *tc : qAsConst(tors))
         remove(tc);
-    rearrangeQueue();
-    orderQueue();
+    scheduleOrderQueue();
 }
 
 void QueueManager::setSuspendedState(bool suspend)
@@ -671,6 +1046,7 @@ void QueueManager::setSuspendedState(bool suspend)
         }
 
         suspended_torrents.clear();
+        suspended_hashes.clear();
         orderQueue();
     } else {
         for (TorrentInterface *tc : qAsConst(downloads)) {
@@ -684,20 +1060,15 @@ void QueueManager::setSuspendedState(bool suspend)
     Q_EMIT suspendStateChanged(suspended_state);
 }
 
-void QueueManager::rearrangeQueue()
-{
-    downloads.sort();
-    reindexQueue();
-}
-
 void QueueManager::startSafely(bt::TorrentInterface *tc)
 {
     try {
         tc->start();
+        updateRunning(tc);
     } catch (bt::Error &err) {
         const TorrentStats &s = tc->getStats();
         QString msg = i18n("Error starting torrent %1: %2", s.torrent_name, err.toString());
-        KMessageBox::error(0, msg, i18n("Error"));
+        Q_EMIT error(msg);
     }
 }
 
@@ -705,16 +1076,17 @@ void QueueManager::stopSafely(bt::TorrentInterface *tc, WaitJob *wjob)
 {
     try {
         tc->stop(wjob);
+        updateRunning(tc);
     } catch (bt::Error &err) {
         const TorrentStats &s = tc->getStats();
         QString msg = i18n("Error stopping torrent %1: %2", s.torrent_name, err.toString());
-        KMessageBox::error(0, msg, i18n("Error"));
+        Q_EMIT error(msg);
     }
 }
 
-void QueueManager::torrentStopped(bt::TorrentInterface *)
+void QueueManager::torrentStopped(bt::TorrentInterface *tc)
 {
-    orderQueue();
+    requeue(tc);
 }
 
 static bool IsStalled(bt::TorrentInterface *tc, bt::TimeStamp now, bt::Uint32 min_stall_time)
@@ -728,42 +1100,86 @@ static bool IsStalled(bt::TorrentInterface *tc, bt::TimeStamp now, bt::Uint32 mi
     return stalled_time > min_stall_time * 60 && tc->getStats().running;
 }
 
+void QueueManager::scheduleStallCheck(bt::TorrentInterface *tc)
+{
+    if (stall_time == 0)
+        return;
+
+    // the torrent is stalled once there has been no activity for longer than the stall time
+    const TorrentStats &s = tc->getStats();
+    const bt::TimeStamp last_activity = s.completed ? s.last_upload_activity_time : s.last_download_activity_time;
+    stall_wheel.schedule(tc, last_activity + (stall_time * 60 + 1) * 1000);
+}
+
 void QueueManager::checkStalledTorrents(bt::TimeStamp now, bt::Uint32 min_stall_time)
 {
     if (!enabled())
         return;
 
-    QueuePtrList newlist;
-    QueuePtrList stalled;
-    bool can_decrease = false;
+    if (min_stall_time != stall_time) {
+        stall_time = min_stall_time;
+        stall_wheel.clear();
+        for (bt::TorrentInterface *tc : running)
+            scheduleStallCheck(tc);
+    }
+
+    // only look at the torrents whose deadline has passed
+    const QList<bt::TorrentInterface *> expired = stall_wheel.expire(now);
+    if (expired.isEmpty())
+        return;
+
+    std::set<bt::TorrentInterface *> stalled_set;
+    int max_prio = 0;
+    for (bt::TorrentInterface *tc : expired) {
+        if (running.count(tc) == 0)
+            continue;
 
-    // find all stalled ones
-    for (bt::TorrentInterface *tc : qAsConst(downloads)) {
         if (IsStalled(tc, now, min_stall_time)) {
-            stalled.append(tc);
+            if (stalled_set.empty() || tc->getPriority() > max_prio)
+                max_prio = tc->getPriority();
+            stalled_set.insert(tc);
+            // look at it again after another stall period
+            stall_wheel.schedule(tc, now + (min_stall_time * 60 + 1) * 1000);
         } else {
-            // decreasing makes only sense if there are QM torrents after the stalled ones
-            can_decrease = stalled.count() > 0;
-            newlist.append(tc);
+            // there has been activity since the deadline was set
+            scheduleStallCheck(tc);
         }
     }
 
-    if (stalled.count() == 0 || stalled.count() == downloads.count() || !can_decrease)
+    if (stalled_set.empty())
         return;
 
+    // decreasing makes only sense if there are QM torrents after the stalled ones,
+    // the queue is sorted on priority so look at the last torrent which is not stalled
+    bool can_decrease = false;
+    for (int i = downloads.count() - 1; i >= 0; i--) {
+        bt::TorrentInterface *tc = downloads.at(i);
+        if (stalled_set.count(tc) == 0 && !IsStalled(tc, now, min_stall_time)) {
+            can_decrease = tc->getPriority() < max_prio;
+            break;
+        }
+    }
+
+    if (!can_decrease)
+        return;
+
+    // keep the queue order of the stalled torrents when moving them to the back
+    QueuePtrList stalled;
+    for (bt::TorrentInterface *tc : stalled_set)
+        stalled.append(tc);
+    stalled.sort();
+
     for (bt::TorrentInterface *tc : qAsConst(stalled))
         Out(SYS_GEN | LOG_NOTICE) << "The torrent " << tc->getStats().torrent_name << " has stalled longer than " << min_stall_time
                                   << " minutes, decreasing its priority" << endl;
 
-    downloads.clear();
-    downloads += newlist;
-    downloads += stalled;
-    // redo priorities and then order the queue
-    int prio = downloads.count();
-    for (bt::TorrentInterface *tc : qAsConst(downloads)) {
-        tc->setPriority(prio--);
+    // move the stalled torrents to the back of the queue, this only changes their priorities
+    for (bt::TorrentInterface *tc : qAsConst(stalled)) {
+        downloads.removeOne(tc);
+        downloads.append(tc);
+        assignPriority(downloads.count() - 1);
+        requeue(tc);
     }
-    orderQueue();
 }
 
 void QueueManager::onOnlineStateChanged(bool isOnline)
@@ -772,12 +1188,11 @@ void QueueManager::onOnlineStateChanged(bool isOnline)
         Out(SYS_GEN | LOG_IMPORTANT) << "Network is up" << endl;
         // if the network has gone down, longer then 2 minutes
         // all the connections are probably stale, so tell all
-        // running torrents, that they need to reannounce and kill stale peers
+        // running torrents, that they need to reannounce and kill stale peers,
+        // spread out over time to avoid flooding trackers
         if (network_down_time.isValid() && network_down_time.secsTo(QDateTime::currentDateTime()) > 120) {
-            for (bt::TorrentInterface *tc : qAsConst(downloads)) {
-                if (tc->getStats().running)
-                    tc->networkUp();
-            }
+            const QList<bt::TorrentInterface *> torrents(running.begin(), running.end());
+            announce_scheduler.networkUp(torrents);
         }
 
         network_down_time = QDateTime();
@@ -789,11 +1204,166 @@ void QueueManager::onOnlineStateChanged(bool isOnline)
 
 void QueueManager::reindexQueue()
 {
-    int prio = downloads.count();
+    downloads.sort();
+    int prio = downloads.count() * PRIORITY_GAP;
     // make sure everybody has an unique priority
     for (bt::TorrentInterface *tc : qAsConst(downloads)) {
-        tc->setPriority(prio--);
+        changePriority(tc, prio);
+        prio -= PRIORITY_GAP;
+    }
+}
+
+void QueueManager::changePriority(bt::TorrentInterface *tc, int prio)
+{
+    if (tc->getPriority() != prio) {
+        // the queues are sorted on the old priority, so take it out first, it goes back in when the queue is ordered
+        if (!download_queue.removeSorted(tc))
+            seed_queue.removeSorted(tc);
+        tc->setPriority(prio);
+        dirty.insert(tc);
+    }
+}
+
+void QueueManager::assignPriority(int idx)
+{
+    const int count = downloads.count();
+    bt::TorrentInterface *tc = downloads[idx];
+    if (count == 1) {
+        changePriority(tc, 0);
+        return;
+    }
+
+    if (idx == 0) {
+        qint64 prio = (qint64)downloads[1]->getPriority() + PRIORITY_GAP;
+        if (prio <= INT_MAX) {
+            changePriority(tc, prio);
+            return;
+        }
+    } else if (idx == count - 1) {
+        qint64 prio = (qint64)downloads[idx - 1]->getPriority() - PRIORITY_GAP;
+        if (prio >= INT_MIN) {
+            changePriority(tc, prio);
+            return;
+        }
+    } else {
+        qint64 higher = downloads[idx - 1]->getPriority();
+        qint64 lower = downloads[idx + 1]->getPriority();
+        if (higher - lower >= 2) {
+            changePriority(tc, lower + (higher - lower) / 2);
+            return;
+        }
+    }
+
+    // no room left, so spread out the torrents around idx
+    respacePriorities(idx);
+}
+
+void QueueManager::respacePriorities(int idx)
+{
+    const int count = downloads.count();
+    int window = 1;
+    int first = idx;
+    int last = idx;
+    // keep doubling the window until there is enough room between the torrents right outside of it
+    while (first > 0 || last < count - 1) {
+        window *= 2;
+        first = qMax(0, idx - window);
+        last = qMin(count - 1, idx + window);
+
+        const qint64 n = last - first + 1;
+        qint64 higher = 0;
+        qint64 lower = 0;
+        if (first > 0 && last < count - 1) {
+            higher = downloads[first - 1]->getPriority();
+            lower = downloads[last + 1]->getPriority();
+        } else if (first > 0) {
+            higher = downloads[first - 1]->getPriority();
+            lower = qMax((qint64)INT_MIN, higher - (n + 1) * PRIORITY_GAP);
+        } else if (last < count - 1) {
+            lower = downloads[last + 1]->getPriority();
+            higher = qMin((qint64)INT_MAX, lower + (n + 1) * PRIORITY_GAP);
+        } else {
+            break;
+        }
+
+        const qint64 step = qMin((qint64)PRIORITY_GAP, (higher - lower) / (n + 1));
+        if (step >= MIN_PRIORITY_GAP) {
+            qint64 prio = higher;
+            for (int i = first; i <= last; i++) {
+                prio -= step;
+                changePriority(downloads[i], prio);
+            }
+            return;
+        }
     }
+
+    reindexQueue();
+}
+
+void QueueManager::moveAfter(bt::TorrentInterface *tc, bt::TorrentInterface *after)
+{
+    if (tc == after)
+        return;
+
+    int idx = downloads.indexOf(tc);
+    if (idx < 0)
+        return;
+
+    int new_idx = 0;
+    if (after) {
+        int pos = downloads.indexOf(after);
+        if (pos < 0 || pos + 1 == idx)
+            return;
+
+        new_idx = pos > idx ? pos : pos + 1;
+    } else if (idx == 0) {
+        return;
+    }
+
+    downloads.removeAt(idx);
+    downloads.insert(new_idx, tc);
+    assignPriority(new_idx);
+    requeue(tc);
+}
+
+int QueueManager::queuePriority(const bt::TorrentInterface *tc) const
+{
+    // downloads is sorted on priority, so only look at the torrents with the same priority
+    const int prio = tc->getPriority();
+    QueuePtrList::const_iterator i = std::lower_bound(downloads.cbegin(), downloads.cend(), prio, [](const bt::TorrentInterface *t, int p) {
+        return t->getPriority() > p;
+    });
+
+    while (i != downloads.cend() && (*i)->getPriority() == prio) {
+        if (*i == tc)
+            return downloads.count() - (i - downloads.cbegin());
+        i++;
+    }
+
+    // not found, the queue is probably not sorted yet
+    for (int idx = 0; idx < downloads.count(); idx++) {
+        if (downloads[idx] == tc)
+            return downloads.count() - idx;
+    }
+
+    return 0;
+}
+
+void QueueManager::setQueuePriority(bt::TorrentInterface *tc, int prio)
+{
+    int idx = downloads.indexOf(tc);
+    if (idx < 0)
+        return;
+
+    int target = qBound(0, downloads.count() - prio, downloads.count() - 1);
+    if (target == idx)
+        return;
+    else if (target == 0)
+        moveAfter(tc, 0);
+    else if (target < idx)
+        moveAfter(tc, downloads[target - 1]);
+    else
+        moveAfter(tc, downloads[target]);
 }
 
 void QueueManager::loadState(KSharedConfigPtr cfg)
@@ -802,9 +1372,10 @@ void QueueManager::loadState(KSharedConfigPtr cfg)
     suspended_state = g.readEntry("suspended", false);
 
     if (suspended_state) {
-        QStringList info_hash_list = g.readEntry("suspended_torrents", QStringList());
+        const QStringList info_hash_list = g.readEntry("suspended_torrents", QStringList());
+        suspended_hashes = QSet<QString>(info_hash_list.begin(), info_hash_list.end());
         for (bt::TorrentInterface *t : qAsConst(downloads)) {
-            if (info_hash_list.contains(t->getInfoHash().toString()))
+            if (suspended_hashes.remove(t->getInfoHash().toString()))
                 suspended_torrents.insert(t);
         }
     }
@@ -820,40 +1391,73 @@ void QueueManager::saveState(KSharedConfigPtr cfg)
         for (bt::TorrentInterface *t : qAsConst(suspended_torrents)) {
             info_hash_list << t->getInfoHash().toString();
         }
+        // keep the ones which were never loaded, when exiting before loading finished
+        for (const QString &hash : qAsConst(suspended_hashes))
+            info_hash_list << hash;
         g.writeEntry("suspended_torrents", info_hash_list);
     }
 }
 
-bool QueueManager::checkFileConflicts(TorrentInterface *tc, QStringList &conflicting) const
+void QueueManager::filesChanged(bt::TorrentInterface *tc)
+{
+    stale_files.insert(tc);
+}
+
+bool QueueManager::checkFileConflicts(TorrentInterface *tc, QStringList &conflicting)
 {
     conflicting.clear();
+    updateFileIndex();
+
+    std::set<bt::TorrentInterface *> found;
+    const QStringList files = filesOnDisk(tc);
+    for (const QString &file : files) {
+        QMultiHash<QString, bt::TorrentInterface *>::const_iterator i = file_index.constFind(file);
+        while (i != file_index.cend() && i.key() == file) {
+            bt::TorrentInterface *t = i.value();
+            if (t != tc && found.insert(t).second)
+                conflicting.append(t->getDisplayName());
+            i++;
+        }
+    }
 
-    // First get a set off all files of tc
-    QSet<QString> files;
+    return !conflicting.isEmpty();
+}
+
+QStringList QueueManager::filesOnDisk(bt::TorrentInterface *tc)
+{
+    QStringList files;
     if (tc->getStats().multi_file_torrent) {
         for (bt::Uint32 i = 0; i < tc->getNumFiles(); i++)
-            files.insert(tc->getTorrentFile(i).getPathOnDisk());
+            files.append(QDir::cleanPath(tc->getTorrentFile(i).getPathOnDisk()));
     } else
-        files.insert(tc->getStats().output_path);
+        files.append(QDir::cleanPath(tc->getStats().output_path));
 
-    for (bt::TorrentInterface *t : qAsConst(downloads)) {
-        if (t == tc)
-            continue;
+    return files;
+}
 
-        if (t->getStats().multi_file_torrent) {
-            for (bt::Uint32 i = 0; i < t->getNumFiles(); i++) {
-                if (files.contains(t->getTorrentFile(i).getPathOnDisk())) {
-                    conflicting.append(t->getDisplayName());
-                    break;
-                }
-            }
-        } else {
-            if (files.contains(t->getStats().output_path))
-                conflicting.append(t->getDisplayName());
-        }
-    }
+void QueueManager::indexFiles(bt::TorrentInterface *tc)
+{
+    const QStringList files = filesOnDisk(tc);
+    for (const QString &file : files)
+        file_index.insert(file, tc);
 
-    return !conflicting.isEmpty();
+    indexed_files.insert(tc, files);
+}
+
+void QueueManager::unindexFiles(bt::TorrentInterface *tc)
+{
+    const QStringList files = indexed_files.take(tc);
+    for (const QString &file : files)
+        file_index.remove(file, tc);
+}
+
+void QueueManager::updateFileIndex()
+{
+    for (bt::TorrentInterface *tc : stale_files) {
+        unindexFiles(tc);
+        indexFiles(tc);
+    }
+    stale_files.clear();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -872,6 +1476,24 @@ void QueuePtrList::sort()
     std::sort(begin(), end(), QueuePtrList::biggerThan);
 }
 
+void QueuePtrList::insertSorted(bt::TorrentInterface *tc)
+{
+    insert(std::upper_bound(begin(), end(), tc, QueuePtrList::biggerThan), tc);
+}
+
+bool QueuePtrList::removeSorted(bt::TorrentInterface *tc)
+{
+    iterator i = std::lower_bound(begin(), end(), tc, QueuePtrList::biggerThan);
+    while (i != end() && (*i)->getPriority() == tc->getPriority()) {
+        if (*i == tc) {
+            erase(i);
+            return true;
+        }
+        i++;
+    }
+    return false;
+}
+
 bool QueuePtrList::biggerThan(bt::TorrentInterface *tc1, bt::TorrentInterface *tc2)
 {
     return tc1->getPriority() > tc2->getPriority();
@@ -25,15 +25,24 @@
 #include <set>
 
 #include <KSharedConfig>
+#include <QHash>
 #include <QObject>
+#include <QSet>
+#include <QTimer>
 
 #include <interfaces/queuemanagerinterface.h>
 #include <interfaces/torrentinterface.h>
 #include <ktcore_export.h>
+#include <torrent/announcescheduler.h>
+#include <torrent/downloadslotcontroller.h>
+#include <torrent/scrapebatcher.h>
+#include <torrent/seedranker.h>
+#include <torrent/storagedevices.h>
+#include <torrent/timingwheel.h>
+#include <util/sha1hash.h>
 
 namespace bt
 {
-class SHA1Hash;
 struct TrackerTier;
 class WaitJob;
 }
@@ -51,6 +60,19 @@ public:
      */
     void sort();
 
+    /**
+     * Insert a torrent at the right place in a list which is already sorted.
+     * @param tc The torrent
+     */
+    void insertSorted(bt::TorrentInterface *tc);
+
+    /**
+     * Remove a torrent from a list which is sorted on the current priority of the torrent.
+     * @param tc The torrent
+     * @return true if the torrent was found and removed
+     */
+    bool removeSorted(bt::TorrentInterface *tc);
+
 protected:
     static bool biggerThan(bt::TorrentInterface *tc1, bt::TorrentInterface *tc2);
 };
@@ -78,13 +100,15 @@ public:
     void saveState(KSharedConfigPtr cfg);
 
     /**
-        Load the state of the QueueManager
+        Load the state of the QueueManager, torrents which are appended
+        afterwards are still matched against the suspended torrents.
         @param cfg The config
     */
     void loadState(KSharedConfigPtr cfg);
 
     /**
-     * Check if we need to decrease the priority of stalled torrents
+     * Check if we need to decrease the priority of stalled torrents.
+     * Only torrents whose stall deadline has passed are looked at.
      * @param min_stall_time Stall time in minutes
      * @param now The current time
      */
@@ -152,7 +176,23 @@ public:
     int getNumRunning(Flags flags = ALL);
 
     /**
-     * Start the next torrent.
+     * Get the torrents which are running. This is kept up to date using
+     * the status changes of the torrents, so it does not need a scan of all torrents.
+     */
+    const std::set<bt::TorrentInterface *> &runningTorrents() const
+    {
+        return running;
+    }
+
+    /**
+     * Update the running state of a torrent in the set of running torrents.
+     * @param tc The torrent
+     */
+    void updateRunning(bt::TorrentInterface *tc);
+
+    /**
+     * Start the next torrent. Like orderQueue, this only schedules a pass over the queue,
+     * nothing is started before the event loop is entered again.
      */
     void startNext();
 
@@ -192,6 +232,13 @@ public:
      */
     bool alreadyLoaded(const bt::SHA1Hash &ih) const override;
 
+    /**
+     * Find a torrent using its info hash.
+     * @param ih The info hash of the torrent
+     * @return The torrent or 0 if there is no torrent with this info hash
+     */
+    bt::TorrentInterface *find(const bt::SHA1Hash &ih) const;
+
     /**
      * Merge announce lists to a torrent
      * @param ih The info_hash of the torrent to merge to
@@ -209,6 +256,34 @@ public:
 
     bool permitStatsSync(bt::TorrentControl *tc) override;
 
+    /**
+     * Enable or disable the stats journal. When the stats are journaled, torrents
+     * no longer need to dump their stats periodically.
+     * @param on Whether or not the journal is used
+     */
+    void setStatsJournalEnabled(bool on)
+    {
+        stats_journal_enabled = on;
+    }
+
+    /**
+     * Get the AnnounceScheduler, manual announces should go through it,
+     * so that they are spread out and limited per tracker.
+     */
+    AnnounceScheduler *announceScheduler()
+    {
+        return &announce_scheduler;
+    }
+
+    /**
+     * Get the ScrapeBatcher, scrapes should go through it,
+     * so that torrents on the same tracker are scraped together.
+     */
+    ScrapeBatcher *scrapeBatcher()
+    {
+        return &scrape_batcher;
+    }
+
     /**
      * Set the maximum number of downloads
      * @param m Max downloads
@@ -221,6 +296,90 @@ public:
      */
     void setMaxSeeds(int m);
 
+    /**
+     * Enable or disable adaptive download slots. The number of downloads is then
+     * adjusted to the bandwidth usage, with the maximum number of downloads as upper bound.
+     * @param on Whether or not to adapt the number of download slots
+     */
+    void setAdaptiveDownloadSlots(bool on);
+
+    /**
+     * Feed the total download rate to the adaptive download slots, call this periodically.
+     * @param now The current time
+     * @param rate The total download rate in bytes per second
+     * @param cap The download cap in bytes per second, 0 if there is none
+     */
+    void updateDownloadSlots(bt::TimeStamp now, bt::Uint32 rate, bt::Uint32 cap);
+
+    /// Get the number of downloads which may run, 0 means no limit
+    int downloadSlots() const;
+
+    /**
+     * Enable or disable rotation of the seed slots. When enabled, the seed slots go to
+     * the seeds with the highest demand, instead of the ones with the highest priority.
+     * The ranking is redone at the start of each time slice.
+     * @param on Whether or not to rotate the seeds
+     * @param interval The length of a time slice in minutes
+     */
+    void setSeedRotation(bool on, bt::Uint32 interval);
+
+    /**
+     * Rotate the seed slots if the current time slice is over, call this periodically.
+     * @param now The current time
+     */
+    void rotateSeeds(bt::TimeStamp now);
+
+    /**
+     * Get the score of a seed in the last ranking.
+     * @param tc The torrent
+     * @return The score, 0 if the torrent was not ranked
+     */
+    double seedScore(const bt::TorrentInterface *tc) const
+    {
+        return seed_ranker.lastScore(tc);
+    }
+
+    /**
+     * Set the maximum number of downloads and data checks on the same storage device.
+     * When a device is full, torrents on other devices are started instead.
+     * @param m Max downloads per device (0 = no limit)
+     */
+    void setMaxDownloadsPerDevice(int m);
+
+    /**
+     * Get the storage device the data of a torrent is on.
+     * @param tc The torrent
+     * @return An identifier of the device, empty if it could not be determined
+     */
+    QString storageDevice(bt::TorrentInterface *tc);
+
+    /**
+     * Mark a torrent as waiting for a data check. Such torrents are not started
+     * until the check has begun.
+     * @param tc The torrent
+     * @param pending Whether a check is pending
+     */
+    void setDataCheckPending(bt::TorrentInterface *tc, bool pending);
+
+    /// Statistics of a storage device, used to tune the per device limits
+    struct DeviceStats {
+        QString device;
+        QString mount_point;
+        int downloads;
+        int seeds;
+        int data_checks;
+        bt::Uint32 download_rate;
+        bt::Uint32 upload_rate;
+        bt::Uint64 bytes_downloaded;
+        bt::Uint64 bytes_uploaded;
+    };
+
+    /**
+     * Get the statistics of all storage devices which have running torrents
+     * or data checks on them.
+     */
+    QList<DeviceStats> deviceStats();
+
     /**
      * Enable or disable keep seeding (after a torrent has finished)
      * @param ks Keep seeding
@@ -240,21 +399,67 @@ public:
     }
 
     /**
-     * Reindex the queue priorities.
+     * Reindex the queue priorities. Priorities are spaced apart, so
+     * that torrents can be moved around without touching the others.
      */
     void reindexQueue();
 
+    /**
+     * Move a torrent in the queue. Only the priority of the torrent is changed,
+     * unless there is no room left between its new neighbours, in which case
+     * the priorities of a few surrounding torrents are changed as well.
+     * @param tc The torrent
+     * @param after The torrent which should come right before tc, 0 moves tc to the front of the queue
+     */
+    void moveAfter(bt::TorrentInterface *tc, bt::TorrentInterface *after);
+
+    /**
+     * Get the priority of a torrent as shown to the user. This goes from N for
+     * the first torrent in the queue to 1 for the last one.
+     * @param tc The torrent
+     * @return The priority or 0 if the torrent is not in the queue
+     */
+    int queuePriority(const bt::TorrentInterface *tc) const;
+
+    /**
+     * Move a torrent in the queue using a priority as shown to the user.
+     * @param tc The torrent
+     * @param prio The priority (N is the front of the queue, 1 the back)
+     */
+    void setQueuePriority(bt::TorrentInterface *tc, int prio);
+
+    /**
+     * The files of a torrent were renamed or its output path was changed without
+     * moving the files, so they need to be indexed again. Moves are picked up by
+     * themselves once the jobs of the torrent are done.
+     * @param tc The torrent
+     */
+    void filesChanged(bt::TorrentInterface *tc);
+
+    /**
+     * Something which decides the queue of a torrent was changed outside of the queue manager,
+     * like its maximum share ratio, its maximum seed time or whether it is allowed to start.
+     * The torrent is put in the right queue during the next pass, the other torrents are not
+     * looked at again.
+     * @param tc The torrent
+     */
+    void requeue(bt::TorrentInterface *tc);
+
     /**
      * Check if a torrent has file conflicts with other torrents.
      * If conflicting are found, a list of names of the conflicting torrents is filled in.
+     * This uses an index of the files of all torrents, so only the files of tc need to be looked up.
      * @param tc The torrent
      * @param conflicting List of conflicting torrents
      */
-    bool checkFileConflicts(bt::TorrentInterface *tc, QStringList &conflicting) const;
+    bool checkFileConflicts(bt::TorrentInterface *tc, QStringList &conflicting);
 
     /**
      * Places all torrents from downloads in the right order in queue.
-     * Use this when torrent priorities get changed
+     * Use this when torrent priorities get changed. The actual reordering
+     * is done once the event loop is entered again, so multiple calls get
+     * merged into one pass. Callers must not expect any torrent to have been
+     * started or stopped when this returns, queueOrdered is emitted after the pass.
      */
     void orderQueue();
 
@@ -287,6 +492,23 @@ Q_SIGNALS:
      */
     void suspendStateChanged(bool suspended);
 
+    /**
+     * Emitted when starting or stopping a torrent failed, the frontend
+     * should show the message to the user (or log it when headless).
+     * @param msg The error message
+     */
+    void error(const QString &msg);
+
+    /**
+     * Emitted to ask whether torrents should be started anyway, when they are over their limits
+     * or there is not enough disk space. Must be connected directly, the frontend sets the answer.
+     * @param msg The question
+     * @param caption The caption, can be empty
+     * @param names Names of the torrents, empty when the question is about one torrent
+     * @param start Set to true to start the torrents anyway, it is false by default
+     */
+    void startAnywayQuestion(const QString &msg, const QString &caption, const QStringList &names, bool *start);
+
 public Q_SLOTS:
     void torrentFinished(bt::TorrentInterface *tc);
     void torrentAdded(bt::TorrentInterface *tc, bool start_torrent);
@@ -296,28 +518,77 @@ public Q_SLOTS:
     void onLowDiskSpace(bt::TorrentInterface *tc, bool toStop);
     void onOnlineStateChanged(bool);
 
+private Q_SLOTS:
+    void delayedOrderQueue();
+
 private:
+    void scheduleOrderQueue();
+    void scheduleStallCheck(bt::TorrentInterface *tc);
+    QueuePtrList *queueFor(bt::TorrentInterface *tc);
+    void startQueue(QueuePtrList &queue,
+                    const QList<bt::TorrentInterface *> &ranking,
+                    int max,
+                    int max_per_device,
+                    const std::set<bt::TorrentInterface *> *changed);
+    void scrapeIdleSeeds();
+    void indexFiles(bt::TorrentInterface *tc);
+    void unindexFiles(bt::TorrentInterface *tc);
+    void updateFileIndex();
+    static QStringList filesOnDisk(bt::TorrentInterface *tc);
     void startSafely(bt::TorrentInterface *tc);
     void stopSafely(bt::TorrentInterface *tc, bt::WaitJob *wjob = 0);
     void checkDiskSpace(QList<bt::TorrentInterface *> &todo);
     void checkMaxSeedTime(QList<bt::TorrentInterface *> &todo);
     void checkMaxRatio(QList<bt::TorrentInterface *> &todo);
-    void rearrangeQueue();
+    void changePriority(bt::TorrentInterface *tc, int prio);
+    void assignPriority(int idx);
+    void respacePriorities(int idx);
     bt::TorrentStartResponse startInternal(bt::TorrentInterface *tc);
     bool checkLimits(bt::TorrentInterface *tc, bool interactive);
     bool checkDiskSpace(bt::TorrentInterface *tc, bool interactive);
+    bool askStartAnyway(const QString &msg, const QString &caption, const QStringList &names);
 
 private:
     QueuePtrList downloads;
+    QHash<bt::SHA1Hash, bt::TorrentInterface *> torrent_index;
+    QueuePtrList download_queue;
+    QueuePtrList seed_queue;
+    std::set<bt::TorrentInterface *> dirty;
+    bool full_reorder;
+    QTimer order_timer;
+    QMultiHash<QString, bt::TorrentInterface *> file_index;
+    QHash<bt::TorrentInterface *, QStringList> indexed_files;
+    std::set<bt::TorrentInterface *> stale_files;
     std::set<bt::TorrentInterface *> suspended_torrents;
+    QSet<QString> suspended_hashes; // suspended torrents which have not been appended yet
+    std::set<bt::TorrentInterface *> running;
+    std::set<bt::TorrentInterface *> checking;
+    std::set<bt::TorrentInterface *> pending_checks;
+    StorageDevices storage_devices;
+    TimingWheel stall_wheel;
+    bt::Uint32 stall_time;
     int max_downloads;
     int max_seeds;
+    int max_downloads_per_device;
+    bool adaptive_slots;
+    DownloadSlotController slot_controller;
+    bool rotate_seeds;
+    bt::TimeStamp rotation_interval;
+    bt::TimeStamp last_rotation;
+    bt::TimeStamp last_seed_sample;
+    SeedRanker seed_ranker;
+    QList<bt::TorrentInterface *> seed_ranking;
+    QSet<bt::TorrentInterface *> ranked_seeds;
+    int scrape_cursor;
     bool suspended_state;
     bool keep_seeding;
     bool exiting;
     bool ordering;
     QDateTime network_down_time;
+    AnnounceScheduler announce_scheduler;
+    ScrapeBatcher scrape_batcher;
     bt::TimeStamp last_stats_sync_permitted;
+    bool stats_journal_enabled;
 };
 }
 #endif
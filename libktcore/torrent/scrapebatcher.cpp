@@ -0,0 +1,491 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scrapebatcher.h"
+
+#include <QRandomGenerator>
+#include <QScopedPointer>
+#include <QUdpSocket>
+
+#include <KIO/StoredTransferJob>
+
+#include <functional>
+
+#include <bcodec/bdecoder.h>
+#include <bcodec/bnode.h>
+#include <interfaces/torrentinterface.h>
+#include <interfaces/trackerinterface.h>
+#include <interfaces/trackerslist.h>
+#include <settings.h>
+#include <util/error.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+
+using namespace bt;
+
+namespace kt
+{
+// scrape requests are collected for this long before they are sent
+const int BATCH_DELAY = 2000;
+// keeps the URL of an HTTP scrape at a sane length
+const int MAX_HTTP_BATCH = 50;
+// the number of info hashes which fit in a UDP scrape packet
+const int MAX_UDP_BATCH = 74;
+// time after which a scrape is given up
+const int SCRAPE_TIMEOUT = 15 * 1000;
+// how long a tracker is left alone after a failed scrape, doubled on every failure
+const bt::TimeStamp MIN_BACKOFF = 60 * 1000;
+const bt::TimeStamp MAX_BACKOFF = 60 * 60 * 1000;
+// magic number of the UDP tracker protocol (BEP 15)
+const bt::Uint64 UDP_PROTOCOL_ID = 0x41727101980ULL;
+
+enum UDPAction {
+    UDP_CONNECT = 0,
+    UDP_SCRAPE = 2,
+    UDP_ERROR = 3,
+};
+
+/**
+ * Does a single scrape of a number of info hashes on an UDP tracker:
+ * a connect request followed by the scrape request.
+ */
+class UDPScrapeJob : public QObject
+{
+public:
+    typedef std::function<void(QObject *, const QHash<QByteArray, ScrapeBatcher::Result> &)> Callback;
+
+    UDPScrapeJob(const QUrl &tracker, const QList<QByteArray> &hashes, Callback cb, QObject *parent)
+        : QObject(parent)
+        , tracker(tracker)
+        , hashes(hashes)
+        , cb(cb)
+        , transaction_id(0)
+        , connection_id(0)
+        , done(false)
+    {
+        connect(&socket, &QUdpSocket::connected, this, &UDPScrapeJob::sendConnect);
+        connect(&socket, &QUdpSocket::readyRead, this, &UDPScrapeJob::readPackets);
+        timeout.setSingleShot(true);
+        connect(&timeout, &QTimer::timeout, this, [this]() {
+            Out(SYS_GEN | LOG_DEBUG) << "Scrape of " << this->tracker.toDisplayString() << " timed out" << endl;
+            finish(QHash<QByteArray, ScrapeBatcher::Result>());
+        });
+        timeout.start(SCRAPE_TIMEOUT);
+        socket.connectToHost(tracker.host(), tracker.port(80));
+    }
+
+private:
+    void sendConnect()
+    {
+        Uint8 buf[16];
+        transaction_id = QRandomGenerator::global()->generate();
+        WriteUint64(buf, 0, UDP_PROTOCOL_ID);
+        WriteUint32(buf, 8, UDP_CONNECT);
+        WriteUint32(buf, 12, transaction_id);
+        socket.write((const char *)buf, 16);
+    }
+
+    void sendScrape()
+    {
+        transaction_id = QRandomGenerator::global()->generate();
+        socket.write(ScrapeBatcher::udpScrapeRequest(connection_id, transaction_id, hashes));
+    }
+
+    void readPackets()
+    {
+        while (!done && socket.hasPendingDatagrams()) {
+            QByteArray packet(qMax<qint64>(socket.pendingDatagramSize(), 0), 0);
+            socket.readDatagram(packet.data(), packet.size());
+            if (packet.size() < 8)
+                continue;
+
+            const Uint8 *buf = (const Uint8 *)packet.constData();
+            if (ReadUint32(buf, 4) != transaction_id)
+                continue;
+
+            const Uint32 action = ReadUint32(buf, 0);
+            if (action == UDP_CONNECT && packet.size() >= 16) {
+                connection_id = ReadUint64(buf, 8);
+                sendScrape();
+            } else if (action == UDP_SCRAPE) {
+                finish(ScrapeBatcher::decodeUDPScrape(packet, hashes));
+            } else if (action == UDP_ERROR) {
+                Out(SYS_GEN | LOG_DEBUG) << "Scrape of " << tracker.toDisplayString() << " failed: " << QString::fromUtf8(packet.mid(8)) << endl;
+                finish(QHash<QByteArray, ScrapeBatcher::Result>());
+            }
+        }
+    }
+
+    void finish(const QHash<QByteArray, ScrapeBatcher::Result> &res)
+    {
+        if (done)
+            return;
+
+        done = true;
+        timeout.stop();
+        socket.close();
+        cb(this, res);
+        deleteLater();
+    }
+
+private:
+    QUrl tracker;
+    QList<QByteArray> hashes;
+    Callback cb;
+    QUdpSocket socket;
+    QTimer timeout;
+    Uint32 transaction_id;
+    Uint64 connection_id;
+    bool done;
+};
+
+ScrapeBatcher::ScrapeBatcher(QObject *parent)
+    : QObject(parent)
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &ScrapeBatcher::flush);
+}
+
+ScrapeBatcher::~ScrapeBatcher()
+{
+}
+
+void ScrapeBatcher::scrape(bt::TorrentInterface *tc)
+{
+    // the counts of the trackers of a running torrent are shown, a batched result would not show up
+    if (isRunning(tc)) {
+        scrapeItself(tc);
+        return;
+    }
+
+    const QUrl tracker = trackerOf(tc);
+    if (!tracker.isValid() || !scrapeURL(tracker).isValid() || needsProxy(tracker)) {
+        // nothing to batch, let the torrent scrape by itself
+        scrapeItself(tc);
+        return;
+    }
+
+    for (const QList<bt::TorrentInterface *> &batch : qAsConst(in_flight)) {
+        if (batch.contains(tc))
+            return;
+    }
+
+    QList<bt::TorrentInterface *> &batch = pending[tracker];
+    if (batch.contains(tc))
+        return;
+
+    batch.append(tc);
+    QHash<QUrl, Backoff>::const_iterator b = backoff.constFind(tracker);
+    const bt::TimeStamp now = bt::CurrentTime();
+    if (b != backoff.constEnd() && b->until > now)
+        scheduleFlush(qMax<bt::TimeStamp>(b->until - now, BATCH_DELAY));
+    else
+        scheduleFlush(BATCH_DELAY);
+}
+
+bool ScrapeBatcher::isRunning(bt::TorrentInterface *tc) const
+{
+    return tc->getStats().running;
+}
+
+void ScrapeBatcher::scrapeItself(bt::TorrentInterface *tc)
+{
+    tc->scrapeTracker();
+}
+
+void ScrapeBatcher::scheduleFlush(bt::TimeStamp delay)
+{
+    if (!timer.isActive() || timer.remainingTime() > (int)delay)
+        timer.start((int)delay);
+}
+
+bool ScrapeBatcher::result(const QUrl &tracker, const bt::TorrentInterface *tc, Result &r) const
+{
+    QHash<QUrl, QHash<QByteArray, Result>>::const_iterator i = results.constFind(tracker);
+    if (i == results.constEnd())
+        return false;
+
+    QHash<QByteArray, Result>::const_iterator j = i.value().constFind(infoHash(tc));
+    if (j == i.value().constEnd())
+        return false;
+
+    r = j.value();
+    return true;
+}
+
+bool ScrapeBatcher::result(bt::TorrentInterface *tc, Result &r) const
+{
+    const QUrl tracker = trackerOf(tc);
+    return tracker.isValid() && result(tracker, tc, r);
+}
+
+void ScrapeBatcher::remove(bt::TorrentInterface *tc)
+{
+    for (QList<bt::TorrentInterface *> &batch : pending)
+        batch.removeAll(tc);
+    for (QList<bt::TorrentInterface *> &batch : in_flight)
+        batch.removeAll(tc);
+
+    const QByteArray hash = infoHash(tc);
+    for (QHash<QByteArray, Result> &res : results)
+        res.remove(hash);
+}
+
+void ScrapeBatcher::clear()
+{
+    timer.stop();
+    pending.clear();
+    // running scrapes still finish, but there is nobody left to report to
+    for (QList<bt::TorrentInterface *> &batch : in_flight)
+        batch.clear();
+    results.clear();
+    backoff.clear();
+}
+
+QUrl ScrapeBatcher::scrapeURL(const QUrl &announce)
+{
+    // UDP trackers do announces and scrapes on the same address
+    if (announce.scheme() == QLatin1String("udp"))
+        return announce;
+
+    if (announce.scheme() != QLatin1String("http") && announce.scheme() != QLatin1String("https"))
+        return QUrl();
+
+    QString path = announce.path();
+    const int slash = path.lastIndexOf(QLatin1Char('/'));
+    if (slash < 0 || !path.mid(slash + 1).startsWith(QLatin1String("announce")))
+        return QUrl();
+
+    path.replace(slash + 1, 8, QStringLiteral("scrape"));
+    QUrl url(announce);
+    url.setPath(path);
+    return url;
+}
+
+QUrl ScrapeBatcher::httpScrapeURL(const QUrl &announce, const QList<QByteArray> &hashes)
+{
+    QUrl url = scrapeURL(announce);
+    if (!url.isValid())
+        return url;
+
+    QByteArray query = url.query(QUrl::FullyEncoded).toLatin1();
+    for (const QByteArray &hash : hashes) {
+        if (!query.isEmpty())
+            query += '&';
+        query += "info_hash=" + hash.toPercentEncoding();
+    }
+    url.setQuery(QString::fromLatin1(query), QUrl::StrictMode);
+    return url;
+}
+
+QHash<QByteArray, ScrapeBatcher::Result> ScrapeBatcher::decodeHTTPScrape(const QByteArray &data)
+{
+    QHash<QByteArray, Result> res;
+    BDecoder dec(data, false, 0);
+    QScopedPointer<BNode> n(dec.decode());
+    BDictNode *dict = n && n->getType() == BNode::DICT ? (BDictNode *)n.data() : nullptr;
+    if (!dict)
+        throw bt::Error(QStringLiteral("Scrape response is not a dictionary"));
+
+    BDictNode *files = dict->getDict(QByteArrayLiteral("files"));
+    if (!files)
+        return res;
+
+    const QList<QByteArray> keys = files->keys();
+    for (const QByteArray &hash : keys) {
+        BDictNode *d = files->getDict(hash);
+        if (!d || hash.size() != 20)
+            continue;
+
+        Result r;
+        r.seeders = d->getInt(QByteArrayLiteral("complete"));
+        r.leechers = d->getInt(QByteArrayLiteral("incomplete"));
+        r.completed = d->keys().contains("downloaded") ? d->getInt(QByteArrayLiteral("downloaded")) : -1;
+        r.time = 0;
+        res.insert(hash, r);
+    }
+    return res;
+}
+
+QByteArray ScrapeBatcher::udpScrapeRequest(bt::Uint64 connection_id, bt::Uint32 transaction_id, const QList<QByteArray> &hashes)
+{
+    QByteArray packet(16 + 20 * hashes.count(), 0);
+    Uint8 *buf = (Uint8 *)packet.data();
+    WriteUint64(buf, 0, connection_id);
+    WriteUint32(buf, 8, UDP_SCRAPE);
+    WriteUint32(buf, 12, transaction_id);
+    for (int i = 0; i < hashes.count(); i++)
+        memcpy(buf + 16 + 20 * i, hashes.at(i).constData(), 20);
+    return packet;
+}
+
+QHash<QByteArray, ScrapeBatcher::Result> ScrapeBatcher::decodeUDPScrape(const QByteArray &packet, const QList<QByteArray> &hashes)
+{
+    // seeders, completed and leechers for each info hash, in the order of the request
+    QHash<QByteArray, Result> res;
+    const Uint8 *buf = (const Uint8 *)packet.constData();
+    for (int i = 0; i < hashes.count() && 8 + 12 * (i + 1) <= packet.size(); i++) {
+        Result r;
+        r.seeders = ReadUint32(buf, 8 + 12 * i);
+        r.completed = ReadUint32(buf, 12 + 12 * i);
+        r.leechers = ReadUint32(buf, 16 + 12 * i);
+        r.time = 0;
+        res.insert(hashes.at(i), r);
+    }
+    return res;
+}
+
+void ScrapeBatcher::flush()
+{
+    const bt::TimeStamp now = bt::CurrentTime();
+    QHash<QUrl, QList<bt::TorrentInterface *>>::iterator i = pending.begin();
+    while (i != pending.end()) {
+        QHash<QUrl, Backoff>::const_iterator b = backoff.constFind(i.key());
+        if (b != backoff.constEnd() && b->until > now) {
+            // the tracker failed recently, the requests wait until it is tried again
+            scheduleFlush(b->until - now);
+            ++i;
+            continue;
+        }
+
+        const bool udp = i.key().scheme() == QLatin1String("udp");
+        const int max = udp ? MAX_UDP_BATCH : MAX_HTTP_BATCH;
+        const QList<bt::TorrentInterface *> &torrents = i.value();
+        for (int off = 0; off < torrents.count(); off += max) {
+            const QList<bt::TorrentInterface *> batch = torrents.mid(off, max);
+            if (udp)
+                udpScrape(i.key(), batch);
+            else
+                httpScrape(i.key(), batch);
+        }
+        i = pending.erase(i);
+    }
+}
+
+void ScrapeBatcher::httpScrape(const QUrl &tracker, const QList<bt::TorrentInterface *> &batch)
+{
+    QList<QByteArray> hashes;
+    for (bt::TorrentInterface *tc : batch)
+        hashes.append(infoHash(tc));
+
+    Out(SYS_GEN | LOG_DEBUG) << "Scraping " << batch.count() << " torrents on " << tracker.toDisplayString() << endl;
+    KIO::StoredTransferJob *j = KIO::storedGet(httpScrapeURL(tracker, hashes), KIO::Reload, KIO::HideProgressInfo);
+
+    // same settings as the announces done by libktorrent, so the scrapes go through the same proxy
+    KIO::MetaData md = j->metaData();
+    md[QStringLiteral("UserAgent")] = bt::GetVersionString();
+    md[QStringLiteral("SendLanguageSettings")] = QStringLiteral("false");
+    md[QStringLiteral("cookies")] = QStringLiteral("none");
+    md[QStringLiteral("errorPage")] = QStringLiteral("false");
+    if (!Settings::useKDEProxySettings() && Settings::useProxyForTracker()) {
+        QString p = QStringLiteral("%1:%2").arg(Settings::httpProxy()).arg(Settings::httpProxyPort());
+        if (!p.startsWith(QLatin1String("http://")))
+            p = QStringLiteral("http://") + p;
+
+        if (!QUrl(p).isValid() || Settings::httpProxy().trimmed().isEmpty())
+            p = QString();
+
+        md[QStringLiteral("UseProxy")] = p;
+        md[QStringLiteral("ProxyUrls")] = p;
+    }
+    j->setMetaData(md);
+
+    in_flight.insert(j, batch);
+    connect(j, &KJob::result, this, [this, tracker](KJob *j) {
+        httpFinished(j, tracker);
+    });
+    QTimer::singleShot(SCRAPE_TIMEOUT, j, [j]() {
+        j->kill(KJob::EmitResult);
+    });
+}
+
+void ScrapeBatcher::udpScrape(const QUrl &tracker, const QList<bt::TorrentInterface *> &batch)
+{
+    QList<QByteArray> hashes;
+    for (bt::TorrentInterface *tc : batch)
+        hashes.append(infoHash(tc));
+
+    Out(SYS_GEN | LOG_DEBUG) << "Scraping " << batch.count() << " torrents on " << tracker.toDisplayString() << endl;
+    UDPScrapeJob *job = new UDPScrapeJob(
+        tracker,
+        hashes,
+        [this, tracker](QObject *job, const QHash<QByteArray, Result> &res) {
+            finished(job, tracker, res);
+        },
+        this);
+    in_flight.insert(job, batch);
+}
+
+void ScrapeBatcher::httpFinished(KJob *j, const QUrl &tracker)
+{
+    QHash<QByteArray, Result> res;
+    if (j->error()) {
+        Out(SYS_GEN | LOG_DEBUG) << "Scrape of " << tracker.toDisplayString() << " failed: " << j->errorString() << endl;
+        finished(j, tracker, res);
+        return;
+    }
+
+    try {
+        res = decodeHTTPScrape(static_cast<KIO::StoredTransferJob *>(j)->data());
+    } catch (bt::Error &err) {
+        Out(SYS_GEN | LOG_DEBUG) << "Invalid scrape response from " << tracker.toDisplayString() << ": " << err.toString() << endl;
+    }
+
+    finished(j, tracker, res);
+}
+
+void ScrapeBatcher::finished(QObject *job, const QUrl &tracker, const QHash<QByteArray, Result> &res)
+{
+    const QList<bt::TorrentInterface *> batch = in_flight.take(job);
+    const bt::TimeStamp now = bt::CurrentTime();
+    if (res.isEmpty()) {
+        // Failed, timed out or the tracker cannot do multi scrapes. Scraping every torrent on its
+        // own would only hammer a tracker which is in trouble, so leave it alone for a while.
+        Backoff &b = backoff[tracker];
+        b.delay = b.delay == 0 ? MIN_BACKOFF : qMin(2 * b.delay, MAX_BACKOFF);
+        b.until = now + b.delay;
+        Out(SYS_GEN | LOG_DEBUG) << "Not scraping " << tracker.toDisplayString() << " for " << (b.delay / 1000) << " seconds" << endl;
+        return;
+    }
+
+    backoff.remove(tracker);
+    for (bt::TorrentInterface *tc : batch) {
+        // torrents the tracker does not know about are left out of the response
+        QHash<QByteArray, Result>::const_iterator i = res.constFind(infoHash(tc));
+        if (i == res.constEnd())
+            continue;
+
+        Result r = i.value();
+        r.time = now;
+        results[tracker].insert(i.key(), r);
+        Q_EMIT scraped(tc);
+    }
+}
+
+bool ScrapeBatcher::needsProxy(const QUrl &tracker)
+{
+    // HTTP scrapes use the proxy of the announces, but UDP packets cannot go through it
+    if (tracker.scheme() != QLatin1String("udp"))
+        return false;
+
+    const bool http_proxy = !Settings::useKDEProxySettings() && Settings::useProxyForTracker() && !Settings::httpProxy().trimmed().isEmpty();
+    return http_proxy || Settings::socksEnabled();
+}
+
+QUrl ScrapeBatcher::trackerOf(bt::TorrentInterface *tc)
+{
+    bt::TrackersList *tlist = tc->getTrackersList();
+    bt::TrackerInterface *tracker = tlist ? tlist->getCurrentTracker() : nullptr;
+    return tracker ? tracker->trackerURL() : QUrl();
+}
+
+QByteArray ScrapeBatcher::infoHash(const bt::TorrentInterface *tc)
+{
+    const bt::SHA1Hash &hash = tc->getInfoHash();
+    return QByteArray((const char *)hash.getData(), 20);
+}
+}
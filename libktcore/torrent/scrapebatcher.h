@@ -0,0 +1,159 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_SCRAPEBATCHER_H
+#define KT_SCRAPEBATCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+class KJob;
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+/**
+ * Scrapes torrents in batches. Scrape requests for torrents which share a tracker
+ * are collected for a short while and then sent as one multi info hash scrape
+ * (HTTP and UDP trackers both support this). The results are kept per tracker
+ * and info hash.
+ *
+ * HTTP scrapes use the same proxy as the announces of libktorrent. UDP trackers
+ * are not batched when a proxy is configured, those torrents do a normal scrape.
+ * When a batch fails, the tracker is left alone for a while, scrape requests made
+ * in the meantime are sent when that time is over.
+ *
+ * Running torrents are not batched. Their trackers keep the counts which are shown
+ * for them, so they scrape by themselves.
+ */
+class KTCORE_EXPORT ScrapeBatcher : public QObject
+{
+    Q_OBJECT
+public:
+    ScrapeBatcher(QObject *parent = nullptr);
+    ~ScrapeBatcher() override;
+
+    /// Scrape result of one torrent on one tracker
+    struct Result {
+        int seeders;
+        int leechers;
+        int completed;
+        bt::TimeStamp time;
+    };
+
+    /**
+     * Scrape a torrent, the scrape is sent together with the other
+     * torrents on the same tracker. A running torrent scrapes by itself.
+     * @param tc The torrent
+     */
+    void scrape(bt::TorrentInterface *tc);
+
+    /**
+     * Get the last scrape result of a torrent on a tracker.
+     * @param tracker URL of the tracker
+     * @param tc The torrent
+     * @param r Will be filled in with the result
+     * @return true if there is a result
+     */
+    bool result(const QUrl &tracker, const bt::TorrentInterface *tc, Result &r) const;
+
+    /// Get the last scrape result of a torrent on its current tracker
+    bool result(bt::TorrentInterface *tc, Result &r) const;
+
+    /// Forget about a torrent, call this before it is removed
+    void remove(bt::TorrentInterface *tc);
+
+    /// Forget about all torrents
+    void clear();
+
+    /**
+     * Convert an announce URL to a scrape URL, following the convention
+     * that the last path component starts with announce.
+     * @param announce The announce URL
+     * @return The scrape URL, invalid if the tracker does not support scraping
+     */
+    static QUrl scrapeURL(const QUrl &announce);
+
+    /**
+     * Build the URL of an HTTP scrape of a number of torrents.
+     * @param announce The announce URL
+     * @param hashes The info hashes
+     * @return The URL, invalid if the tracker does not support scraping
+     */
+    static QUrl httpScrapeURL(const QUrl &announce, const QList<QByteArray> &hashes);
+
+    /**
+     * Decode the response to an HTTP scrape.
+     * @param data The response
+     * @return The results per info hash
+     * @throw bt::Error if the response is not valid
+     */
+    static QHash<QByteArray, Result> decodeHTTPScrape(const QByteArray &data);
+
+    /**
+     * Build a UDP scrape request (BEP 15).
+     * @param connection_id Connection ID obtained with the connect request
+     * @param transaction_id Transaction ID of the request
+     * @param hashes The info hashes
+     * @return The packet
+     */
+    static QByteArray udpScrapeRequest(bt::Uint64 connection_id, bt::Uint32 transaction_id, const QList<QByteArray> &hashes);
+
+    /**
+     * Decode the response to a UDP scrape request.
+     * @param packet The response, it should have been checked to be a scrape response to the request
+     * @param hashes The info hashes of the request, the results are in the same order
+     * @return The results per info hash
+     */
+    static QHash<QByteArray, Result> decodeUDPScrape(const QByteArray &packet, const QList<QByteArray> &hashes);
+
+Q_SIGNALS:
+    /// Emitted when a scrape result for a torrent has arrived
+    void scraped(bt::TorrentInterface *tc);
+
+protected:
+    /// Whether a torrent is running
+    virtual bool isRunning(bt::TorrentInterface *tc) const;
+
+    /// Let a torrent scrape its trackers by itself
+    virtual void scrapeItself(bt::TorrentInterface *tc);
+
+private:
+    struct Backoff {
+        bt::TimeStamp until;
+        bt::TimeStamp delay;
+    };
+
+    void flush();
+    void scheduleFlush(bt::TimeStamp delay);
+    void httpScrape(const QUrl &tracker, const QList<bt::TorrentInterface *> &batch);
+    void udpScrape(const QUrl &tracker, const QList<bt::TorrentInterface *> &batch);
+    void httpFinished(KJob *job, const QUrl &tracker);
+    void finished(QObject *job, const QUrl &tracker, const QHash<QByteArray, Result> &res);
+    static bool needsProxy(const QUrl &tracker);
+    static QUrl trackerOf(bt::TorrentInterface *tc);
+    static QByteArray infoHash(const bt::TorrentInterface *tc);
+
+private:
+    QHash<QUrl, QList<bt::TorrentInterface *>> pending;
+    QHash<QObject *, QList<bt::TorrentInterface *>> in_flight;
+    QHash<QUrl, QHash<QByteArray, Result>> results;
+    QHash<QUrl, Backoff> backoff;
+    QTimer timer;
+};
+}
+
+#endif
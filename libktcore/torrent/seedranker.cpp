@@ -0,0 +1,130 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "seedranker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QPair>
+
+#include <interfaces/torrentinterface.h>
+#include <torrent/scrapebatcher.h>
+
+namespace kt
+{
+// weight of a new sample in the average upload rate
+const double UPLOAD_SMOOTHING = 0.1;
+// a torrent which was not seeded for this many hours has its demand doubled
+const double AGING_HOURS = 6.0;
+// the aging bonus does not grow beyond this
+const double MAX_IDLE_HOURS = 24.0;
+
+SeedRanker::SeedRanker()
+    : scrapes(nullptr)
+{
+}
+
+SeedRanker::~SeedRanker()
+{
+}
+
+void SeedRanker::sample(bt::TorrentInterface *tc, bt::TimeStamp now)
+{
+    const double rate = tc->getStats().upload_rate;
+    QHash<const bt::TorrentInterface *, Record>::iterator i = records.find(tc);
+    if (i == records.end()) {
+        Record r;
+        r.avg_upload = rate;
+        r.last_sample = now;
+        r.last_seeded = now;
+        records.insert(tc, r);
+    } else {
+        Record &r = i.value();
+        r.avg_upload += UPLOAD_SMOOTHING * (rate - r.avg_upload);
+        r.last_sample = now;
+        r.last_seeded = now;
+    }
+}
+
+void SeedRanker::stopped(bt::TorrentInterface *tc, bt::TimeStamp now)
+{
+    QHash<const bt::TorrentInterface *, Record>::iterator i = records.find(tc);
+    if (i == records.end()) {
+        Record r;
+        r.avg_upload = 0.0;
+        r.last_sample = 0;
+        r.last_seeded = now;
+        records.insert(tc, r);
+    } else {
+        i.value().last_seeded = now;
+    }
+}
+
+void SeedRanker::remove(bt::TorrentInterface *tc)
+{
+    records.remove(tc);
+    scores.remove(tc);
+}
+
+void SeedRanker::clear()
+{
+    records.clear();
+    scores.clear();
+}
+
+double SeedRanker::score(bt::TorrentInterface *tc, bt::TimeStamp now) const
+{
+    // the limits of the user always win
+    if (tc->overMaxRatio() || tc->overMaxSeedTime())
+        return -1.0;
+
+    const bt::TorrentStats &s = tc->getStats();
+    double seeders = s.seeders_total;
+    double leechers = s.leechers_total;
+    ScrapeBatcher::Result r;
+    if (!s.running && scrapes && scrapes->result(tc, r)) {
+        seeders = r.seeders;
+        leechers = r.leechers;
+    }
+    const double demand = (leechers + 1.0) / (seeders + 1.0);
+
+    double upload_kib = 0.0;
+    double idle_hours = MAX_IDLE_HOURS;
+    QHash<const bt::TorrentInterface *, Record>::const_iterator i = records.constFind(tc);
+    if (i != records.constEnd()) {
+        upload_kib = i.value().avg_upload / 1024.0;
+        idle_hours = s.running ? 0.0 : std::min(MAX_IDLE_HOURS, (now - i.value().last_seeded) / (3600.0 * 1000.0));
+    }
+
+    // torrents which were not seeded for a while get their turn,
+    // a high upload rate shows our upload is actually used
+    return demand * (1.0 + idle_hours / AGING_HOURS) + std::log2(1.0 + upload_kib);
+}
+
+QList<bt::TorrentInterface *> SeedRanker::rank(const QList<bt::TorrentInterface *> &seeds, bt::TimeStamp now)
+{
+    scores.clear();
+    QList<QPair<double, bt::TorrentInterface *>> ranking;
+    ranking.reserve(seeds.count());
+    for (bt::TorrentInterface *tc : seeds) {
+        const double sc = score(tc, now);
+        scores.insert(tc, sc);
+        ranking.append(qMakePair(sc, tc));
+    }
+
+    // stable, so torrents with the same score stay in queue order
+    std::stable_sort(ranking.begin(), ranking.end(), [](const QPair<double, bt::TorrentInterface *> &a, const QPair<double, bt::TorrentInterface *> &b) {
+        return a.first > b.first;
+    });
+
+    QList<bt::TorrentInterface *> ret;
+    ret.reserve(ranking.count());
+    for (const QPair<double, bt::TorrentInterface *> &p : qAsConst(ranking))
+        ret.append(p.second);
+    return ret;
+}
+}
@@ -0,0 +1,105 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_SEEDRANKER_H
+#define KT_SEEDRANKER_H
+
+#include <QHash>
+#include <QList>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+class ScrapeBatcher;
+
+/**
+ * Ranks completed torrents by how much their swarm needs us. The score of a torrent
+ * is based on the ratio of leechers to seeders (as reported by scrapes), the recent
+ * upload rate of the torrent and the time since it was last seeded, so that torrents
+ * which were not seeded for a while get their turn. Torrents which reached their
+ * maximum share ratio or seed time get a negative score.
+ */
+class KTCORE_EXPORT SeedRanker
+{
+public:
+    SeedRanker();
+    ~SeedRanker();
+
+    /**
+     * Use the results of batched scrapes for torrents which are not running,
+     * their own statistics are only updated while they run.
+     * @param b The ScrapeBatcher
+     */
+    void setScrapeResults(const ScrapeBatcher *b)
+    {
+        scrapes = b;
+    }
+
+    /**
+     * Update the average upload rate of a running seed.
+     * @param tc The torrent
+     * @param now The current time
+     */
+    void sample(bt::TorrentInterface *tc, bt::TimeStamp now);
+
+    /**
+     * A torrent stopped seeding.
+     * @param tc The torrent
+     * @param now The current time
+     */
+    void stopped(bt::TorrentInterface *tc, bt::TimeStamp now);
+
+    /// Forget about a torrent
+    void remove(bt::TorrentInterface *tc);
+
+    /// Forget about all torrents
+    void clear();
+
+    /**
+     * Calculate the score of a torrent, the higher the score, the more the torrent should be seeded.
+     * @param tc The torrent
+     * @param now The current time
+     */
+    double score(bt::TorrentInterface *tc, bt::TimeStamp now) const;
+
+    /**
+     * Rank a list of seeds.
+     * @param seeds The seeds
+     * @param now The current time
+     * @return The seeds sorted on descending score
+     */
+    QList<bt::TorrentInterface *> rank(const QList<bt::TorrentInterface *> &seeds, bt::TimeStamp now);
+
+    /**
+     * Get the score a torrent had during the last ranking.
+     * @return The score, or 0 if the torrent was not ranked
+     */
+    double lastScore(const bt::TorrentInterface *tc) const
+    {
+        return scores.value(tc, 0.0);
+    }
+
+private:
+    struct Record {
+        double avg_upload;
+        bt::TimeStamp last_sample;
+        bt::TimeStamp last_seeded;
+    };
+
+    QHash<const bt::TorrentInterface *, Record> records;
+    QHash<const bt::TorrentInterface *, double> scores;
+    const ScrapeBatcher *scrapes;
+};
+}
+
+#endif
@@ -0,0 +1,236 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "statsaggregator.h"
+
+#include <groups/group.h>
+#include <groups/groupmanager.h>
+#include <interfaces/torrentinterface.h>
+#include <interfaces/trackerinterface.h>
+#include <interfaces/trackerslist.h>
+
+using namespace bt;
+
+namespace kt
+{
+static CurrentStats NoStats()
+{
+    CurrentStats ret;
+    ret.download_speed = ret.upload_speed = 0;
+    ret.bytes_downloaded = ret.bytes_uploaded = 0;
+    return ret;
+}
+
+StatsAggregator::StatsAggregator(GroupManager *gman)
+    : gman(gman)
+    , total(NoStats())
+{
+}
+
+StatsAggregator::~StatsAggregator()
+{
+}
+
+CurrentStats StatsAggregator::statsOf(bt::TorrentInterface *tc) const
+{
+    const TorrentStats &s = tc->getStats();
+    CurrentStats ret;
+    ret.download_speed = s.download_rate;
+    ret.upload_speed = s.upload_rate;
+    ret.bytes_downloaded = s.session_bytes_downloaded;
+    ret.bytes_uploaded = s.session_bytes_uploaded;
+    return ret;
+}
+
+void StatsAggregator::add(CurrentStats &target, const CurrentStats &s)
+{
+    target.download_speed += s.download_speed;
+    target.upload_speed += s.upload_speed;
+    target.bytes_downloaded += s.bytes_downloaded;
+    target.bytes_uploaded += s.bytes_uploaded;
+}
+
+void StatsAggregator::subtract(CurrentStats &target, const CurrentStats &s)
+{
+    target.download_speed -= s.download_speed;
+    target.upload_speed -= s.upload_speed;
+    target.bytes_downloaded -= s.bytes_downloaded;
+    target.bytes_uploaded -= s.bytes_uploaded;
+}
+
+CurrentStats StatsAggregator::speedsOf(const CurrentStats &s)
+{
+    CurrentStats ret = NoStats();
+    ret.download_speed = s.download_speed;
+    ret.upload_speed = s.upload_speed;
+    return ret;
+}
+
+void StatsAggregator::addToBuckets(const Contribution &c)
+{
+    for (const QString &path : c.groups) {
+        QHash<QString, CurrentStats>::iterator i = group_totals.find(path);
+        if (i == group_totals.end())
+            i = group_totals.insert(path, NoStats());
+        add(i.value(), c.stats);
+    }
+
+    if (!c.tracker_host.isEmpty()) {
+        QHash<QString, CurrentStats>::iterator i = tracker_totals.find(c.tracker_host);
+        if (i == tracker_totals.end())
+            i = tracker_totals.insert(c.tracker_host, NoStats());
+        add(i.value(), c.stats);
+    }
+}
+
+void StatsAggregator::removeFromBuckets(const Contribution &c)
+{
+    for (const QString &path : c.groups) {
+        QHash<QString, CurrentStats>::iterator i = group_totals.find(path);
+        if (i != group_totals.end())
+            subtract(i.value(), c.stats);
+    }
+
+    if (!c.tracker_host.isEmpty()) {
+        QHash<QString, CurrentStats>::iterator i = tracker_totals.find(c.tracker_host);
+        if (i != tracker_totals.end())
+            subtract(i.value(), c.stats);
+    }
+}
+
+void StatsAggregator::updateTracker(bt::TorrentInterface *tc, Contribution &c)
+{
+    TrackersList *tlist = tc->getTrackersList();
+    TrackerInterface *tracker = tlist ? tlist->getCurrentTracker() : nullptr;
+    if (tracker == c.tracker)
+        return;
+
+    c.tracker = tracker;
+    c.tracker_host = tracker ? tracker->trackerURL().host() : QString();
+}
+
+void StatsAggregator::add(bt::TorrentInterface *tc)
+{
+    if (torrents.contains(tc))
+        return;
+
+    Contribution c;
+    c.stats = statsOf(tc);
+    c.tracker = nullptr;
+    updateTracker(tc, c);
+    for (GroupManager::CItr i = gman->begin(); i != gman->end(); i++) {
+        if (i->second->isMember(tc))
+            c.groups << i->second->groupPath();
+    }
+
+    add(total, c.stats);
+    addToBuckets(c);
+    torrents.insert(tc, c);
+}
+
+void StatsAggregator::remove(bt::TorrentInterface *tc)
+{
+    QHash<bt::TorrentInterface *, Contribution>::iterator i = torrents.find(tc);
+    if (i == torrents.end())
+        return;
+
+    // The bytes transferred in this session stay part of all totals, only the speeds go.
+    // Moving a torrent between groups or trackers still moves its whole contribution.
+    Contribution c = i.value();
+    c.stats = speedsOf(c.stats);
+    subtract(total, c.stats);
+    removeFromBuckets(c);
+    torrents.erase(i);
+}
+
+void StatsAggregator::update(bt::TorrentInterface *tc)
+{
+    QHash<bt::TorrentInterface *, Contribution>::iterator i = torrents.find(tc);
+    if (i == torrents.end())
+        return;
+
+    Contribution &c = i.value();
+    const QString old_host = c.tracker_host;
+    updateTracker(tc, c);
+    const CurrentStats s = statsOf(tc);
+    if (old_host != c.tracker_host) {
+        // the torrent moved to another tracker, so move its contribution along
+        if (!old_host.isEmpty())
+            subtract(tracker_totals[old_host], c.stats);
+        if (!c.tracker_host.isEmpty()) {
+            QHash<QString, CurrentStats>::iterator t = tracker_totals.find(c.tracker_host);
+            if (t == tracker_totals.end())
+                t = tracker_totals.insert(c.tracker_host, NoStats());
+            add(t.value(), c.stats);
+        }
+    }
+
+    // apply the difference between the new and the old stats, unsigned wrap around takes care of decreases
+    CurrentStats delta;
+    delta.download_speed = s.download_speed - c.stats.download_speed;
+    delta.upload_speed = s.upload_speed - c.stats.upload_speed;
+    delta.bytes_downloaded = s.bytes_downloaded - c.stats.bytes_downloaded;
+    delta.bytes_uploaded = s.bytes_uploaded - c.stats.bytes_uploaded;
+    c.stats = s;
+
+    add(total, delta);
+    Contribution d = c;
+    d.stats = delta;
+    addToBuckets(d);
+}
+
+void StatsAggregator::updateGroups(bt::TorrentInterface *tc)
+{
+    QHash<bt::TorrentInterface *, Contribution>::iterator i = torrents.find(tc);
+    if (i == torrents.end())
+        return;
+
+    QStringList groups;
+    for (GroupManager::CItr g = gman->begin(); g != gman->end(); g++) {
+        if (g->second->isMember(tc))
+            groups << g->second->groupPath();
+    }
+
+    Contribution &c = i.value();
+    if (groups == c.groups)
+        return;
+
+    removeFromBuckets(c);
+    c.groups = groups;
+    addToBuckets(c);
+}
+
+void StatsAggregator::updateGroups()
+{
+    for (QHash<bt::TorrentInterface *, Contribution>::iterator i = torrents.begin(); i != torrents.end(); i++)
+        updateGroups(i.key());
+
+    // forget about groups which no longer exist
+    QHash<QString, CurrentStats>::iterator i = group_totals.begin();
+    while (i != group_totals.end()) {
+        if (!gman->findByPath(i.key()))
+            i = group_totals.erase(i);
+        else
+            i++;
+    }
+}
+
+CurrentStats StatsAggregator::groupTotals(const QString &path) const
+{
+    return group_totals.value(path, NoStats());
+}
+
+CurrentStats StatsAggregator::trackerTotals(const QString &host) const
+{
+    return tracker_totals.value(host, NoStats());
+}
+
+QStringList StatsAggregator::trackers() const
+{
+    return tracker_totals.keys();
+}
+
+}
@@ -0,0 +1,106 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_STATSAGGREGATOR_H
+#define KT_STATSAGGREGATOR_H
+
+#include <QHash>
+#include <QStringList>
+
+#include <interfaces/coreinterface.h>
+#include <ktcore_export.h>
+
+namespace bt
+{
+class TorrentInterface;
+class TrackerInterface;
+}
+
+namespace kt
+{
+class GroupManager;
+
+/**
+ * Keeps the global transfer statistics up to date by applying the changes of
+ * a torrent each time it is updated. Totals per group and per tracker are
+ * maintained the same way, so none of them need a pass over all torrents.
+ */
+class KTCORE_EXPORT StatsAggregator
+{
+public:
+    StatsAggregator(GroupManager *gman);
+    virtual ~StatsAggregator();
+
+    /// Start keeping track of a torrent
+    void add(bt::TorrentInterface *tc);
+
+    /**
+     * Stop keeping track of a torrent. The bytes the torrent transferred in this
+     * session remain part of the global, group and tracker totals, its speeds
+     * are taken out of all of them.
+     */
+    void remove(bt::TorrentInterface *tc);
+
+    /// Apply the changes in the stats of a torrent
+    void update(bt::TorrentInterface *tc);
+
+    /// Update the groups a torrent is a member of
+    void updateGroups(bt::TorrentInterface *tc);
+
+    /// Update the groups of all torrents, call this when groups have changed
+    void updateGroups();
+
+    /// Get the global totals
+    const CurrentStats &totals() const
+    {
+        return total;
+    }
+
+    /**
+     * Get the totals of a group.
+     * @param path Path of the group
+     */
+    CurrentStats groupTotals(const QString &path) const;
+
+    /**
+     * Get the totals of a tracker.
+     * @param host Host of the tracker
+     */
+    CurrentStats trackerTotals(const QString &host) const;
+
+    /// Get the hosts of all trackers which are in use
+    QStringList trackers() const;
+
+protected:
+    /// Get the current stats of a torrent
+    virtual CurrentStats statsOf(bt::TorrentInterface *tc) const;
+
+private:
+    struct Contribution {
+        CurrentStats stats;
+        QStringList groups;
+        bt::TrackerInterface *tracker;
+        QString tracker_host;
+    };
+
+    static void add(CurrentStats &target, const CurrentStats &s);
+    static void subtract(CurrentStats &target, const CurrentStats &s);
+    static CurrentStats speedsOf(const CurrentStats &s);
+    void addToBuckets(const Contribution &c);
+    void removeFromBuckets(const Contribution &c);
+    void updateTracker(bt::TorrentInterface *tc, Contribution &c);
+
+private:
+    GroupManager *gman;
+    CurrentStats total;
+    QHash<bt::TorrentInterface *, Contribution> torrents;
+    QHash<QString, CurrentStats> group_totals;
+    QHash<QString, CurrentStats> tracker_totals;
+};
+
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "statsjournal.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <interfaces/torrentinterface.h>
+#include <util/log.h>
+
+using namespace bt;
+
+namespace kt
+{
+// Interval between flushes of the journal in milliseconds
+const unsigned long JOURNAL_FLUSH_INTERVAL = 30 * 1000;
+
+static QByteArray RecordLine(const StatsJournal::Record &r)
+{
+    return r.dir.toUtf8() + ' ' + r.info_hash.toLatin1() + ' ' + QByteArray::number(r.uploaded) + ' ' + QByteArray::number(r.running_time_dl) + ' '
+        + QByteArray::number(r.running_time_ul) + '\n';
+}
+
+StatsJournal::StatsJournal(const QString &file)
+    : file(file)
+    , flush_requested(false)
+    , stop_requested(false)
+    , num_lines(0)
+{
+}
+
+StatsJournal::~StatsJournal()
+{
+    if (isRunning())
+        stop();
+}
+
+StatsJournal::Record StatsJournal::snapshot(bt::TorrentInterface *tc)
+{
+    Record r;
+    r.dir = QDir(tc->getTorDir()).dirName();
+    r.info_hash = tc->getInfoHash().toString();
+    r.uploaded = tc->getStats().bytes_uploaded;
+    r.running_time_dl = tc->getRunningTimeDL();
+    r.running_time_ul = tc->getRunningTimeUL();
+    return r;
+}
+
+void StatsJournal::post(const QList<Record> &records)
+{
+    QMutexLocker lock(&mutex);
+    for (const Record &r : records)
+        pending.insert(r.dir, r);
+}
+
+void StatsJournal::removeTorrent(const QString &dir)
+{
+    QMutexLocker lock(&mutex);
+    pending.remove(dir);
+    removed.append(dir);
+}
+
+void StatsJournal::flush()
+{
+    QMutexLocker lock(&mutex);
+    flush_requested = true;
+    wake.wakeOne();
+}
+
+void StatsJournal::stop()
+{
+    {
+        QMutexLocker lock(&mutex);
+        stop_requested = true;
+        wake.wakeOne();
+    }
+    wait();
+}
+
+void StatsJournal::run()
+{
+    latest = load(file);
+    // start with a compact journal
+    compact();
+
+    bool done = false;
+    while (!done) {
+        QList<Record> records;
+        QList<QString> rm;
+        {
+            QMutexLocker lock(&mutex);
+            if (!flush_requested && !stop_requested)
+                wake.wait(&mutex, JOURNAL_FLUSH_INTERVAL);
+
+            done = stop_requested;
+            flush_requested = false;
+            records = pending.values();
+            pending.clear();
+            rm.swap(removed);
+        }
+
+        if (!rm.isEmpty()) {
+            // the records of this cycle go into the compacted journal too
+            for (const Record &r : qAsConst(records))
+                latest.insert(r.dir, r);
+            for (const QString &dir : qAsConst(rm))
+                latest.remove(dir);
+            compact();
+        } else if (!records.isEmpty()) {
+            write(records);
+        }
+    }
+}
+
+void StatsJournal::write(const QList<Record> &records)
+{
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to open stats journal " << file << ": " << fptr.errorString() << endl;
+        return;
+    }
+
+    QByteArray data;
+    for (const Record &r : records) {
+        data.append(RecordLine(r));
+        latest.insert(r.dir, r);
+    }
+    fptr.write(data);
+    fptr.flush();
+    num_lines += records.count();
+
+    // rewrite the journal once it has mostly outdated records
+    if (num_lines > 2 * latest.count() + 1000)
+        compact();
+}
+
+void StatsJournal::compact()
+{
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly)) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to compact stats journal " << file << ": " << fptr.errorString() << endl;
+        return;
+    }
+
+    for (const Record &r : qAsConst(latest))
+        fptr.write(RecordLine(r));
+
+    if (fptr.commit())
+        num_lines = latest.count();
+    else
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to compact stats journal " << file << ": " << fptr.errorString() << endl;
+}
+
+QHash<QString, StatsJournal::Record> StatsJournal::load(const QString &file)
+{
+    QHash<QString, Record> ret;
+    QFile fptr(file);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return ret;
+
+    // the torX dirs are next to the journal
+    const QDir data_dir = QFileInfo(file).absoluteDir();
+
+    while (!fptr.atEnd()) {
+        // a partially written last line is ignored
+        const QByteArray line = fptr.readLine();
+        if (!line.endsWith('\n'))
+            break;
+
+        const QList<QByteArray> parts = line.trimmed().split(' ');
+        if (parts.count() != 5)
+            continue;
+
+        bool ok[3] = {false, false, false};
+        Record r;
+        r.dir = QString::fromUtf8(parts[0]);
+        r.info_hash = QString::fromLatin1(parts[1]);
+        r.uploaded = parts[2].toULongLong(&ok[0]);
+        r.running_time_dl = parts[3].toUInt(&ok[1]);
+        r.running_time_ul = parts[4].toUInt(&ok[2]);
+        if (ok[0] && ok[1] && ok[2])
+            ret.insert(r.dir, r);
+    }
+
+    // drop the records of torrents which were removed while the journal was not running,
+    // or whose dir was deleted outside of KTorrent
+    for (auto i = ret.begin(); i != ret.end();) {
+        if (data_dir.exists(i.key()))
+            ++i;
+        else
+            i = ret.erase(i);
+    }
+
+    return ret;
+}
+
+void StatsJournal::replay(const QString &stats_file, const Record &r)
+{
+    QFile fptr(stats_file);
+    if (!fptr.open(QIODevice::ReadOnly))
+        return;
+
+    QList<QByteArray> lines = fptr.readAll().split('\n');
+    fptr.close();
+
+    bool changed = false;
+    const auto update = [&](const QByteArray &key, bt::Uint64 value) {
+        for (QByteArray &line : lines) {
+            if (!line.startsWith(key + '='))
+                continue;
+
+            if (line.mid(key.size() + 1).toULongLong() < value) {
+                line = key + '=' + QByteArray::number(value);
+                changed = true;
+            }
+            return;
+        }
+    };
+
+    update(QByteArrayLiteral("UPLOADED"), r.uploaded);
+    update(QByteArrayLiteral("RUNNING_TIME_DL"), r.running_time_dl);
+    update(QByteArrayLiteral("RUNNING_TIME_UL"), r.running_time_ul);
+    if (!changed)
+        return;
+
+    QSaveFile out(stats_file);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(lines.join('\n'));
+        out.commit();
+    }
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_STATSJOURNAL_H
+#define KT_STATSJOURNAL_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+#include <atomic>
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+/**
+ * Thread which writes the accounting stats of torrents (uploaded bytes and
+ * running times) to an append-only journal. Torrents post snapshots of their
+ * stats, multiple snapshots of the same torrent are merged until the next
+ * flush. The journal is compacted once it has grown too much.
+ *
+ * At startup the journal is replayed into the stats files of the torrents,
+ * so that a crash only loses the stats since the last flush. Records carry
+ * the info hash of their torrent, so that they are never replayed into
+ * another torrent which got the same torX dir later on.
+ */
+class KTCORE_EXPORT StatsJournal : public QThread
+{
+    Q_OBJECT
+public:
+    /// Snapshot of the stats of a torrent
+    struct Record {
+        QString dir; ///< Name of the torX dir of the torrent
+        QString info_hash; ///< Info hash of the torrent
+        bt::Uint64 uploaded;
+        bt::Uint32 running_time_dl;
+        bt::Uint32 running_time_ul;
+    };
+
+    StatsJournal(const QString &file);
+    ~StatsJournal() override;
+
+    /// Create a Record for a torrent
+    static Record snapshot(bt::TorrentInterface *tc);
+
+    /**
+     * Post stats snapshots, they will be written during the next flush.
+     * @param records The snapshots
+     */
+    void post(const QList<Record> &records);
+
+    /// Forget about a torrent which has been removed
+    void removeTorrent(const QString &dir);
+
+    /// Write all pending snapshots now, without waiting for the next flush
+    void flush();
+
+    /// Stop the writer thread, pending snapshots are written first
+    void stop();
+
+    /**
+     * Read a journal, records of torX dirs which no longer exist are left out.
+     * @param file The journal file
+     * @return The last record of each torX dir
+     */
+    static QHash<QString, Record> load(const QString &file);
+
+    /**
+     * Apply a record to the stats file of a torrent. Only values which
+     * are larger then those in the stats file are written.
+     * @param stats_file The stats file
+     * @param r The record
+     */
+    static void replay(const QString &stats_file, const Record &r);
+
+protected:
+    void run() override;
+
+private:
+    void write(const QList<Record> &records);
+    void compact();
+
+private:
+    QString file;
+    QMutex mutex;
+    QWaitCondition wake;
+    QHash<QString, Record> pending;
+    QList<QString> removed;
+    bool flush_requested;
+    std::atomic<bool> stop_requested;
+
+    // only used by the writer thread
+    QHash<QString, Record> latest;
+    int num_lines;
+};
+
+}
+
+#endif
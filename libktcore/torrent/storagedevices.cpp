@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "storagedevices.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <QDir>
+#include <QFile>
+#include <QStorageInfo>
+
+namespace kt
+{
+StorageDevices::StorageDevices()
+{
+}
+
+StorageDevices::~StorageDevices()
+{
+}
+
+QString StorageDevices::deviceOf(const QString &path)
+{
+    QHash<QString, QString>::const_iterator i = path_cache.constFind(path);
+    if (i != path_cache.constEnd())
+        return i.value();
+
+    // walk up until we find something which exists
+    QString p = QDir::cleanPath(path);
+    QString device;
+    while (!p.isEmpty()) {
+        struct stat sb;
+        if (::stat(QFile::encodeName(p).constData(), &sb) == 0) {
+            device = QString::number(static_cast<qulonglong>(sb.st_dev));
+            break;
+        }
+
+        const int idx = p.lastIndexOf(QLatin1Char('/'));
+        if (idx < 0 || p == QLatin1String("/"))
+            break;
+
+        p = idx == 0 ? QStringLiteral("/") : p.left(idx);
+    }
+
+    if (!device.isEmpty() && !devices.contains(device)) {
+        // only done once per device, QStorageInfo needs to parse the mount table
+        QStorageInfo info(p);
+        Device d;
+        d.name = QString::fromLocal8Bit(info.device());
+        d.mount_point = info.rootPath();
+        if (d.name.isEmpty())
+            d.name = d.mount_point;
+        devices.insert(device, d);
+    }
+
+    path_cache.insert(path, device);
+    return device;
+}
+
+QString StorageDevices::deviceName(const QString &device) const
+{
+    return devices.value(device).name;
+}
+
+QString StorageDevices::mountPoint(const QString &device) const
+{
+    return devices.value(device).mount_point;
+}
+
+void StorageDevices::clear()
+{
+    path_cache.clear();
+    devices.clear();
+}
+}
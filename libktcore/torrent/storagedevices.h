@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_STORAGEDEVICES_H
+#define KT_STORAGEDEVICES_H
+
+#include <QHash>
+#include <QString>
+
+#include <ktcore_export.h>
+
+namespace kt
+{
+/**
+ * Maps paths to the storage device they are on. The device of a path is
+ * determined with a single stat call (the st_dev field), results are cached
+ * per path, so looking up the device of a torrent is cheap.
+ */
+class KTCORE_EXPORT StorageDevices
+{
+public:
+    StorageDevices();
+    ~StorageDevices();
+
+    /**
+     * Get the device a path is on. If the path does not exist yet,
+     * the device of the first parent directory which does exist is used.
+     * @param path The path
+     * @return An identifier of the device, or an empty string if it cannot be determined
+     */
+    QString deviceOf(const QString &path);
+
+    /**
+     * Get a name of a device, which can be shown to the user.
+     * @param device The device identifier as returned by deviceOf
+     * @return The name of the block device or the mount point
+     */
+    QString deviceName(const QString &device) const;
+
+    /**
+     * Get the mount point of a device.
+     * @param device The device identifier as returned by deviceOf
+     */
+    QString mountPoint(const QString &device) const;
+
+    /// Forget all cached lookups, call this when filesystems have been (un)mounted
+    void clear();
+
+private:
+    struct Device {
+        QString name;
+        QString mount_point;
+    };
+
+    QHash<QString, QString> path_cache;
+    QHash<QString, Device> devices;
+};
+}
+
+#endif
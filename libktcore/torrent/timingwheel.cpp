@@ -0,0 +1,118 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "timingwheel.h"
+
+using namespace bt;
+
+namespace kt
+{
+const Uint64 LEVEL0_SLOTS = 256; // one slot per second
+const Uint64 LEVEL1_SLOTS = 64; // one slot per LEVEL0_SLOTS seconds
+
+TimingWheel::TimingWheel()
+    : level0(LEVEL0_SLOTS)
+    , level1(LEVEL1_SLOTS)
+    , current(0)
+    , started(false)
+{
+}
+
+TimingWheel::~TimingWheel()
+{
+}
+
+void TimingWheel::schedule(bt::TorrentInterface *tc, bt::TimeStamp deadline)
+{
+    deadlines.insert(tc, deadline);
+    Entry e = {tc, deadline};
+    place(e);
+}
+
+void TimingWheel::cancel(bt::TorrentInterface *tc)
+{
+    // the entries in the slots are dropped when they are reached
+    deadlines.remove(tc);
+}
+
+void TimingWheel::clear()
+{
+    deadlines.clear();
+    for (QVector<Entry> &slot : level0)
+        slot.clear();
+    for (QVector<Entry> &slot : level1)
+        slot.clear();
+}
+
+void TimingWheel::place(const Entry &e)
+{
+    const Uint64 sec = e.deadline / 1000;
+    if (!started) {
+        current = sec;
+        started = true;
+    }
+
+    if (sec <= current) {
+        // already due, it will be picked up at the next expire
+        level0[(current + 1) % LEVEL0_SLOTS].append(e);
+    } else if (sec - current < LEVEL0_SLOTS) {
+        level0[sec % LEVEL0_SLOTS].append(e);
+    } else if (sec / LEVEL0_SLOTS - current / LEVEL0_SLOTS < LEVEL1_SLOTS) {
+        level1[(sec / LEVEL0_SLOTS) % LEVEL1_SLOTS].append(e);
+    } else {
+        // too far away, park it in the last slot and place it again when that is reached
+        level1[(current / LEVEL0_SLOTS + LEVEL1_SLOTS - 1) % LEVEL1_SLOTS].append(e);
+    }
+}
+
+void TimingWheel::drain(QVector<Entry> &slot, bt::TimeStamp now, QList<bt::TorrentInterface *> &expired)
+{
+    QVector<Entry> entries;
+    entries.swap(slot);
+    for (const Entry &e : qAsConst(entries)) {
+        QHash<bt::TorrentInterface *, bt::TimeStamp>::iterator i = deadlines.find(e.tc);
+        // skip entries of cancelled or rescheduled torrents
+        if (i == deadlines.end() || i.value() != e.deadline)
+            continue;
+
+        if (e.deadline <= now) {
+            expired.append(e.tc);
+            deadlines.erase(i);
+        } else {
+            place(e);
+        }
+    }
+}
+
+QList<bt::TorrentInterface *> TimingWheel::expire(bt::TimeStamp now)
+{
+    QList<bt::TorrentInterface *> expired;
+    const Uint64 sec = now / 1000;
+    if (!started || sec <= current)
+        return expired;
+
+    if (sec - current >= LEVEL0_SLOTS * LEVEL1_SLOTS) {
+        // we have not been called for a very long time, look at everything
+        current = sec;
+        for (QVector<Entry> &slot : level0)
+            drain(slot, now, expired);
+        for (QVector<Entry> &slot : level1)
+            drain(slot, now, expired);
+        return expired;
+    }
+
+    while (current < sec) {
+        current++;
+        // cascade the entries of the second level when the first level wraps around
+        if (current % LEVEL0_SLOTS == 0)
+            drain(level1[(current / LEVEL0_SLOTS) % LEVEL1_SLOTS], now, expired);
+        drain(level0[current % LEVEL0_SLOTS], now, expired);
+    }
+
+    return expired;
+}
+
+}
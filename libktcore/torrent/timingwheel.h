@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TIMINGWHEEL_H
+#define KT_TIMINGWHEEL_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include <ktcore_export.h>
+#include <util/constants.h>
+
+namespace bt
+{
+class TorrentInterface;
+}
+
+namespace kt
+{
+/**
+ * Hierarchical timing wheel holding a deadline for each torrent.
+ * The first level has a slot per second, the second level a slot per
+ * revolution of the first one. Advancing the wheel only looks at the
+ * slots which have passed, so the cost depends on the number of expired
+ * deadlines and not on the number of torrents in the wheel.
+ */
+class KTCORE_EXPORT TimingWheel
+{
+public:
+    TimingWheel();
+    ~TimingWheel();
+
+    /**
+     * Set or change the deadline of a torrent.
+     * @param tc The torrent
+     * @param deadline The deadline in milliseconds, on the same clock as the time passed to expire
+     */
+    void schedule(bt::TorrentInterface *tc, bt::TimeStamp deadline);
+
+    /// Remove the deadline of a torrent
+    void cancel(bt::TorrentInterface *tc);
+
+    /// Remove all deadlines
+    void clear();
+
+    /// Whether or not a torrent has a deadline
+    bool contains(bt::TorrentInterface *tc) const
+    {
+        return deadlines.contains(tc);
+    }
+
+    /**
+     * Advance the wheel and collect all torrents whose deadline has passed.
+     * The deadlines of these torrents are removed.
+     * @param now The current time in milliseconds
+     * @return The torrents whose deadline has passed
+     */
+    QList<bt::TorrentInterface *> expire(bt::TimeStamp now);
+
+private:
+    struct Entry {
+        bt::TorrentInterface *tc;
+        bt::TimeStamp deadline;
+    };
+
+    void place(const Entry &e);
+    void drain(QVector<Entry> &slot, bt::TimeStamp now, QList<bt::TorrentInterface *> &expired);
+
+private:
+    QHash<bt::TorrentInterface *, bt::TimeStamp> deadlines;
+    QVector<QVector<Entry>> level0;
+    QVector<QVector<Entry>> level1;
+    bt::Uint64 current; ///< Current position in seconds
+    bool started;
+};
+
+}
+
+#endif
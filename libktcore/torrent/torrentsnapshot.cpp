@@ -0,0 +1,177 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "torrentsnapshot.h"
+
+#include <QDataStream>
+#include <QSaveFile>
+
+#include <groups/group.h>
+#include <groups/groupmanager.h>
+#include <groups/torrentgroup.h>
+#include <interfaces/torrentinterface.h>
+#include <torrent/queuemanager.h>
+#include <util/log.h>
+#include <util/mmapfile.h>
+
+using namespace bt;
+
+namespace kt
+{
+const Uint32 SNAPSHOT_MAGIC = 0x4B545353; // KTSS
+const Uint32 SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 num_entries;
+    Uint32 data_size;
+    Uint8 hash[20];
+};
+
+TorrentSnapshot::TorrentSnapshot()
+{
+}
+
+TorrentSnapshot::~TorrentSnapshot()
+{
+}
+
+bool TorrentSnapshot::load(const QString &file)
+{
+    clear();
+
+    MMapFile fptr;
+    if (!fptr.open(file, QIODevice::ReadOnly))
+        return false;
+
+    SnapshotHeader hdr;
+    if (fptr.getSize() < sizeof(SnapshotHeader) || fptr.read(&hdr, sizeof(SnapshotHeader)) != sizeof(SnapshotHeader))
+        return false;
+
+    if (hdr.magic != SNAPSHOT_MAGIC || hdr.version != SNAPSHOT_VERSION) {
+        Out(SYS_GEN | LOG_NOTICE) << "Ignoring torrent snapshot " << file << ": unknown version" << endl;
+        return false;
+    }
+
+    // there is nothing to map in a snapshot without torrents
+    static const Uint8 no_data = 0;
+    const Uint8 *data = hdr.data_size > 0 ? fptr.getData(sizeof(SnapshotHeader)) : &no_data;
+    if (!data || fptr.getSize() - sizeof(SnapshotHeader) != hdr.data_size || SHA1Hash::generate(data, hdr.data_size) != SHA1Hash(hdr.hash)) {
+        Out(SYS_GEN | LOG_NOTICE) << "Ignoring torrent snapshot " << file << ": checksum mismatch" << endl;
+        return false;
+    }
+
+    // The data is decoded straight from the mapping, no need to copy it first
+    const QByteArray raw = QByteArray::fromRawData((const char *)data, hdr.data_size);
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_5_0);
+    for (Uint32 i = 0; i < hdr.num_entries && in.status() == QDataStream::Ok; i++) {
+        Entry e;
+        QByteArray ih;
+        qint32 status = 0;
+        qint32 priority = 0;
+        in >> ih >> e.name >> e.output_path;
+        in >> e.total_bytes_to_download >> e.bytes_downloaded >> e.bytes_uploaded >> e.bytes_left;
+        in >> status >> e.running >> e.completed >> priority >> e.time_added >> e.groups;
+        if (ih.size() != 20)
+            break;
+
+        e.info_hash = SHA1Hash((const Uint8 *)ih.constData());
+        e.status = (TorrentStatus)status;
+        e.priority = priority;
+        index.insert(e.info_hash, entry_list.count());
+        entry_list.append(e);
+    }
+
+    if (in.status() != QDataStream::Ok || (Uint32)entry_list.count() != hdr.num_entries) {
+        Out(SYS_GEN | LOG_NOTICE) << "Ignoring torrent snapshot " << file << ": corrupt data" << endl;
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+void TorrentSnapshot::save(const QString &file, QueueManager *qman, GroupManager *gman, const QList<const Entry *> &dormant)
+{
+    write(file, encode(qman, gman, dormant));
+}
+
+QByteArray TorrentSnapshot::encode(QueueManager *qman, GroupManager *gman, const QList<const Entry *> &dormant)
+{
+    // Collect the members of each group in one go, custom groups know their members,
+    // the default groups have to test every torrent
+    QHash<bt::TorrentInterface *, QStringList> membership;
+    for (GroupManager::CItr i = gman->begin(); i != gman->end(); i++) {
+        Group *g = i->second;
+        if (TorrentGroup *tg = qobject_cast<TorrentGroup *>(g)) {
+            for (bt::TorrentInterface *tc : tg->members())
+                membership[tc] << g->groupPath();
+        } else {
+            for (bt::TorrentInterface *tc : qAsConst(*qman)) {
+                if (g->isMember(tc))
+                    membership[tc] << g->groupPath();
+            }
+        }
+    }
+
+    QByteArray raw;
+    QDataStream out(&raw, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    Uint32 num_entries = 0;
+    for (bt::TorrentInterface *tc : qAsConst(*qman)) {
+        const TorrentStats &s = tc->getStats();
+        const QStringList groups = membership.value(tc);
+        const SHA1Hash &ih = tc->getInfoHash();
+        out << QByteArray((const char *)ih.getData(), 20) << tc->getDisplayName() << s.output_path;
+        out << s.total_bytes_to_download << s.bytes_downloaded << s.bytes_uploaded << s.bytes_left_to_download;
+        out << (qint32)s.status << s.running << s.completed << (qint32)tc->getPriority() << s.time_added.toSecsSinceEpoch() << groups;
+        num_entries++;
+    }
+
+    for (const Entry *e : dormant) {
+        out << QByteArray((const char *)e->info_hash.getData(), 20) << e->name << e->output_path;
+        out << e->total_bytes_to_download << e->bytes_downloaded << e->bytes_uploaded << e->bytes_left;
+        out << (qint32)e->status << e->running << e->completed << (qint32)e->priority << e->time_added << e->groups;
+        num_entries++;
+    }
+
+    SnapshotHeader hdr;
+    hdr.magic = SNAPSHOT_MAGIC;
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.num_entries = num_entries;
+    hdr.data_size = raw.size();
+    const SHA1Hash hash = SHA1Hash::generate((const Uint8 *)raw.constData(), raw.size());
+    memcpy(hdr.hash, hash.getData(), 20);
+
+    return QByteArray((const char *)&hdr, sizeof(SnapshotHeader)) + raw;
+}
+
+bool TorrentSnapshot::write(const QString &file, const QByteArray &data)
+{
+    QSaveFile fptr(file);
+    if (!fptr.open(QIODevice::WriteOnly) || fptr.write(data) != data.size() || !fptr.commit()) {
+        Out(SYS_GEN | LOG_NOTICE) << "Failed to save torrent snapshot " << file << ": " << fptr.errorString() << endl;
+        return false;
+    }
+    return true;
+}
+
+void TorrentSnapshot::clear()
+{
+    entry_list.clear();
+    index.clear();
+}
+
+const TorrentSnapshot::Entry *TorrentSnapshot::find(const bt::SHA1Hash &ih) const
+{
+    QHash<SHA1Hash, int>::const_iterator i = index.find(ih);
+    return i != index.end() ? &entry_list.at(i.value()) : nullptr;
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+    SPDX-FileCopyrightText: 2021 KTorrent Developers
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KT_TORRENTSNAPSHOT_H
+#define KT_TORRENTSNAPSHOT_H
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include <ktcore_export.h>
+#include <torrent/torrentstats.h>
+#include <util/constants.h>
+#include <util/sha1hash.h>
+
+namespace kt
+{
+class QueueManager;
+class GroupManager;
+
+/**
+ * Compact summary of all torrents, which is saved on exit and periodically,
+ * so the UI can show the torrents at startup before they have been loaded.
+ *
+ * The file starts with a header containing a magic number, a version, the
+ * size and the SHA-1 hash of the data. Files with an unknown version or a
+ * wrong hash are ignored.
+ */
+class KTCORE_EXPORT TorrentSnapshot
+{
+public:
+    /// Summary of a single torrent
+    struct Entry {
+        bt::SHA1Hash info_hash;
+        QString name;
+        QString output_path;
+        bt::Uint64 total_bytes_to_download;
+        bt::Uint64 bytes_downloaded;
+        bt::Uint64 bytes_uploaded;
+        bt::Uint64 bytes_left;
+        bt::TorrentStatus status;
+        bool running;
+        bool completed;
+        int priority;
+        qint64 time_added; ///< Seconds since epoch
+        QStringList groups; ///< Paths of all groups the torrent is a member of
+    };
+
+    TorrentSnapshot();
+    ~TorrentSnapshot();
+
+    /**
+     * Load a snapshot.
+     * @param file The file
+     * @return true if the snapshot was loaded, false if it is missing, stale or corrupt
+     */
+    bool load(const QString &file);
+
+    /**
+     * Save a snapshot of all torrents.
+     * @param file The file
+     * @param qman The QueueManager
+     * @param gman The GroupManager
+     * @param dormant Entries of the torrents which have not been loaded, they are saved as they are
+     */
+    static void save(const QString &file, QueueManager *qman, GroupManager *gman, const QList<const Entry *> &dormant = QList<const Entry *>());
+
+    /**
+     * Encode a snapshot of all torrents, must be called from the main thread.
+     * @param qman The QueueManager
+     * @param gman The GroupManager
+     * @param dormant Entries of the torrents which have not been loaded, they are saved as they are
+     * @return The contents of the snapshot file
+     */
+    static QByteArray encode(QueueManager *qman, GroupManager *gman, const QList<const Entry *> &dormant = QList<const Entry *>());
+
+    /**
+     * Write an encoded snapshot, can be called from any thread.
+     * @param file The file
+     * @param data The contents of the snapshot file
+     * @return true upon success
+     */
+    static bool write(const QString &file, const QByteArray &data);
+
+    /// Clear the snapshot
+    void clear();
+
+    /// Get all entries
+    const QList<Entry> &entries() const
+    {
+        return entry_list;
+    }
+
+    /// Find the entry of a torrent, returns nullptr if there is none
+    const Entry *find(const bt::SHA1Hash &ih) const;
+
+    /// Whether or not the snapshot is empty
+    bool isEmpty() const
+    {
+        return entry_list.isEmpty();
+    }
+
+private:
+    QList<Entry> entry_list;
+    QHash<bt::SHA1Hash, int> index;
+};
+
+}
+
+#endif
@@ -45,6 +45,7 @@
 #include <interfaces/functions.h>
 #include <interfaces/torrentfileinterface.h>
 #include <interfaces/torrentinterface.h>
+#include <torrent/datacheckscheduler.h>
 #include <util/bitset.h>
 #include <util/error.h>
 #include <util/functions.h>
@@ -56,9 +57,10 @@ using namespace bt;
 
 namespace kt
 {
-FileView::FileView(QWidget *parent)
+FileView::FileView(DataCheckScheduler *check_scheduler, QWidget *parent)
     : QWidget(parent)
     , model(nullptr)
+    , check_scheduler(check_scheduler)
     , show_list_of_files(false)
     , header_state_loaded(false)
 {
@@ -618,9 +620,9 @@ void FileView::checkFile()
             if (tfi->getLastChunk() > to)
                 to = tfi->getLastChunk();
         }
-        curr_tc.data()->startDataCheck(false, from, to);
+        check_scheduler->enqueue(curr_tc.data(), true, false, from, to);
     } else
-        curr_tc.data()->startDataCheck(false, 0, curr_tc.data()->getStats().total_chunks);
+        check_scheduler->enqueue(curr_tc.data(), true);
 }
 
 }
@@ -39,6 +39,7 @@ class TorrentFileInterface;
 
 namespace kt
 {
+class DataCheckScheduler;
 class TorrentFileModel;
 
 /**
@@ -48,7 +49,7 @@ class FileView : public QWidget
 {
     Q_OBJECT
 public:
-    FileView(QWidget *parent);
+    FileView(DataCheckScheduler *check_scheduler, QWidget *parent);
     ~FileView() override;
 
     void changeTC(bt::TorrentInterface *tc);
@@ -92,6 +93,7 @@ private Q_SLOTS:
 private:
     bt::TorrentInterface::WPtr curr_tc;
     TorrentFileModel *model;
+    DataCheckScheduler *check_scheduler;
 
     QMenu *context_menu;
     QAction *open_action;
@@ -28,6 +28,7 @@
 #include <interfaces/guiinterface.h>
 #include <interfaces/torrentinterface.h>
 #include <settings.h>
+#include <torrent/queuemanager.h>
 #include <util/log.h>
 #include <util/logsystemmanager.h>
 
@@ -70,8 +71,8 @@ void InfoWidgetPlugin::load()
     LogSystemManager::instance().registerSystem(i18n("Info Widget"), SYS_INW);
     connect(getCore(), &CoreInterface::settingsChanged, this, &InfoWidgetPlugin::applySettings);
 
-    status_tab = new StatusTab(nullptr);
-    file_view = new FileView(nullptr);
+    status_tab = new StatusTab(getCore()->getQueueManager(), nullptr);
+    file_view = new FileView(getCore()->getDataCheckScheduler(), nullptr);
     file_view->loadState(KSharedConfig::openConfig());
     connect(getCore(), &CoreInterface::torrentRemoved, this, &InfoWidgetPlugin::torrentRemoved);
 
@@ -248,7 +249,8 @@ void InfoWidgetPlugin::showTrackerView(bool show)
 {
     TorrentActivityInterface *ta = getGUI()->getTorrentActivity();
     if (show && !tracker_view) {
-        tracker_view = new TrackerView(nullptr);
+        QueueManager *qman = getCore()->getQueueManager();
+        tracker_view = new TrackerView(qman->announceScheduler(), qman->scrapeBatcher(), nullptr);
         ta->addToolWidget(tracker_view, i18n("Trackers"), QStringLiteral("network-server"), i18n("Displays information about all the trackers of a torrent"));
         tracker_view->loadState(KSharedConfig::openConfig());
         tracker_view->changeTC(ta->getCurrentTorrent());
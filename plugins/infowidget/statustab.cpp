@@ -30,6 +30,7 @@
 #include "downloadedchunkbar.h"
 #include "settings.h"
 #include "statustab.h"
+#include <torrent/queuemanager.h>
 #include <util/functions.h>
 #include <util/log.h>
 #include <util/sha1hash.h>
@@ -38,8 +39,9 @@ using namespace bt;
 
 namespace kt
 {
-StatusTab::StatusTab(QWidget *parent)
+StatusTab::StatusTab(QueueManager *qman, QWidget *parent)
     : QWidget(parent)
+    , qman(qman)
 {
     setupUi(this);
     // do not use hardcoded colors
@@ -208,6 +210,7 @@ void StatusTab::maxRatioChanged(double v)
         return;
 
     curr_tc.data()->setMaxShareRatio(v);
+    qman->requeue(curr_tc.data());
 }
 
 void StatusTab::useRatioLimitToggled(bool state)
@@ -235,6 +238,7 @@ void StatusTab::useRatioLimitToggled(bool state)
             ratio_limit->setValue(sr + 1.00f);
         }
     }
+    qman->requeue(tc);
 }
 
 void StatusTab::maxRatioUpdate()
@@ -303,12 +307,16 @@ void StatusTab::useTimeLimitToggled(bool on)
     } else {
         tc->setMaxSeedTime(0.0f);
     }
+    qman->requeue(tc);
 }
 
 void StatusTab::maxTimeChanged(double v)
 {
-    if (curr_tc)
-        curr_tc.data()->setMaxSeedTime(v);
+    if (!curr_tc)
+        return;
+
+    curr_tc.data()->setMaxSeedTime(v);
+    qman->requeue(curr_tc.data());
 }
 
 void StatusTab::linkActivated(const QString &link)
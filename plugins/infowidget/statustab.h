@@ -28,12 +28,14 @@
 
 namespace kt
 {
+class QueueManager;
+
 class StatusTab : public QWidget, public Ui_StatusTab
 {
     Q_OBJECT
 
 public:
-    StatusTab(QWidget *parent);
+    StatusTab(QueueManager *qman, QWidget *parent);
     ~StatusTab() override;
 
 public Q_SLOTS:
@@ -50,6 +52,7 @@ private:
     void maxSeedTimeUpdate();
 
 private:
+    QueueManager *qman;
     QPointer<bt::TorrentInterface> curr_tc;
 };
 }
@@ -27,12 +27,14 @@
 #include <KLocalizedString>
 #include <interfaces/torrentinterface.h>
 #include <interfaces/trackerinterface.h>
+#include <torrent/scrapebatcher.h>
 
 namespace kt
 {
-TrackerModel::TrackerModel(QObject *parent)
+TrackerModel::TrackerModel(ScrapeBatcher *scrapes, QObject *parent)
     : QAbstractTableModel(parent)
     , tc(nullptr)
+    , scrapes(scrapes)
     , running(false)
 {
 }
@@ -64,7 +66,7 @@ void TrackerModel::update()
 
     int idx = 0;
     for (Item *t : qAsConst(trackers)) {
-        if (t->update())
+        if (t->update(scrapes, tc))
             Q_EMIT dataChanged(index(idx, 1), index(idx, 5));
         idx++;
     }
@@ -229,7 +231,7 @@ TrackerModel::Item::Item(bt::TrackerInterface *tracker)
 {
 }
 
-bool TrackerModel::Item::update()
+bool TrackerModel::Item::update(const ScrapeBatcher *scrapes, bt::TorrentInterface *tc)
 {
     bool ret = false;
     if (status != trk->trackerStatus()) {
@@ -237,18 +239,30 @@ bool TrackerModel::Item::update()
         ret = true;
     }
 
-    if (seeders != trk->getNumSeeders()) {
-        seeders = trk->getNumSeeders();
+    int s = trk->getNumSeeders();
+    int l = trk->getNumLeechers();
+    int d = trk->getTotalTimesDownloaded();
+
+    // a batched scrape is the only news about a stopped torrent
+    ScrapeBatcher::Result r;
+    if (scrapes && scrapes->result(trk->trackerURL(), tc, r) && (!tc->getStats().running || s < 0)) {
+        s = r.seeders;
+        l = r.leechers;
+        d = r.completed;
+    }
+
+    if (seeders != s) {
+        seeders = s;
         ret = true;
     }
 
-    if (leechers != trk->getNumLeechers()) {
-        leechers = trk->getNumLeechers();
+    if (leechers != l) {
+        leechers = l;
         ret = true;
     }
 
-    if (times_downloaded != trk->getTotalTimesDownloaded()) {
-        times_downloaded = trk->getTotalTimesDownloaded();
+    if (times_downloaded != d) {
+        times_downloaded = d;
         ret = true;
     }
 
@@ -35,6 +35,8 @@ class TorrentInterface;
 
 namespace kt
 {
+class ScrapeBatcher;
+
 /**
     @author
 */
@@ -42,7 +44,7 @@ class TrackerModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
-    TrackerModel(QObject *parent);
+    TrackerModel(ScrapeBatcher *scrapes, QObject *parent);
     ~TrackerModel() override;
 
     void changeTC(bt::TorrentInterface *tc);
@@ -77,12 +79,13 @@ private:
         unsigned int time_to_next_update;
 
         Item(bt::TrackerInterface *tracker);
-        bool update();
+        bool update(const ScrapeBatcher *scrapes, bt::TorrentInterface *tc);
         QVariant displayData(int column) const;
         QVariant sortData(int column) const;
     };
 
     bt::TorrentInterface *tc;
+    ScrapeBatcher *scrapes;
     QList<Item *> trackers;
     bool running;
 };
@@ -34,19 +34,23 @@
 #include <interfaces/torrentinterface.h>
 #include <interfaces/trackerinterface.h>
 #include <interfaces/trackerslist.h>
+#include <torrent/announcescheduler.h>
 #include <torrent/globals.h>
+#include <torrent/scrapebatcher.h>
 #include <util/log.h>
 
 using namespace bt;
 
 namespace kt
 {
-TrackerView::TrackerView(QWidget *parent)
+TrackerView::TrackerView(AnnounceScheduler *announces, ScrapeBatcher *scrapes, QWidget *parent)
     : QWidget(parent)
+    , announces(announces)
+    , scrapes(scrapes)
     , header_state_loaded(false)
 {
     setupUi(this);
-    model = new TrackerModel(this);
+    model = new TrackerModel(scrapes, this);
     proxy_model = new QSortFilterProxyModel(this);
     proxy_model->setSortRole(Qt::UserRole);
     proxy_model->setSourceModel(model);
@@ -180,7 +184,7 @@ void TrackerView::restoreClicked()
 {
     if (tc) {
         tc.data()->getTrackersList()->restoreDefault();
-        tc.data()->updateTracker();
+        announces->announce(tc.data());
         model->changeTC(tc.data()); // trigger reset
     }
 }
@@ -190,7 +194,7 @@ void TrackerView::updateClicked()
     if (!tc)
         return;
 
-    tc.data()->updateTracker();
+    announces->announce(tc.data());
 }
 
 void TrackerView::scrapeClicked()
@@ -198,7 +202,7 @@ void TrackerView::scrapeClicked()
     if (!tc)
         return;
 
-    tc.data()->scrapeTracker();
+    scrapes->scrape(tc.data());
 }
 
 void TrackerView::changeTC(TorrentInterface *ti)
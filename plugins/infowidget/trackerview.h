@@ -32,6 +32,8 @@
 
 namespace kt
 {
+class AnnounceScheduler;
+class ScrapeBatcher;
 class TrackerModel;
 
 /**
@@ -41,7 +43,7 @@ class TrackerView : public QWidget, public Ui_TrackerView
 {
     Q_OBJECT
 public:
-    TrackerView(QWidget *parent);
+    TrackerView(AnnounceScheduler *announces, ScrapeBatcher *scrapes, QWidget *parent);
     ~TrackerView() override;
 
     void update();
@@ -64,6 +66,8 @@ private:
 
 private:
     bt::TorrentInterface::WPtr tc;
+    AnnounceScheduler *announces;
+    ScrapeBatcher *scrapes;
     TrackerModel *model;
     QSortFilterProxyModel *proxy_model;
     QStringList tracker_hints;
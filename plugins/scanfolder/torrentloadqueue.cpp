@@ -28,9 +28,8 @@
 #include <KLocalizedString>
 
 #include "scanfolderpluginsettings.h"
-#include <bcodec/bdecoder.h>
-#include <bcodec/bnode.h>
 #include <interfaces/coreinterface.h>
+#include <interfaces/functions.h>
 #include <util/fileops.h>
 #include <util/functions.h>
 #include <util/log.h>
@@ -65,28 +64,14 @@ void TorrentLoadQueue::add(const QList<QUrl> &urls)
 
 bool TorrentLoadQueue::validateTorrent(const QUrl &url, QByteArray &data)
 {
-    // try to decode file, if it is syntactically correct, we can try to load it
+    // if the file is syntactically correct, it is complete and we can try to load it,
+    // it is only decoded when it is loaded
     QFile fptr(url.toLocalFile());
     if (!fptr.open(QIODevice::ReadOnly))
         return false;
 
-    try {
-        data = fptr.readAll();
-
-        bt::BDecoder dec(data, false);
-        bt::BNode *n = dec.decode();
-        if (n) {
-            // valid node, so file is complete
-            delete n;
-            return true;
-        } else {
-            // decoding failed so incomplete
-            return false;
-        }
-    } catch (...) {
-        // any error means shit happened and the file is incomplete
-        return false;
-    }
+    data = fptr.readAll();
+    return kt::IsBEncoded(data);
 }
 
 void TorrentLoadQueue::loadOne()
@@ -226,15 +226,11 @@ void ShutdownRuleSet::load(const QString &file)
 
 bt::TorrentInterface *ShutdownRuleSet::torrentForHash(const QByteArray &hash)
 {
-    bt::SHA1Hash ih((const bt::Uint8 *)hash.data());
-    QueueManager *qman = core->getQueueManager();
-    for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++) {
-        bt::TorrentInterface *t = *i;
-        if (t->getInfoHash() == ih)
-            return t;
-    }
+    if (hash.size() != 20)
+        return 0;
 
-    return 0;
+    bt::SHA1Hash ih((const bt::Uint8 *)hash.data());
+    return core->getQueueManager()->find(ih);
 }
 
 kt::Action ShutdownRuleSet::currentAction() const
@@ -29,9 +29,8 @@
 #include <KMessageBox>
 
 #include "linkdownloader.h"
-#include <bcodec/bdecoder.h>
-#include <bcodec/bnode.h>
 #include <interfaces/coreinterface.h>
+#include <interfaces/functions.h>
 #include <interfaces/torrentinterface.h>
 #include <magnet/magnetlink.h>
 #include <util/log.h>
@@ -114,18 +113,8 @@ void LinkDownloader::start()
 
 bool LinkDownloader::isTorrent(const QByteArray &data) const
 {
-    bool ret = false;
-    try {
-        BDecoder decoder(data, false);
-        BNode *node = decoder.decode();
-        if (node)
-            ret = true;
-
-        delete node;
-    } catch (...) {
-        ret = false;
-    }
-    return ret;
+    // the torrent is decoded when it is loaded, no need to do it twice
+    return kt::IsBEncoded(data);
 }
 
 void LinkDownloader::handleHtmlPage(const QByteArray &data)